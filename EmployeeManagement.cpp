@@ -14,6 +14,55 @@
 #include <vector>
 #include <sstream>
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <deque>
+#include <queue>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <iomanip>
+#include <cmath>
+#include <limits>
+#include <memory>
+
+// SSE2 is used to compare all keys of a radix tree Node16 at once
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define EMPLOYEE_HAVE_SSE2 1
+#endif
+
+// AVX2 and carry-less multiply are compiled per function and only used when
+// the CPU reports them at run time
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define EMPLOYEE_HAVE_AVX2_DISPATCH 1
+#define EMPLOYEE_TARGET_AVX2 __attribute__((target("avx2,pclmul")))
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Raw terminal input for search-as-you-type, memory-mapped file input and
+// flushing files to disk
+#if !defined(_WIN32)
+#include <termios.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#else
+#include <io.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
 
 using namespace std;
 
@@ -21,819 +70,11786 @@ using namespace std;
 // Global definitions visible to all methods and classes
 //============================================================================
 
-struct Employee {
-    string employeeId;
-    string fullName;
-    string department;
-    string title;
-    string managerId;
-    vector<string> skills;
-};
+/**
+ * Index of the lowest set bit in a non-zero mask
+ *
+ * @param mask Bit mask with at least one bit set
+ * @return Position of the lowest set bit
+ */
+inline unsigned countTrailingZeros(unsigned mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
 
-// Internal structure for the tree
-struct Node {
-    Employee employee;
-    Node* left;
-    Node* right;
-    int height;  // Height of subtree rooted at this node
+/**
+ * Index of the lowest set bit in a non-zero 64-bit word
+ *
+ * @param word Word with at least one bit set
+ * @return Position of the lowest set bit
+ */
+inline unsigned countTrailingZeros64(uint64_t word) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return static_cast<unsigned>(index);
+#elif defined(_MSC_VER)
+    unsigned low = static_cast<unsigned>(word);
+    return low != 0 ? countTrailingZeros(low) : 32 + countTrailingZeros(static_cast<unsigned>(word >> 32));
+#else
+    return static_cast<unsigned>(__builtin_ctzll(word));
+#endif
+}
+
+/**
+ * Number of set bits in a 64-bit word
+ *
+ * @param word Any word
+ * @return Population count
+ */
+inline unsigned popCount64(uint64_t word) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    return static_cast<unsigned>(__popcnt64(word));
+#elif defined(_MSC_VER)
+    return __popcnt(static_cast<unsigned>(word)) + __popcnt(static_cast<unsigned>(word >> 32));
+#else
+    return static_cast<unsigned>(__builtin_popcountll(word));
+#endif
+}
+
+/**
+ * Read-only view of characters owned by someone else (C++11 has no
+ * std::string_view). Views of employee text point into the StringArena.
+ */
+class StringView {
+private:
+    const char* text;
+    uint32_t textLength;
+
+public:
+    StringView() : text(""), textLength(0) {}
+    StringView(const char* data, size_t length) : text(data), textLength(static_cast<uint32_t>(length)) {}
+    explicit StringView(const string& value) : text(value.data()), textLength(static_cast<uint32_t>(value.size())) {}
 
-    // Default constructor
-    Node() {
-        left = nullptr;
-        right = nullptr;
-        height = 1;  // Leaf nodes have height 1
+    const char* data() const { return text; }
+    size_t size() const { return textLength; }
+    size_t length() const { return textLength; }
+    bool empty() const { return textLength == 0; }
+    char operator[](size_t i) const { return text[i]; }
+    string str() const { return string(text, textLength); }
+
+    /**
+     * Three-way comparison in the same byte order as std::string
+     *
+     * @param data Characters to compare with
+     * @param length Number of characters
+     * @return Negative, zero or positive like string::compare
+     */
+    int compare(const char* data, size_t length) const {
+        int result = memcmp(text, data, min(size(), length));
+        if (result != 0) {
+            return result;
+        }
+        return size() < length ? -1 : (size() > length ? 1 : 0);
     }
 
-    // Constructor that accepts an Employee object
-    Node(Employee e) : employee(e), left(nullptr), right(nullptr), height(1) {}
+    bool startsWith(const char* prefix) const {
+        size_t length = strlen(prefix);
+        return length <= size() && memcmp(text, prefix, length) == 0;
+    }
 };
 
-//============================================================================
-// Binary Search Tree class definition
-//============================================================================
+inline bool operator==(const StringView& a, const StringView& b) { return a.compare(b.data(), b.size()) == 0; }
+inline bool operator==(const StringView& a, const string& b) { return a.compare(b.data(), b.size()) == 0; }
+inline bool operator==(const string& a, const StringView& b) { return b == a; }
+inline bool operator!=(const StringView& a, const StringView& b) { return !(a == b); }
+inline bool operator!=(const StringView& a, const string& b) { return !(a == b); }
+inline bool operator!=(const string& a, const StringView& b) { return !(b == a); }
+inline bool operator<(const StringView& a, const StringView& b) { return a.compare(b.data(), b.size()) < 0; }
+inline bool operator<(const StringView& a, const string& b) { return a.compare(b.data(), b.size()) < 0; }
+inline bool operator<(const string& a, const StringView& b) { return b.compare(a.data(), a.size()) > 0; }
+inline bool operator>(const StringView& a, const StringView& b) { return b < a; }
+inline bool operator>(const StringView& a, const string& b) { return b < a; }
+inline bool operator>(const string& a, const StringView& b) { return b < a; }
 
-class BinarySearchTree {
+inline ostream& operator<<(ostream& out, const StringView& view) {
+    return out.write(view.data(), static_cast<streamsize>(view.size()));
+}
+
+/**
+ * FNV-1a hash of a view's characters
+ *
+ * @param view The text to hash
+ * @return Hash value
+ */
+inline size_t hashText(const StringView& view) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < view.size(); ++i) {
+        h = (h ^ static_cast<unsigned char>(view[i])) * 1099511628211ULL;
+    }
+    return static_cast<size_t>(h ^ (h >> 32));
+}
+
+/**
+ * Lower-case a string so lookups on names and categories ignore case
+ *
+ * @param value The string to fold
+ * @return Copy of the string with ASCII letters lower-cased
+ */
+string foldCase(const string& value) {
+    string folded = value;
+    for (size_t i = 0; i < folded.size(); ++i) {
+        folded[i] = static_cast<char>(tolower(static_cast<unsigned char>(folded[i])));
+    }
+    return folded;
+}
+
+// How an index matches field values
+enum class ValueMatch {
+    IGNORE_CASE,  // Names typed by users, such as departments and skills
+    EXACT         // Values already stored in one form, such as manager IDs
+};
 
+/**
+ * Bump-pointer allocator for strings that live as long as the arena.
+ * Text is copied into large blocks one after another, so millions of short
+ * names cost a handful of allocations. Nothing is freed individually; text
+ * of removed or changed employees stays until the arena is destroyed, which
+ * BinarySearchTree::compactStore arranges once enough of it is unused.
+ */
+class StringArena {
 private:
-    Node* root;
+    static const size_t BLOCK_SIZE = 1 << 20;
 
-    Employee searchNode(Node* node, string employeeId);
-    void printEmployeeList(Node* node);
-    void destroyTree(Node* node);
-    Node* copyTree(Node* node);  // Helper to deep copy a tree
+    vector<char*> blocks;
+    char* cursor;
+    size_t remaining;
+    size_t usedBytes;
+    size_t reservedBytes;
 
-    // AVL helper functions:
-    int getHeight(Node* node);
-    int getBalance(Node* node);
-    void updateHeight(Node* node);
-    Node* rotateRight(Node* y);
-    Node* rotateLeft(Node* x);
-    Node* insertNodeAVL(Node* node, Employee employee);  // AVL insert
+public:
+    StringArena() : cursor(nullptr), remaining(0), usedBytes(0), reservedBytes(0) {}
+    ~StringArena() {
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            delete[] blocks[i];
+        }
+    }
+    StringArena(const StringArena&) = delete;
+    StringArena& operator=(const StringArena&) = delete;
+
+    /**
+     * Copy characters into the arena
+     *
+     * @param data Characters to copy
+     * @param length Number of characters
+     * @return View of the stored copy
+     */
+    StringView store(const char* data, size_t length) {
+        if (length == 0) {
+            return StringView();
+        }
+        if (length > remaining) {
+            // Oversized strings get a block of their own so the current block keeps its space
+            size_t blockSize = length > BLOCK_SIZE / 4 ? length : static_cast<size_t>(BLOCK_SIZE);
+            char* block = new char[blockSize];
+            blocks.push_back(block);
+            reservedBytes += blockSize;
+            if (blockSize != length) {
+                cursor = block;
+                remaining = blockSize;
+            }
+            else {
+                memcpy(block, data, length);
+                usedBytes += length;
+                return StringView(block, length);
+            }
+        }
+        char* copy = cursor;
+        memcpy(copy, data, length);
+        cursor += length;
+        remaining -= length;
+        usedBytes += length;
+        return StringView(copy, length);
+    }
+
+    StringView store(const string& value) { return store(value.data(), value.size()); }
+
+    size_t blockCount() const { return blocks.size(); }
+    size_t bytesUsed() const { return usedBytes; }
+    size_t bytesReserved() const { return reservedBytes; }
+};
+
+/**
+ * Intern table that maps each distinct string to a small integer id.
+ * Values are stored exactly (case is preserved) and id 0 is always the
+ * empty string, so a zeroed field reads back as "not set". Values live in
+ * a deque, so references returned by value() stay valid as the table grows.
+ * Unless values are matched exactly, values that differ only in case form
+ * one group named by the id of the spelling seen first; indexes keep their
+ * rows by group id, so grouping costs an array read per record.
+ */
+class StringDictionary {
+private:
+    unordered_map<string, uint32_t> ids;
+    deque<string> values;
+    string probe;  // Reused key for view lookups, so they do not allocate
+    ValueMatch match;
+    unordered_map<string, uint32_t> groupIds;  // Lower-cased value -> group id, unless matched exactly
+    vector<uint32_t> groups;                   // Id -> group id, unless matched exactly
 
 public:
-    BinarySearchTree();
-    ~BinarySearchTree();
-    BinarySearchTree(const BinarySearchTree& other);                    // Copy constructor
-    BinarySearchTree& operator=(const BinarySearchTree& other);        // Assignment operator
-    void displayEmployee(const Employee& employee);
-    void addEmployee(Employee employee);
-    void printEmployeeList();
-    Employee findEmployeeById(string employeeId);
+    explicit StringDictionary(ValueMatch valueMatch = ValueMatch::IGNORE_CASE) : match(valueMatch) {
+        values.push_back("");
+        ids[""] = 0;
+        if (match == ValueMatch::IGNORE_CASE) {
+            groupIds[""] = 0;
+            groups.push_back(0);
+        }
+    }
+
+    /**
+     * Get the id of a value, adding it if it is new
+     *
+     * @param value The string to intern
+     * @return Id of the value
+     */
+    uint32_t intern(const string& value) {
+        unordered_map<string, uint32_t>::const_iterator it = ids.find(value);
+        if (it != ids.end()) {
+            return it->second;
+        }
+        uint32_t id = static_cast<uint32_t>(values.size());
+        values.push_back(value);
+        ids[value] = id;
+        if (match == ValueMatch::IGNORE_CASE) {
+            groups.push_back(groupIds.insert(make_pair(foldCase(value), id)).first->second);
+        }
+        return id;
+    }
+
+    uint32_t intern(const StringView& value) {
+        probe.assign(value.data(), value.size());
+        return intern(probe);
+    }
+
+    /**
+     * Find the id of a value without adding it
+     *
+     * @param value The string to look up
+     * @param id Receives the id when found
+     * @return True if the value has been interned
+     */
+    bool find(const string& value, uint32_t& id) const {
+        unordered_map<string, uint32_t>::const_iterator it = ids.find(value);
+        if (it == ids.end()) {
+            return false;
+        }
+        id = it->second;
+        return true;
+    }
+
+    /**
+     * Find the group of a value the way the table matches values, such as
+     * a department typed in any case
+     *
+     * @param value The string to look up
+     * @param groupId Receives the group id when found
+     * @return True if the value, or one of its spellings, has been interned
+     */
+    bool findGroup(const string& value, uint32_t& groupId) const {
+        if (match == ValueMatch::EXACT) {
+            return find(value, groupId);
+        }
+        unordered_map<string, uint32_t>::const_iterator it = groupIds.find(foldCase(value));
+        if (it == groupIds.end()) {
+            return false;
+        }
+        groupId = it->second;
+        return true;
+    }
+
+    uint32_t group(uint32_t id) const { return match == ValueMatch::EXACT ? id : groups[id]; }
+    const string& value(uint32_t id) const { return values[id]; }
+    size_t size() const { return values.size(); }
+
+    /**
+     * Approximate heap footprint of the table
+     *
+     * @return Bytes used by the stored values and the hash maps
+     */
+    size_t memoryBytes() const {
+        size_t bytes = values.size() * sizeof(string) + ids.bucket_count() * sizeof(void*);
+        for (size_t i = 0; i < values.size(); ++i) {
+            bytes += 2 * (values[i].capacity() + 1) + sizeof(pair<const string, uint32_t>) + 2 * sizeof(void*);
+        }
+        if (match == ValueMatch::IGNORE_CASE) {
+            bytes += groups.capacity() * sizeof(uint32_t) + groupIds.bucket_count() * sizeof(void*) +
+                     groupIds.size() * (sizeof(pair<const string, uint32_t>) + 2 * sizeof(void*));
+        }
+        return bytes;
+    }
 };
 
 /**
- * Default constructor
+ * Text arena and intern tables behind a set of employee records. Each tree
+ * starts a fresh one whenever its data is replaced, and the tree and every
+ * record built in the store hold a reference to it, so the text and values
+ * of a dataset are freed with the last of them.
  */
-BinarySearchTree::BinarySearchTree() {
-    // Initialize empty tree
-    root = nullptr;
-}
+struct EmployeeStore {
+    StringArena text;             // Every employee's ID and name
+    StringDictionary departments;
+    StringDictionary titles;
+    StringDictionary managers;    // Manager IDs, upper case, matched exactly
+    StringDictionary skills;
+
+    EmployeeStore() : managers(ValueMatch::EXACT) {}
+    EmployeeStore(const EmployeeStore&) = delete;
+    EmployeeStore& operator=(const EmployeeStore&) = delete;
+};
 
 /**
- * Display employee information
- *
- * @param employee The employee object containing the ID, name, department, title, manager, and skills
+ * An employee's skills as 16-bit ids into a skill dictionary, kept in input
+ * order. Up to six ids are stored inline, so typical records need no heap
+ * allocation. A 64-bit mask with bit (id % 64) set for every id answers
+ * most membership and overlap checks with one AND; when every id is below
+ * 64 the mask is exact and overlap is a single popcount.
  */
-void BinarySearchTree::displayEmployee(const Employee& employee) {
-    cout << "Employee ID: " << employee.employeeId << endl;
-    cout << "Full Name: " << employee.fullName << endl;
-    cout << "Department: " << employee.department << endl;
-    cout << "Title: " << employee.title << endl;
-    cout << "Manager ID: ";
+class SkillSet {
+private:
+    static const size_t INLINE_CAPACITY = 6;
 
-    // If there is no manager, output "None" (for executives)
-    if (employee.managerId.empty()) {
-        cout << "None (Executive Level)";
+    uint64_t mask;
+    uint16_t count;
+    uint8_t wide;              // 1 once any id is 64 or above (mask is then a filter only)
+    uint8_t heapCapacityLog;   // 0 while ids are inline, else log2 of the heap capacity
+    union {
+        uint16_t inlineIds[INLINE_CAPACITY];
+        uint16_t* heapIds;
+    };
+
+    uint16_t* ids() { return heapCapacityLog == 0 ? inlineIds : heapIds; }
+    const uint16_t* ids() const { return heapCapacityLog == 0 ? inlineIds : heapIds; }
+    static uint64_t bit(uint16_t id) { return static_cast<uint64_t>(1) << (id & 63); }
+
+    void copyFrom(const SkillSet& other) {
+        mask = other.mask;
+        count = other.count;
+        wide = other.wide;
+        heapCapacityLog = other.heapCapacityLog;
+        if (heapCapacityLog == 0) {
+            memcpy(inlineIds, other.inlineIds, sizeof(inlineIds));
+        }
+        else {
+            heapIds = new uint16_t[static_cast<size_t>(1) << heapCapacityLog];
+            memcpy(heapIds, other.heapIds, count * sizeof(uint16_t));
+        }
     }
-    else {
-        cout << employee.managerId;
+
+    void release() {
+        if (heapCapacityLog != 0) {
+            delete[] heapIds;
+        }
+        heapCapacityLog = 0;
     }
-    cout << endl;
 
-    cout << "Skills: ";
-    // If there are no skills, output "None"
-    if (employee.skills.empty()) {
-        cout << "None";
+public:
+    SkillSet() : mask(0), count(0), wide(0), heapCapacityLog(0) {
+        memset(inlineIds, 0, sizeof(inlineIds));
     }
-    // Else output all skills
-    else {
-        for (size_t i = 0; i < employee.skills.size(); ++i) {
-            cout << employee.skills[i];
-            if (i < employee.skills.size() - 1) {
-                cout << ", ";  // Add comma between skills
+    SkillSet(const SkillSet& other) { copyFrom(other); }
+    SkillSet(SkillSet&& other) : mask(other.mask), count(other.count), wide(other.wide),
+                                 heapCapacityLog(other.heapCapacityLog) {
+        memcpy(inlineIds, other.inlineIds, sizeof(inlineIds));  // Also moves the heap pointer
+        other.heapCapacityLog = 0;
+        other.count = 0;
+        other.mask = 0;
+    }
+    ~SkillSet() { release(); }
+
+    SkillSet& operator=(const SkillSet& other) {
+        if (this != &other) {
+            release();
+            copyFrom(other);
+        }
+        return *this;
+    }
+
+    SkillSet& operator=(SkillSet&& other) {
+        if (this != &other) {
+            release();
+            mask = other.mask;
+            count = other.count;
+            wide = other.wide;
+            heapCapacityLog = other.heapCapacityLog;
+            memcpy(inlineIds, other.inlineIds, sizeof(inlineIds));
+            other.heapCapacityLog = 0;
+            other.count = 0;
+            other.mask = 0;
+        }
+        return *this;
+    }
+
+    /**
+     * Add a skill id; ids already present are ignored
+     *
+     * @param id The skill's dictionary id
+     */
+    void add(uint16_t id) {
+        if (contains(id)) {
+            return;
+        }
+        size_t capacity = heapCapacityLog == 0 ? INLINE_CAPACITY : static_cast<size_t>(1) << heapCapacityLog;
+        if (count == capacity) {
+            uint8_t grownLog = heapCapacityLog == 0 ? 4 : static_cast<uint8_t>(heapCapacityLog + 1);
+            uint16_t* grown = new uint16_t[static_cast<size_t>(1) << grownLog];
+            memcpy(grown, ids(), count * sizeof(uint16_t));
+            release();
+            heapIds = grown;
+            heapCapacityLog = grownLog;
+        }
+        ids()[count++] = id;
+        mask |= bit(id);
+        wide |= id >= 64 ? 1 : 0;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    uint16_t operator[](size_t i) const { return ids()[i]; }
+
+    /**
+     * Check whether a skill id is in the set
+     *
+     * @param id The skill's dictionary id
+     * @return True if present
+     */
+    bool contains(uint16_t id) const {
+        if ((mask & bit(id)) == 0) {
+            return false;
+        }
+        if (!wide) {
+            return id < 64;
+        }
+        const uint16_t* values = ids();
+        for (size_t i = 0; i < count; ++i) {
+            if (values[i] == id) {
+                return true;
             }
         }
+        return false;
     }
-    cout << endl;
-}
+
+    /**
+     * Number of skills two sets have in common
+     *
+     * @param other The set to compare with
+     * @return Size of the intersection
+     */
+    size_t overlapCount(const SkillSet& other) const {
+        uint64_t shared = mask & other.mask;
+        if (shared == 0) {
+            return 0;
+        }
+        if (!wide && !other.wide) {
+            return popCount64(shared);
+        }
+        const SkillSet& small = count <= other.count ? *this : other;
+        const SkillSet& large = count <= other.count ? other : *this;
+        size_t overlap = 0;
+        for (size_t i = 0; i < small.count; ++i) {
+            overlap += large.contains(small[i]) ? 1 : 0;
+        }
+        return overlap;
+    }
+
+    bool intersects(const SkillSet& other) const {
+        if ((mask & other.mask) == 0) {
+            return false;
+        }
+        return (!wide && !other.wide) || overlapCount(other) > 0;
+    }
+
+    // Heap bytes used beyond the object itself
+    size_t heapBytes() const {
+        return heapCapacityLog == 0 ? 0 : (static_cast<size_t>(1) << heapCapacityLog) * sizeof(uint16_t);
+    }
+};
 
 /**
- * Insert a new employee into the AVL tree
+ * Manager references are stored in upper case, the way IDs are typed at
+ * the prompt, so every lookup of a manager matches the stored form exactly
  *
- * @param employee The employee object to be added to the tree
+ * @param value The manager ID as written in the input
+ * @return The ID in upper case
  */
-void BinarySearchTree::addEmployee(Employee employee) {
-    root = insertNodeAVL(root, employee);  // Use AVL insertion and update root
+string normalizeManagerId(const StringView& value) {
+    string normalized(value.data(), value.size());
+    transform(normalized.begin(), normalized.end(), normalized.begin(), ::toupper);
+    return normalized;
 }
 
 /**
- * Searches the tree for a specific employee by their ID
+ * Employee record. The ID and name are views into its store's text arena.
+ * Department, title, manager and skills repeat across many employees, so
+ * they are stored as ids into the store's intern tables and read back
+ * through accessors; two records of one store share a value exactly when
+ * they hold the same id. Copying a record copies no text; each copy
+ * shares ownership of the store instead.
  */
-Employee BinarySearchTree::findEmployeeById(string employeeId) {
-    // Begin the search from the root
-    return searchNode(root, employeeId);
-}
+struct Employee {
+    StringView employeeId;   // Stored in store->text
+    StringView fullName;     // Stored in store->text
+    uint32_t departmentId;   // Id in store->departments
+    uint32_t titleId;        // Id in store->titles
+    uint32_t managerKey;     // Id in store->managers, upper case
+    SkillSet skills;         // Ids in store->skills, in input order
+    shared_ptr<EmployeeStore> store;
 
-/**
- * Helper function to search for an employee by their ID
+    explicit Employee(const shared_ptr<EmployeeStore>& owner) : departmentId(0), titleId(0), managerKey(0), store(owner) {}
+
+    const string& department() const { return store->departments.value(departmentId); }
+    const string& title() const { return store->titles.value(titleId); }
+    const string& managerId() const { return store->managers.value(managerKey); }
+    const string& skill(size_t i) const { return store->skills.value(skills[i]); }
+    size_t skillCount() const { return skills.size(); }
+
+    void setEmployeeId(const StringView& value) { employeeId = store->text.store(value.data(), value.size()); }
+    void setFullName(const StringView& value) { fullName = store->text.store(value.data(), value.size()); }
+    void setDepartment(const StringView& value) { departmentId = store->departments.intern(value); }
+    void setTitle(const StringView& value) { titleId = store->titles.intern(value); }
+    void setManagerId(const StringView& value) { managerKey = store->managers.intern(normalizeManagerId(value)); }
+    void setEmployeeId(const string& value) { setEmployeeId(StringView(value)); }
+    void setFullName(const string& value) { setFullName(StringView(value)); }
+    void setDepartment(const string& value) { setDepartment(StringView(value)); }
+    void setTitle(const string& value) { setTitle(StringView(value)); }
+    void setManagerId(const string& value) { setManagerId(StringView(value)); }
+    void addSkill(const string& value) { addSkill(StringView(value)); }
+    void addSkill(const StringView& value) {
+        // Ids are 16 bits: once they run out only known skills are accepted, so a rejected one takes no slot
+        StringDictionary& dictionary = store->skills;
+        uint32_t id;
+        if (dictionary.size() <= 0xFFFF) {
+            id = dictionary.intern(value);
+        }
+        else if (!dictionary.find(value.str(), id)) {
+            cout << "Warning: Too many distinct skills, ignoring " << value << endl;
+            return;
+        }
+        skills.add(static_cast<uint16_t>(id));
+    }
+
+    /**
+     * Copy the record's text and values into another store, if it is not
+     * already there
+     *
+     * @param target The store the record should live in
+     */
+    void moveToStore(const shared_ptr<EmployeeStore>& target) {
+        if (store == target) {
+            return;
+        }
+        Employee copy(target);
+        copy.setEmployeeId(employeeId);
+        copy.setFullName(fullName);
+        copy.setDepartment(department());
+        copy.setTitle(title());
+        copy.managerKey = target->managers.intern(managerId());
+        for (size_t i = 0; i < skillCount(); ++i) {
+            copy.addSkill(skill(i));
+        }
+        *this = copy;
+    }
+};
+
+// Fields of one CSV record, as views into the record, before they are stored in an Employee
+struct EmployeeFields {
+    StringView employeeId;
+    StringView fullName;
+    StringView department;
+    StringView title;
+    StringView managerId;
+    StringView skills;  // The whole skills field, still comma-separated
+};
+
+// Internal structure for the tree
+struct Node {
+    Employee employee;
+    Node* left;
+    Node* right;
+    int height;      // Height of subtree rooted at this node
+    uint32_t rowId;  // Position in the tree's row table, used by secondary indexes
+
+    // Constructor that accepts an Employee object
+    Node(Employee e) : employee(e), left(nullptr), right(nullptr), height(1), rowId(0) {}
+};
+
+// Selects which structure answers lookups and ordered listings
+enum class IndexBackend {
+    AVL,    // Compare whole IDs at every level of the AVL tree
+    RADIX   // Walk the ID byte by byte through an adaptive radix tree
+};
+
+//============================================================================
+// Adaptive Radix Tree (ART) class definition
+//============================================================================
+
+/*
+ * Radix tree keyed on the bytes of the employee ID. Inner nodes switch between
+ * four layouts (Node4, Node16, Node48 and Node256) as their fan-out changes, and
+ * runs of bytes shared by every key below a node (such as "EMP0") are stored
+ * once as that node's prefix. A lookup therefore costs one step per
+ * distinguishing key byte rather than one full string comparison per level.
  *
- * @param node The current node in the tree
- * @param employeeId The ID of the employee to be found
- * @return The employee being searched, or an empty Employee object if not found
+ * The tree does not own the employee records: each leaf points at the AVL node
+ * holding the employee and reads its key from that node's ID rather than
+ * keeping a copy, so it is rebuilt whenever the AVL nodes are copied and a
+ * key must be removed before its node is freed. Keys are treated as if
+ * terminated by a 0 byte so that no key is a prefix of another.
  */
-Employee BinarySearchTree::searchNode(Node* node, string employeeId) {
-    // Start at the root
-    Node* cur = root;
+class AdaptiveRadixTree {
 
-    // Keep looping downwards until we find the matching employeeId or reach the bottom of the tree
-    while (cur != nullptr) {
-        // Check if we found the employee
-        if (employeeId == cur->employee.employeeId) {
-            return cur->employee;  // Return the found employee
-        }
-        // If the employeeId is smaller than the current node's employeeId, move left
-        else if (employeeId < cur->employee.employeeId) {
-            cur = cur->left;
+private:
+    enum NodeType : uint8_t { LEAF, NODE4, NODE16, NODE48, NODE256 };
+
+    struct ArtNode {
+        NodeType type;
+        explicit ArtNode(NodeType t) : type(t) {}
+    };
+
+    struct ArtLeaf : ArtNode {
+        Node* value;  // Also holds the key, as value->employee.employeeId
+        explicit ArtLeaf(Node* v) : ArtNode(LEAF), value(v) {}
+        const StringView& key() const { return value->employee.employeeId; }
+    };
+
+    struct ArtInner : ArtNode {
+        uint16_t childCount;
+        string prefix;  // Compressed path shared by every key below this node
+        explicit ArtInner(NodeType t) : ArtNode(t), childCount(0) {}
+    };
+
+    // Up to 4 children, keys kept sorted
+    struct ArtNode4 : ArtInner {
+        unsigned char keys[4];
+        ArtNode* children[4];
+        ArtNode4() : ArtInner(NODE4) {}
+    };
+
+    // Up to 16 children, keys kept sorted and searched with SIMD
+    struct ArtNode16 : ArtInner {
+        unsigned char keys[16];
+        ArtNode* children[16];
+        ArtNode16() : ArtInner(NODE16) {}
+    };
+
+    // Up to 48 children, indexed through a 256-entry byte map (0 = empty, else slot + 1)
+    struct ArtNode48 : ArtInner {
+        unsigned char childIndex[256];
+        ArtNode* children[48];
+        ArtNode48() : ArtInner(NODE48) {
+            memset(childIndex, 0, sizeof(childIndex));
+            memset(children, 0, sizeof(children));
         }
-        // If the employeeId is larger than the current node's employeeId, move right
-        else {
-            cur = cur->right;
+    };
+
+    // One child pointer per possible byte
+    struct ArtNode256 : ArtInner {
+        ArtNode* children[256];
+        ArtNode256() : ArtInner(NODE256) {
+            memset(children, 0, sizeof(children));
         }
+    };
+
+    ArtNode* root;
+    size_t count;
+
+    static unsigned char keyByte(const string& key, size_t depth);
+    static unsigned char keyByte(const StringView& key, size_t depth);
+    static ArtNode** findChild(ArtInner* node, unsigned char byte);
+    static void addChild(ArtNode*& ref, unsigned char byte, ArtNode* child);
+    static void removeChild(ArtNode*& ref, unsigned char byte);
+    static void freeNode(ArtNode* node);
+
+    bool insertRecursive(ArtNode*& ref, const string& key, size_t depth, Node* value);
+    bool removeRecursive(ArtNode*& ref, const string& key, size_t depth);
+
+    template <typename Visitor>
+    static void forEachRecursive(const ArtNode* node, Visitor& visit);
+
+public:
+    AdaptiveRadixTree();
+    ~AdaptiveRadixTree();
+    AdaptiveRadixTree(const AdaptiveRadixTree&) = delete;             // Leaves point into a specific AVL tree
+    AdaptiveRadixTree& operator=(const AdaptiveRadixTree&) = delete;
+    void insert(const string& key, Node* value);
+    bool remove(const string& key);
+    Node* find(const string& key) const;
+    void clear();
+    size_t size() const;
+
+    /**
+     * Visit every indexed node in ascending key order
+     *
+     * @param visit Callable invoked with each Node*
+     */
+    template <typename Visitor>
+    void forEach(Visitor visit) const {
+        forEachRecursive(root, visit);
     }
+};
 
-    // If no employee is found, return an empty Employee object
-    return Employee();
-}
+/**
+ * Default constructor
+ */
+AdaptiveRadixTree::AdaptiveRadixTree() : root(nullptr), count(0) {}
 
 /**
- * Prints the list of employees in the tree in alphanumeric order
+ * Destructor - frees every inner node and leaf (the AVL nodes are not owned)
  */
-void BinarySearchTree::printEmployeeList() {
-    // In order traversal starting from the root
-    printEmployeeList(root);
+AdaptiveRadixTree::~AdaptiveRadixTree() {
+    freeNode(root);
 }
 
 /**
- * Helper function that prints the employees in alphanumeric order using in-order traversal
- *
- * @param node The current node in the tree
+ * Remove all keys from the index
  */
-void BinarySearchTree::printEmployeeList(Node* node) {
-    if (node != nullptr) {
-        printEmployeeList(node->left);  // Traverse the left subtree
-        displayEmployee(node->employee);  // Output employee details
-        cout << endl; // Add a new line between employees
-        printEmployeeList(node->right);  // Traverse the right subtree
-    }
+void AdaptiveRadixTree::clear() {
+    freeNode(root);
+    root = nullptr;
+    count = 0;
 }
 
 /**
- * Destructor - prevents memory leaks by cleaning up all nodes
+ * Number of keys currently indexed
  */
-BinarySearchTree::~BinarySearchTree() {
+size_t AdaptiveRadixTree::size() const {
+    return count;
+}
+
+/**
+ * Byte of the key at the given depth, with an implicit 0 terminator
+ *
+ * @param key The key being walked
+ * @param depth Byte position in the key
+ * @return The key byte, or 0 once past the end of the key
+ */
+unsigned char AdaptiveRadixTree::keyByte(const string& key, size_t depth) {
+    return depth < key.size() ? static_cast<unsigned char>(key[depth]) : 0;
+}
+
+unsigned char AdaptiveRadixTree::keyByte(const StringView& key, size_t depth) {
+    return depth < key.size() ? static_cast<unsigned char>(key[depth]) : 0;
+}
+
+/**
+ * Locate the child slot for a key byte
+ *
+ * @param node The inner node to search
+ * @param byte The key byte to look for
+ * @return Pointer to the child slot, or nullptr if there is no such child
+ */
+AdaptiveRadixTree::ArtNode** AdaptiveRadixTree::findChild(ArtInner* node, unsigned char byte) {
+    switch (node->type) {
+    case NODE4: {
+        ArtNode4* n = static_cast<ArtNode4*>(node);
+        for (unsigned i = 0; i < n->childCount; ++i) {
+            if (n->keys[i] == byte) {
+                return &n->children[i];
+            }
+        }
+        return nullptr;
+    }
+    case NODE16: {
+        ArtNode16* n = static_cast<ArtNode16*>(node);
+#ifdef EMPLOYEE_HAVE_SSE2
+        // Compare the byte against all 16 keys in one instruction
+        __m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(byte)),
+                                     _mm_loadu_si128(reinterpret_cast<const __m128i*>(n->keys)));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(cmp)) & ((1u << n->childCount) - 1);
+        return mask ? &n->children[countTrailingZeros(mask)] : nullptr;
+#else
+        for (unsigned i = 0; i < n->childCount; ++i) {
+            if (n->keys[i] == byte) {
+                return &n->children[i];
+            }
+        }
+        return nullptr;
+#endif
+    }
+    case NODE48: {
+        ArtNode48* n = static_cast<ArtNode48*>(node);
+        unsigned char slot = n->childIndex[byte];
+        return slot ? &n->children[slot - 1] : nullptr;
+    }
+    case NODE256: {
+        ArtNode256* n = static_cast<ArtNode256*>(node);
+        return n->children[byte] ? &n->children[byte] : nullptr;
+    }
+    default:
+        return nullptr;
+    }
+}
+
+/**
+ * Add a child to an inner node, growing it to the next layout when full
+ *
+ * @param ref Reference to the slot holding the inner node (updated on growth)
+ * @param byte The key byte the child is reached by
+ * @param child The child to add
+ */
+void AdaptiveRadixTree::addChild(ArtNode*& ref, unsigned char byte, ArtNode* child) {
+    switch (ref->type) {
+    case NODE4: {
+        ArtNode4* n = static_cast<ArtNode4*>(ref);
+        if (n->childCount < 4) {
+            // Shift larger keys right to keep the keys sorted
+            unsigned pos = 0;
+            while (pos < n->childCount && n->keys[pos] < byte) {
+                pos++;
+            }
+            for (unsigned i = n->childCount; i > pos; --i) {
+                n->keys[i] = n->keys[i - 1];
+                n->children[i] = n->children[i - 1];
+            }
+            n->keys[pos] = byte;
+            n->children[pos] = child;
+            n->childCount++;
+            return;
+        }
+        // Grow to Node16
+        ArtNode16* grown = new ArtNode16();
+        grown->prefix = n->prefix;
+        grown->childCount = n->childCount;
+        memcpy(grown->keys, n->keys, sizeof(n->keys));
+        memcpy(grown->children, n->children, sizeof(n->children));
+        delete n;
+        ref = grown;
+        addChild(ref, byte, child);
+        return;
+    }
+    case NODE16: {
+        ArtNode16* n = static_cast<ArtNode16*>(ref);
+        if (n->childCount < 16) {
+            unsigned pos = 0;
+            while (pos < n->childCount && n->keys[pos] < byte) {
+                pos++;
+            }
+            for (unsigned i = n->childCount; i > pos; --i) {
+                n->keys[i] = n->keys[i - 1];
+                n->children[i] = n->children[i - 1];
+            }
+            n->keys[pos] = byte;
+            n->children[pos] = child;
+            n->childCount++;
+            return;
+        }
+        // Grow to Node48
+        ArtNode48* grown = new ArtNode48();
+        grown->prefix = n->prefix;
+        grown->childCount = n->childCount;
+        for (unsigned i = 0; i < n->childCount; ++i) {
+            grown->children[i] = n->children[i];
+            grown->childIndex[n->keys[i]] = static_cast<unsigned char>(i + 1);
+        }
+        delete n;
+        ref = grown;
+        addChild(ref, byte, child);
+        return;
+    }
+    case NODE48: {
+        ArtNode48* n = static_cast<ArtNode48*>(ref);
+        if (n->childCount < 48) {
+            // Removals can leave holes, so take the first free slot
+            unsigned slot = 0;
+            while (n->children[slot] != nullptr) {
+                slot++;
+            }
+            n->children[slot] = child;
+            n->childIndex[byte] = static_cast<unsigned char>(slot + 1);
+            n->childCount++;
+            return;
+        }
+        // Grow to Node256
+        ArtNode256* grown = new ArtNode256();
+        grown->prefix = n->prefix;
+        grown->childCount = n->childCount;
+        for (unsigned b = 0; b < 256; ++b) {
+            if (n->childIndex[b]) {
+                grown->children[b] = n->children[n->childIndex[b] - 1];
+            }
+        }
+        delete n;
+        ref = grown;
+        addChild(ref, byte, child);
+        return;
+    }
+    case NODE256: {
+        ArtNode256* n = static_cast<ArtNode256*>(ref);
+        n->children[byte] = child;
+        n->childCount++;
+        return;
+    }
+    default:
+        return;
+    }
+}
+
+/**
+ * Remove a child from an inner node, shrinking it to a smaller layout when sparse
+ *
+ * @param ref Reference to the slot holding the inner node (updated on shrink)
+ * @param byte The key byte of the child to remove
+ */
+void AdaptiveRadixTree::removeChild(ArtNode*& ref, unsigned char byte) {
+    switch (ref->type) {
+    case NODE4: {
+        ArtNode4* n = static_cast<ArtNode4*>(ref);
+        unsigned pos = 0;
+        while (pos < n->childCount && n->keys[pos] != byte) {
+            pos++;
+        }
+        for (unsigned i = pos + 1; i < n->childCount; ++i) {
+            n->keys[i - 1] = n->keys[i];
+            n->children[i - 1] = n->children[i];
+        }
+        n->childCount--;
+
+        // A single remaining child absorbs this node into its own prefix
+        if (n->childCount == 1) {
+            ArtNode* only = n->children[0];
+            if (only->type != LEAF) {
+                ArtInner* inner = static_cast<ArtInner*>(only);
+                inner->prefix = n->prefix + static_cast<char>(n->keys[0]) + inner->prefix;
+            }
+            delete n;
+            ref = only;
+        }
+        return;
+    }
+    case NODE16: {
+        ArtNode16* n = static_cast<ArtNode16*>(ref);
+        unsigned pos = 0;
+        while (pos < n->childCount && n->keys[pos] != byte) {
+            pos++;
+        }
+        for (unsigned i = pos + 1; i < n->childCount; ++i) {
+            n->keys[i - 1] = n->keys[i];
+            n->children[i - 1] = n->children[i];
+        }
+        n->childCount--;
+
+        if (n->childCount == 3) {
+            ArtNode4* shrunk = new ArtNode4();
+            shrunk->prefix = n->prefix;
+            shrunk->childCount = n->childCount;
+            memcpy(shrunk->keys, n->keys, 3);
+            memcpy(shrunk->children, n->children, 3 * sizeof(ArtNode*));
+            delete n;
+            ref = shrunk;
+        }
+        return;
+    }
+    case NODE48: {
+        ArtNode48* n = static_cast<ArtNode48*>(ref);
+        n->children[n->childIndex[byte] - 1] = nullptr;
+        n->childIndex[byte] = 0;
+        n->childCount--;
+
+        if (n->childCount == 12) {
+            ArtNode16* shrunk = new ArtNode16();
+            shrunk->prefix = n->prefix;
+            for (unsigned b = 0; b < 256; ++b) {
+                if (n->childIndex[b]) {
+                    shrunk->keys[shrunk->childCount] = static_cast<unsigned char>(b);
+                    shrunk->children[shrunk->childCount] = n->children[n->childIndex[b] - 1];
+                    shrunk->childCount++;
+                }
+            }
+            delete n;
+            ref = shrunk;
+        }
+        return;
+    }
+    case NODE256: {
+        ArtNode256* n = static_cast<ArtNode256*>(ref);
+        n->children[byte] = nullptr;
+        n->childCount--;
+
+        if (n->childCount == 37) {
+            ArtNode48* shrunk = new ArtNode48();
+            shrunk->prefix = n->prefix;
+            for (unsigned b = 0; b < 256; ++b) {
+                if (n->children[b]) {
+                    shrunk->children[shrunk->childCount] = n->children[b];
+                    shrunk->childIndex[b] = static_cast<unsigned char>(shrunk->childCount + 1);
+                    shrunk->childCount++;
+                }
+            }
+            delete n;
+            ref = shrunk;
+        }
+        return;
+    }
+    default:
+        return;
+    }
+}
+
+/**
+ * Recursively free a node and everything below it
+ *
+ * @param node The node to free
+ */
+void AdaptiveRadixTree::freeNode(ArtNode* node) {
+    if (node == nullptr) {
+        return;
+    }
+
+    switch (node->type) {
+    case LEAF:
+        delete static_cast<ArtLeaf*>(node);
+        return;
+    case NODE4: {
+        ArtNode4* n = static_cast<ArtNode4*>(node);
+        for (unsigned i = 0; i < n->childCount; ++i) {
+            freeNode(n->children[i]);
+        }
+        delete n;
+        return;
+    }
+    case NODE16: {
+        ArtNode16* n = static_cast<ArtNode16*>(node);
+        for (unsigned i = 0; i < n->childCount; ++i) {
+            freeNode(n->children[i]);
+        }
+        delete n;
+        return;
+    }
+    case NODE48: {
+        ArtNode48* n = static_cast<ArtNode48*>(node);
+        for (unsigned i = 0; i < 48; ++i) {
+            freeNode(n->children[i]);
+        }
+        delete n;
+        return;
+    }
+    case NODE256: {
+        ArtNode256* n = static_cast<ArtNode256*>(node);
+        for (unsigned i = 0; i < 256; ++i) {
+            freeNode(n->children[i]);
+        }
+        delete n;
+        return;
+    }
+    }
+}
+
+/**
+ * Insert a key, replacing the value if the key already exists
+ *
+ * @param key The employee ID
+ * @param value The AVL node holding that employee
+ */
+void AdaptiveRadixTree::insert(const string& key, Node* value) {
+    if (insertRecursive(root, key, 0, value)) {
+        count++;
+    }
+}
+
+/**
+ * Helper function for insertion
+ *
+ * @param ref Reference to the slot being descended into
+ * @param key The key being inserted
+ * @param depth Number of key bytes already consumed
+ * @param value The value to store
+ * @return True if a new key was added, false if an existing one was replaced
+ */
+bool AdaptiveRadixTree::insertRecursive(ArtNode*& ref, const string& key, size_t depth, Node* value) {
+    // Empty slot - store the leaf directly (lazy expansion)
+    if (ref == nullptr) {
+        ref = new ArtLeaf(value);
+        return true;
+    }
+
+    // Reached a leaf - either replace it or split it into a Node4
+    if (ref->type == LEAF) {
+        ArtLeaf* leaf = static_cast<ArtLeaf*>(ref);
+        if (leaf->key() == key) {
+            leaf->value = value;
+            return false;
+        }
+
+        size_t mismatch = depth;
+        while (keyByte(leaf->key(), mismatch) == keyByte(key, mismatch)) {
+            mismatch++;
+        }
+
+        ArtNode4* split = new ArtNode4();
+        split->prefix = key.substr(depth, mismatch - depth);
+        ArtNode* splitRef = split;
+        addChild(splitRef, keyByte(leaf->key(), mismatch), leaf);
+        addChild(splitRef, keyByte(key, mismatch), new ArtLeaf(value));
+        ref = splitRef;
+        return true;
+    }
+
+    // Inner node - check how much of the compressed prefix matches
+    ArtInner* inner = static_cast<ArtInner*>(ref);
+    size_t matched = 0;
+    while (matched < inner->prefix.size() &&
+           static_cast<unsigned char>(inner->prefix[matched]) == keyByte(key, depth + matched)) {
+        matched++;
+    }
+
+    // Prefix diverges - insert a new Node4 above the current node
+    if (matched < inner->prefix.size()) {
+        ArtNode4* split = new ArtNode4();
+        split->prefix = inner->prefix.substr(0, matched);
+        unsigned char existingByte = static_cast<unsigned char>(inner->prefix[matched]);
+        inner->prefix.erase(0, matched + 1);
+        ArtNode* splitRef = split;
+        addChild(splitRef, existingByte, inner);
+        addChild(splitRef, keyByte(key, depth + matched), new ArtLeaf(value));
+        ref = splitRef;
+        return true;
+    }
+
+    depth += inner->prefix.size();
+    unsigned char byte = keyByte(key, depth);
+    ArtNode** child = findChild(inner, byte);
+    if (child != nullptr) {
+        return insertRecursive(*child, key, depth + 1, value);
+    }
+
+    addChild(ref, byte, new ArtLeaf(value));
+    return true;
+}
+
+/**
+ * Remove a key from the index
+ *
+ * @param key The employee ID to remove
+ * @return True if the key was present
+ */
+bool AdaptiveRadixTree::remove(const string& key) {
+    if (removeRecursive(root, key, 0)) {
+        count--;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Helper function for removal
+ *
+ * @param ref Reference to the slot being descended into
+ * @param key The key being removed
+ * @param depth Number of key bytes already consumed
+ * @return True if the key was found and removed
+ */
+bool AdaptiveRadixTree::removeRecursive(ArtNode*& ref, const string& key, size_t depth) {
+    if (ref == nullptr) {
+        return false;
+    }
+
+    // Only reachable when the whole tree is a single leaf
+    if (ref->type == LEAF) {
+        ArtLeaf* leaf = static_cast<ArtLeaf*>(ref);
+        if (leaf->key() != key) {
+            return false;
+        }
+        delete leaf;
+        ref = nullptr;
+        return true;
+    }
+
+    ArtInner* inner = static_cast<ArtInner*>(ref);
+    for (size_t i = 0; i < inner->prefix.size(); ++i) {
+        if (static_cast<unsigned char>(inner->prefix[i]) != keyByte(key, depth + i)) {
+            return false;
+        }
+    }
+    depth += inner->prefix.size();
+
+    unsigned char byte = keyByte(key, depth);
+    ArtNode** child = findChild(inner, byte);
+    if (child == nullptr) {
+        return false;
+    }
+
+    if ((*child)->type == LEAF) {
+        ArtLeaf* leaf = static_cast<ArtLeaf*>(*child);
+        if (leaf->key() != key) {
+            return false;
+        }
+        delete leaf;
+        removeChild(ref, byte);
+        return true;
+    }
+
+    return removeRecursive(*child, key, depth + 1);
+}
+
+/**
+ * Look up a key
+ *
+ * @param key The employee ID to find
+ * @return The AVL node holding the employee, or nullptr if not indexed
+ */
+Node* AdaptiveRadixTree::find(const string& key) const {
+    ArtNode* node = root;
+    size_t depth = 0;
+
+    while (node != nullptr) {
+        if (node->type == LEAF) {
+            ArtLeaf* leaf = static_cast<ArtLeaf*>(node);
+            return leaf->key() == key ? leaf->value : nullptr;
+        }
+
+        ArtInner* inner = static_cast<ArtInner*>(node);
+        for (size_t i = 0; i < inner->prefix.size(); ++i) {
+            if (static_cast<unsigned char>(inner->prefix[i]) != keyByte(key, depth + i)) {
+                return nullptr;
+            }
+        }
+        depth += inner->prefix.size();
+
+        // The terminator has already been consumed, so the key is too short
+        if (depth > key.size()) {
+            return nullptr;
+        }
+
+        ArtNode** child = findChild(inner, keyByte(key, depth));
+        node = child ? *child : nullptr;
+        depth++;
+    }
+
+    return nullptr;
+}
+
+/**
+ * Helper function that visits leaves in ascending key order
+ *
+ * @param node The current node
+ * @param visit Callable invoked with each Node*
+ */
+template <typename Visitor>
+void AdaptiveRadixTree::forEachRecursive(const ArtNode* node, Visitor& visit) {
+    if (node == nullptr) {
+        return;
+    }
+
+    switch (node->type) {
+    case LEAF:
+        visit(static_cast<const ArtLeaf*>(node)->value);
+        return;
+    case NODE4: {
+        const ArtNode4* n = static_cast<const ArtNode4*>(node);
+        for (unsigned i = 0; i < n->childCount; ++i) {
+            forEachRecursive(n->children[i], visit);
+        }
+        return;
+    }
+    case NODE16: {
+        const ArtNode16* n = static_cast<const ArtNode16*>(node);
+        for (unsigned i = 0; i < n->childCount; ++i) {
+            forEachRecursive(n->children[i], visit);
+        }
+        return;
+    }
+    case NODE48: {
+        const ArtNode48* n = static_cast<const ArtNode48*>(node);
+        for (unsigned b = 0; b < 256; ++b) {
+            if (n->childIndex[b]) {
+                forEachRecursive(n->children[n->childIndex[b] - 1], visit);
+            }
+        }
+        return;
+    }
+    case NODE256: {
+        const ArtNode256* n = static_cast<const ArtNode256*>(node);
+        for (unsigned b = 0; b < 256; ++b) {
+            forEachRecursive(n->children[b], visit);
+        }
+        return;
+    }
+    }
+}
+
+//============================================================================
+// Hot-key employee cache class definition
+//============================================================================
+
+// Counters reported by the lookup cache
+struct CacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t invalidations;
+    size_t entries;
+    size_t capacity;
+
+    CacheStats() : hits(0), misses(0), invalidations(0), entries(0), capacity(0) {}
+
+    double hitRate() const {
+        uint64_t lookups = hits + misses;
+        return lookups ? static_cast<double>(hits) / lookups : 0.0;
+    }
+};
+
+/*
+ * Bounded cache of resolved employee records, placed in front of the tree
+ * lookup. Lookup traffic is heavily skewed towards a few IDs (executives,
+ * on-call managers), so those IDs are resolved straight to their tree node
+ * through a small hash table instead of a full tree descent.
+ *
+ * Eviction uses the CLOCK approximation of LRU: a hit only sets a reference
+ * bit, and a fixed ring of slots is swept to find a victim on insertion. The
+ * slot ring and its open-addressing hash table are sized once, so neither
+ * path allocates. Keys are spread over independently locked shards so
+ * concurrent readers rarely contend. Slots compare against the ID held by
+ * the cached node rather than a copy of it, so cached pointers must be
+ * invalidated before the node they point at changes or dies.
+ */
+class EmployeeCache {
+
+private:
+    static const size_t SHARD_COUNT = 8;
+
+    struct Slot {
+        size_t hashValue;
+        Node* node;
+        bool referenced;  // Set on every hit, cleared as the clock hand passes
+    };
+
+    struct Shard {
+        mutex lock;
+        vector<Slot> slots;      // Ring swept by the clock hand
+        vector<uint32_t> table;  // Linear-probing table of slot index + 1 (0 = empty)
+        size_t hand;
+        size_t capacity;
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t invalidations;
+
+        Shard() : hand(0), capacity(0), hits(0), misses(0), invalidations(0) {}
+    };
+
+    Shard shards[SHARD_COUNT];
+    size_t capacity;
+
+    static size_t findBucket(const Shard& shard, const StringView& employeeId, size_t hashValue);
+    static size_t findSlotBucket(const Shard& shard, size_t position);
+    static void eraseBucket(Shard& shard, size_t bucket);
+    static void removeSlot(Shard& shard, size_t position);
+
+public:
+    static const size_t DEFAULT_CAPACITY = 16384;
+
+    explicit EmployeeCache(size_t maxEntries = DEFAULT_CAPACITY);
+    EmployeeCache(const EmployeeCache&) = delete;
+    EmployeeCache& operator=(const EmployeeCache&) = delete;
+    Node* lookup(const string& employeeId);
+    void store(Node* node);
+    void invalidate(const string& employeeId);
+    void clear();
+    void setCapacity(size_t maxEntries);
+    size_t getCapacity() const;
+    CacheStats getStats();
+    void resetStats();
+};
+
+/**
+ * Constructor
+ *
+ * @param maxEntries Total number of records kept across all shards (0 disables the cache)
+ */
+EmployeeCache::EmployeeCache(size_t maxEntries) : capacity(0) {
+    setCapacity(maxEntries);
+}
+
+/**
+ * Probe a shard's hash table for an employee ID
+ *
+ * @param shard The shard to search
+ * @param employeeId The employee ID
+ * @param hashValue Hash of the employee ID
+ * @return Bucket holding the ID, or the empty bucket where it would be inserted
+ */
+size_t EmployeeCache::findBucket(const Shard& shard, const StringView& employeeId, size_t hashValue) {
+    size_t mask = shard.table.size() - 1;
+    size_t bucket = (hashValue / SHARD_COUNT) & mask;
+
+    while (shard.table[bucket] != 0) {
+        const Slot& slot = shard.slots[shard.table[bucket] - 1];
+        if (slot.hashValue == hashValue && slot.node->employee.employeeId == employeeId) {
+            break;
+        }
+        bucket = (bucket + 1) & mask;
+    }
+    return bucket;
+}
+
+/**
+ * Find the bucket pointing at a slot by its index, so evicting a slot never
+ * reads the cold node it refers to
+ *
+ * @param shard The shard to search
+ * @param position Index of the slot in the ring
+ * @return Bucket holding the slot
+ */
+size_t EmployeeCache::findSlotBucket(const Shard& shard, size_t position) {
+    size_t mask = shard.table.size() - 1;
+    size_t bucket = (shard.slots[position].hashValue / SHARD_COUNT) & mask;
+
+    while (shard.table[bucket] != position + 1) {
+        bucket = (bucket + 1) & mask;
+    }
+    return bucket;
+}
+
+/**
+ * Empty a hash table bucket, shifting later entries of the probe run back
+ * so lookups never stop early at the hole
+ *
+ * @param shard The shard owning the table
+ * @param bucket The bucket to empty
+ */
+void EmployeeCache::eraseBucket(Shard& shard, size_t bucket) {
+    size_t mask = shard.table.size() - 1;
+    size_t hole = bucket;
+    size_t next = (hole + 1) & mask;
+
+    while (shard.table[next] != 0) {
+        size_t home = (shard.slots[shard.table[next] - 1].hashValue / SHARD_COUNT) & mask;
+        // Move the entry back if its home bucket is not between the hole and its position
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            shard.table[hole] = shard.table[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    shard.table[hole] = 0;
+}
+
+/**
+ * Remove a slot from the ring, moving the last slot into the hole so the ring stays dense
+ *
+ * @param shard The shard owning the slot
+ * @param position Index of the slot to remove
+ */
+void EmployeeCache::removeSlot(Shard& shard, size_t position) {
+    eraseBucket(shard, findSlotBucket(shard, position));
+
+    size_t last = shard.slots.size() - 1;
+    if (position != last) {
+        shard.table[findSlotBucket(shard, last)] =
+            static_cast<uint32_t>(position + 1);
+        shard.slots[position] = shard.slots[last];
+    }
+    shard.slots.pop_back();
+
+    if (shard.hand >= shard.slots.size()) {
+        shard.hand = 0;
+    }
+}
+
+/**
+ * Look up a cached employee and mark it as recently used
+ *
+ * @param employeeId The employee ID to look up
+ * @return The cached tree node, or nullptr on a miss
+ */
+Node* EmployeeCache::lookup(const string& employeeId) {
+    if (capacity == 0) {
+        return nullptr;
+    }
+
+    StringView key(employeeId);
+    size_t hashValue = hashText(key);
+    Shard& shard = shards[hashValue % SHARD_COUNT];
+    lock_guard<mutex> guard(shard.lock);
+
+    uint32_t entry = shard.table[findBucket(shard, key, hashValue)];
+    if (entry == 0) {
+        shard.misses++;
+        return nullptr;
+    }
+
+    Slot& slot = shard.slots[entry - 1];
+    slot.referenced = true;
+    shard.hits++;
+    return slot.node;
+}
+
+/**
+ * Cache a resolved employee, evicting an entry that has not been used since
+ * the clock hand last passed it if the shard is full
+ *
+ * @param node The tree node holding the employee
+ */
+void EmployeeCache::store(Node* node) {
+    if (capacity == 0) {
+        return;
+    }
+
+    const StringView& employeeId = node->employee.employeeId;
+    size_t hashValue = hashText(employeeId);
+    Shard& shard = shards[hashValue % SHARD_COUNT];
+    lock_guard<mutex> guard(shard.lock);
+
+    size_t bucket = findBucket(shard, employeeId, hashValue);
+    if (shard.table[bucket] != 0) {
+        shard.slots[shard.table[bucket] - 1].node = node;
+        return;
+    }
+
+    size_t position;
+    if (shard.slots.size() < shard.capacity) {
+        position = shard.slots.size();
+        shard.slots.push_back(Slot());
+    }
+    else {
+        // Give every referenced entry a second chance
+        size_t end = shard.slots.size();
+        while (shard.slots[shard.hand].referenced) {
+            shard.slots[shard.hand].referenced = false;
+            if (++shard.hand == end) {
+                shard.hand = 0;
+            }
+        }
+        position = shard.hand;
+        if (++shard.hand == end) {
+            shard.hand = 0;
+        }
+
+        eraseBucket(shard, findSlotBucket(shard, position));
+        bucket = findBucket(shard, employeeId, hashValue);  // The erase may have shifted buckets
+    }
+
+    Slot& slot = shard.slots[position];
+    slot.hashValue = hashValue;
+    slot.node = node;
+    slot.referenced = false;
+    shard.table[bucket] = static_cast<uint32_t>(position + 1);
+}
+
+/**
+ * Drop a cached entry after the employee was inserted, updated or removed
+ *
+ * @param employeeId The employee ID to invalidate
+ */
+void EmployeeCache::invalidate(const string& employeeId) {
+    if (capacity == 0) {
+        return;
+    }
+
+    StringView key(employeeId);
+    size_t hashValue = hashText(key);
+    Shard& shard = shards[hashValue % SHARD_COUNT];
+    lock_guard<mutex> guard(shard.lock);
+
+    uint32_t entry = shard.table[findBucket(shard, key, hashValue)];
+    if (entry != 0) {
+        removeSlot(shard, entry - 1);
+        shard.invalidations++;
+    }
+}
+
+/**
+ * Drop every cached entry (counters are kept)
+ */
+void EmployeeCache::clear() {
+    for (size_t i = 0; i < SHARD_COUNT; ++i) {
+        lock_guard<mutex> guard(shards[i].lock);
+        shards[i].slots.clear();
+        fill(shards[i].table.begin(), shards[i].table.end(), 0u);
+        shards[i].hand = 0;
+    }
+}
+
+/**
+ * Change the maximum number of cached entries, clearing the cache
+ *
+ * @param maxEntries Total number of records kept across all shards (0 disables the cache)
+ */
+void EmployeeCache::setCapacity(size_t maxEntries) {
+    capacity = maxEntries;
+    for (size_t i = 0; i < SHARD_COUNT; ++i) {
+        Shard& shard = shards[i];
+        lock_guard<mutex> guard(shard.lock);
+
+        shard.capacity = (maxEntries + SHARD_COUNT - 1) / SHARD_COUNT;
+        shard.slots.clear();
+        shard.slots.reserve(shard.capacity);
+        shard.hand = 0;
+
+        // Keep the table at most half full so probe runs stay short
+        size_t buckets = 1;
+        while (buckets < shard.capacity * 2) {
+            buckets <<= 1;
+        }
+        shard.table.assign(buckets, 0u);
+    }
+}
+
+/**
+ * Get the maximum number of cached entries
+ */
+size_t EmployeeCache::getCapacity() const {
+    return capacity;
+}
+
+/**
+ * Sum the counters of all shards
+ *
+ * @return Hit, miss and invalidation counts plus current occupancy
+ */
+CacheStats EmployeeCache::getStats() {
+    CacheStats stats;
+    stats.capacity = capacity;
+    for (size_t i = 0; i < SHARD_COUNT; ++i) {
+        lock_guard<mutex> guard(shards[i].lock);
+        stats.hits += shards[i].hits;
+        stats.misses += shards[i].misses;
+        stats.invalidations += shards[i].invalidations;
+        stats.entries += shards[i].slots.size();
+    }
+    return stats;
+}
+
+/**
+ * Reset the hit, miss and invalidation counters
+ */
+void EmployeeCache::resetStats() {
+    for (size_t i = 0; i < SHARD_COUNT; ++i) {
+        lock_guard<mutex> guard(shards[i].lock);
+        shards[i].hits = 0;
+        shards[i].misses = 0;
+        shards[i].invalidations = 0;
+    }
+}
+
+//============================================================================
+// Blocked Bloom filter class definition
+//============================================================================
+
+// Counters reported for the employee ID filter
+struct FilterStats {
+    double configuredRate;   // Target false-positive rate
+    double estimatedRate;    // Rate predicted from the current bit occupancy
+    uint64_t rejected;       // Lookups answered "absent" by the filter alone
+    uint64_t falsePositives; // Lookups the filter passed that the tree then missed
+    size_t memoryBytes;
+    unsigned hashCount;
+
+    FilterStats()
+        : configuredRate(0.0), estimatedRate(0.0), rejected(0), falsePositives(0), memoryBytes(0), hashCount(0) {}
+
+    // Fraction of lookups for absent IDs that still reached the tree
+    double observedRate() const {
+        uint64_t absent = rejected + falsePositives;
+        return absent ? static_cast<double>(falsePositives) / absent : 0.0;
+    }
+};
+
+/*
+ * Bloom filter split into 512-bit blocks, each the size of one cache line.
+ * A key hashes to one block and all of its probe bits live inside that block,
+ * so answering "definitely absent" costs a single cache miss no matter how
+ * many hash functions are used. The block is chosen from the high 32 bits of
+ * the key's hash and the probes from the low 32, so keys that share a block
+ * do not also share a probe pattern. Keys cannot be removed; the owner
+ * rebuilds the filter to drop stale keys or when it outgrows its sizing.
+ */
+class BloomFilter {
+
+private:
+    static const size_t WORDS_PER_BLOCK = 8;  // 8 x 64 bits = one 64-byte cache line
+
+    vector<uint64_t> storage;  // Over-allocated so blocks can start on a cache line
+    uint64_t* blocks;
+    size_t blockCount;
+    size_t capacity;          // Keys the filter was sized for
+    size_t keyCount;
+    unsigned hashCount;
+    double falsePositiveRate;
+
+    static uint64_t mixHash(const string& key);
+    static double blockedFalsePositiveRate(double bitsPerKey, unsigned probes);
+    size_t blockIndex(uint64_t h) const;
+
+public:
+    static const double DEFAULT_FALSE_POSITIVE_RATE;
+
+    explicit BloomFilter(double rate = DEFAULT_FALSE_POSITIVE_RATE);
+    BloomFilter(const BloomFilter&) = delete;
+    BloomFilter& operator=(const BloomFilter&) = delete;
+    void reset(size_t expectedKeys);
+    void add(const string& key);
+    bool mightContain(const string& key) const;
+    bool isEnabled() const;
+    void setFalsePositiveRate(double rate);
+    double getFalsePositiveRate() const;
+    double estimatedFalsePositiveRate() const;
+    size_t getCapacity() const;
+    size_t memoryBytes() const;
+    unsigned getHashCount() const;
+};
+
+const double BloomFilter::DEFAULT_FALSE_POSITIVE_RATE = 0.01;
+
+/**
+ * Constructor - the filter stays empty until reset() sizes it
+ *
+ * @param rate Target false-positive rate (0 disables the filter)
+ */
+BloomFilter::BloomFilter(double rate)
+    : blocks(nullptr), blockCount(0), capacity(0), keyCount(0), hashCount(0), falsePositiveRate(rate) {}
+
+/**
+ * Hash a key to 64 well-mixed bits (splitmix64 finalizer over std::hash)
+ *
+ * @param key The key to hash
+ * @return Mixed 64-bit hash
+ */
+uint64_t BloomFilter::mixHash(const string& key) {
+    uint64_t h = static_cast<uint64_t>(hash<string>()(key));
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+/**
+ * Predict the false-positive rate of a blocked filter. Keys do not spread
+ * evenly over the blocks: the number in a block is close to Poisson, and
+ * the fuller blocks answer wrongly far more often than the average fill
+ * suggests, so the rate is summed over the possible block loads.
+ *
+ * @param bitsPerKey Filter bits per key
+ * @param probes Bits set per key
+ * @return Probability that an absent key passes the filter
+ */
+double BloomFilter::blockedFalsePositiveRate(double bitsPerKey, unsigned probes) {
+    double keysPerBlock = 512.0 / bitsPerKey;
+    double rate = 0.0;
+    double load = exp(-keysPerBlock);  // Poisson probability of the current key count
+    size_t limit = static_cast<size_t>(keysPerBlock + 10.0 * sqrt(keysPerBlock) + 20.0);
+    for (size_t keys = 0; keys <= limit; ++keys) {
+        double fill = 1.0 - pow(1.0 - 1.0 / 512.0, static_cast<double>(probes) * keys);
+        rate += load * pow(fill, static_cast<double>(probes));
+        load *= keysPerBlock / (keys + 1);
+    }
+    return rate;
+}
+
+/**
+ * Find the block a hash selects, from its high 32 bits
+ *
+ * @param h Mixed hash of a key
+ * @return Index of the block
+ */
+size_t BloomFilter::blockIndex(uint64_t h) const {
+    // Multiply-shift maps the bits onto the blocks without a division
+    return static_cast<size_t>(((h >> 32) * blockCount) >> 32);
+}
+
+/**
+ * Clear the filter and size it for a number of keys at the configured rate
+ *
+ * @param expectedKeys Number of keys the filter should hold
+ */
+void BloomFilter::reset(size_t expectedKeys) {
+    keyCount = 0;
+    capacity = max<size_t>(expectedKeys, 1024);
+
+    if (!isEnabled()) {
+        storage.clear();
+        blocks = nullptr;
+        blockCount = 0;
+        hashCount = 0;
+        return;
+    }
+
+    // Start from the classic sizing, m = -n ln(p) / ln(2)^2 bits, and add
+    // bits per key until the blocked filter reaches the rate with its best
+    // probe count
+    double ln2 = log(2.0);
+    double bitsPerKey = -log(falsePositiveRate) / (ln2 * ln2);
+    for (;;) {
+        double bestRate = 1.0;
+        for (unsigned probes = 1; probes <= 16; ++probes) {
+            double rate = blockedFalsePositiveRate(bitsPerKey, probes);
+            if (rate < bestRate) {
+                bestRate = rate;
+                hashCount = probes;
+            }
+        }
+        if (bestRate <= falsePositiveRate || bitsPerKey >= 64.0) {
+            break;
+        }
+        bitsPerKey += 0.25;
+    }
+
+    size_t bits = static_cast<size_t>(ceil(bitsPerKey * capacity));
+    blockCount = (bits + 511) / 512;
+    storage.assign(blockCount * WORDS_PER_BLOCK + WORDS_PER_BLOCK, 0);
+
+    uintptr_t address = reinterpret_cast<uintptr_t>(storage.data());
+    size_t misalignment = (address % 64) / sizeof(uint64_t);
+    blocks = storage.data() + (misalignment ? WORDS_PER_BLOCK - misalignment : 0);
+}
+
+/**
+ * Add a key to the filter
+ *
+ * @param key The key to add
+ */
+void BloomFilter::add(const string& key) {
+    if (blocks == nullptr) {
+        return;
+    }
+
+    uint64_t h = mixHash(key);
+    uint64_t* block = blocks + blockIndex(h) * WORDS_PER_BLOCK;
+
+    // Each probe is the top 9 bits of the low 32, which are then multiplied
+    // by an odd constant for the next probe. Double hashing would make the
+    // probes an arithmetic progression, and progressions with the same step
+    // overlap in all but one bit, which floods a 512-bit block with near misses.
+    uint32_t probe = static_cast<uint32_t>(h);
+    for (unsigned i = 0; i < hashCount; ++i) {
+        uint32_t bit = probe >> 23;
+        block[bit >> 6] |= 1ULL << (bit & 63);
+        probe *= 0x9e3779b9U;
+    }
+    keyCount++;
+}
+
+/**
+ * Check whether a key may be in the filter
+ *
+ * @param key The key to check
+ * @return False if the key was definitely never added, true otherwise
+ */
+bool BloomFilter::mightContain(const string& key) const {
+    if (blocks == nullptr) {
+        return true;
+    }
+
+    uint64_t h = mixHash(key);
+    const uint64_t* block = blocks + blockIndex(h) * WORDS_PER_BLOCK;
+
+    uint32_t probe = static_cast<uint32_t>(h);
+    for (unsigned i = 0; i < hashCount; ++i) {
+        uint32_t bit = probe >> 23;
+        if ((block[bit >> 6] & (1ULL << (bit & 63))) == 0) {
+            return false;
+        }
+        probe *= 0x9e3779b9U;
+    }
+    return true;
+}
+
+/**
+ * Whether the filter is in use (a rate of 0 disables it)
+ */
+bool BloomFilter::isEnabled() const {
+    return falsePositiveRate > 0.0 && falsePositiveRate < 1.0;
+}
+
+/**
+ * Change the target false-positive rate; takes effect at the next reset()
+ *
+ * @param rate Target false-positive rate (0 disables the filter)
+ */
+void BloomFilter::setFalsePositiveRate(double rate) {
+    falsePositiveRate = rate;
+}
+
+/**
+ * Get the target false-positive rate
+ */
+double BloomFilter::getFalsePositiveRate() const {
+    return falsePositiveRate;
+}
+
+/**
+ * Predict the false-positive rate from the bits currently set in each block.
+ * An absent key lands in any block equally often and passes when every one
+ * of its probes hits a bit set there.
+ *
+ * @return Probability that an absent key passes the filter
+ */
+double BloomFilter::estimatedFalsePositiveRate() const {
+    if (blocks == nullptr) {
+        return 1.0;
+    }
+
+    double total = 0.0;
+    for (size_t b = 0; b < blockCount; ++b) {
+        unsigned setBits = 0;
+        for (size_t w = 0; w < WORDS_PER_BLOCK; ++w) {
+            uint64_t word = blocks[b * WORDS_PER_BLOCK + w];
+            while (word) {
+                word &= word - 1;
+                setBits++;
+            }
+        }
+        total += pow(setBits / 512.0, static_cast<double>(hashCount));
+    }
+    return total / blockCount;
+}
+
+/**
+ * Number of keys the filter was sized for
+ */
+size_t BloomFilter::getCapacity() const {
+    return capacity;
+}
+
+/**
+ * Bytes used by the filter bits
+ */
+size_t BloomFilter::memoryBytes() const {
+    return blockCount * WORDS_PER_BLOCK * sizeof(uint64_t);
+}
+
+/**
+ * Number of bits probed per key
+ */
+unsigned BloomFilter::getHashCount() const {
+    return hashCount;
+}
+
+//============================================================================
+// Posting list index class definition
+//============================================================================
+
+/*
+ * Dense ids for the distinct values of a text key that is not an employee
+ * field, such as the names and trigrams of the fuzzy name index. Values
+ * are matched without regard to case unless asked to match exactly, and
+ * keep the spelling first seen for display.
+ */
+class FieldValueIds {
+
+private:
+    ValueMatch match;
+    unordered_map<string, uint32_t> ids;  // Matched form of each value -> value id
+    vector<string> names;                 // Value id -> display spelling
+
+public:
+    explicit FieldValueIds(ValueMatch valueMatch = ValueMatch::IGNORE_CASE) : match(valueMatch) {}
+    uint32_t intern(const string& value);
+    bool lookup(const string& value, uint32_t& valueId) const;
+    const string& name(uint32_t valueId) const { return names[valueId]; }
+    size_t size() const { return names.size(); }
+    void clear();
+};
+
+/**
+ * Get the id of a value, assigning the next free id to values not seen before
+ *
+ * @param value The field value
+ * @return The value id; equal to the old size() when the value is new
+ */
+uint32_t FieldValueIds::intern(const string& value) {
+    auto inserted = ids.insert(make_pair(match == ValueMatch::EXACT ? value : foldCase(value),
+                                         static_cast<uint32_t>(names.size())));
+    if (inserted.second) {
+        names.push_back(value);
+    }
+    return inserted.first->second;
+}
+
+/**
+ * Find the id of a value without interning it
+ *
+ * @param value The field value (any case unless matched exactly)
+ * @param valueId Receives the value id when found
+ * @return True if the value has been seen
+ */
+bool FieldValueIds::lookup(const string& value, uint32_t& valueId) const {
+    auto found = ids.find(match == ValueMatch::EXACT ? value : foldCase(value));
+    if (found == ids.end()) {
+        return false;
+    }
+    valueId = found->second;
+    return true;
+}
+
+/**
+ * Forget every value
+ */
+void FieldValueIds::clear() {
+    ids.clear();
+    names.clear();
+}
+
+/*
+ * Secondary index from a categorical field value (such as a department) to
+ * the sorted list of row ids holding that value. Values are keyed by their
+ * group id in the tree's store (see StringDictionary), so indexing a record
+ * never touches its text. Answering "who has value X" reads only X's
+ * posting list.
+ */
+class PostingIndex {
+
+private:
+    vector<vector<uint32_t> > postings;  // Group id -> sorted row ids
+    vector<uint32_t> noRows;
+
+public:
+    void add(uint32_t valueId, uint32_t rowId);
+    void remove(uint32_t valueId, uint32_t rowId);
+    const vector<uint32_t>& rows(uint32_t valueId) const;
+    size_t valueCount() const;
+    void clear();
+};
+
+/**
+ * Add a row to a value's posting list, keeping the list sorted
+ *
+ * @param valueId The value's group id
+ * @param rowId The row holding that value
+ */
+void PostingIndex::add(uint32_t valueId, uint32_t rowId) {
+    if (valueId >= postings.size()) {
+        postings.resize(valueId + 1);
+    }
+    vector<uint32_t>& list = postings[valueId];
+
+    // New rows get increasing ids, so this is normally an append
+    if (list.empty() || list.back() < rowId) {
+        list.push_back(rowId);
+    }
+    else {
+        auto position = lower_bound(list.begin(), list.end(), rowId);
+        if (position == list.end() || *position != rowId) {
+            list.insert(position, rowId);
+        }
+    }
+}
+
+/**
+ * Remove a row from a value's posting list
+ *
+ * @param valueId The value's group id
+ * @param rowId The row to remove
+ */
+void PostingIndex::remove(uint32_t valueId, uint32_t rowId) {
+    if (valueId >= postings.size()) {
+        return;
+    }
+    vector<uint32_t>& list = postings[valueId];
+    auto position = lower_bound(list.begin(), list.end(), rowId);
+    if (position != list.end() && *position == rowId) {
+        list.erase(position);
+    }
+}
+
+/**
+ * Get the sorted row ids holding a value
+ *
+ * @param valueId The value's group id
+ * @return Reference to the posting list (empty for values no row holds)
+ */
+const vector<uint32_t>& PostingIndex::rows(uint32_t valueId) const {
+    return valueId < postings.size() ? postings[valueId] : noRows;
+}
+
+/**
+ * One past the highest group id with a posting list
+ */
+size_t PostingIndex::valueCount() const {
+    return postings.size();
+}
+
+/**
+ * Remove all posting lists
+ */
+void PostingIndex::clear() {
+    postings.clear();
+}
+
+//============================================================================
+// Name prefix index class definition
+//============================================================================
+
+/*
+ * Sorted array over every word of every employee's case-folded name, so both
+ * "cath" and "dav" find "Catherine Davis". A prefix query is a binary search
+ * for the first candidate followed by a scan of the k matches. Entries hold
+ * (name, word offset) into one folded copy of each name instead of their own
+ * strings. New names are appended and merged into the sorted run on the next
+ * query, so bulk loads sort once. Removing a row only marks its name dead;
+ * queries skip dead entries, and they are dropped in one pass once they
+ * make up half of the array, so single changes cost no more than the name.
+ */
+class NamePrefixIndex {
+
+private:
+    struct Entry {
+        uint32_t name;    // Slot of the folded name
+        uint32_t offset;  // Start of the word within the folded name
+    };
+
+    static const uint32_t NO_SLOT = 0xFFFFFFFF;
+
+    vector<string> foldedNames;  // Name slot -> folded full name, kept while entries use it
+    vector<uint32_t> nameRows;   // Name slot -> row id, or NO_SLOT once dead
+    vector<uint32_t> rowNames;   // Row id -> name slot, or NO_SLOT once removed
+    vector<Entry> entries;
+    size_t sortedCount;          // entries[0, sortedCount) are in order
+    size_t deadEntries;          // Entries whose name is dead
+
+    bool entryLess(const Entry& a, const Entry& b) const;
+    void ensureSorted();
+    void dropDeadEntries();
+
+public:
+    NamePrefixIndex();
+    void add(uint32_t row, const string& fullName);
+    void remove(uint32_t row);
+    void clear();
+    vector<uint32_t> findPrefix(const string& prefix, size_t limit);
+};
+
+const uint32_t NamePrefixIndex::NO_SLOT;
+
+/**
+ * Default constructor
+ */
+NamePrefixIndex::NamePrefixIndex() : sortedCount(0), deadEntries(0) {}
+
+/**
+ * Order entries by the name text starting at their word
+ */
+bool NamePrefixIndex::entryLess(const Entry& a, const Entry& b) const {
+    int order = foldedNames[a.name].compare(a.offset, string::npos, foldedNames[b.name], b.offset, string::npos);
+    return order != 0 ? order < 0 : a.name < b.name;
+}
+
+/**
+ * Sort entries appended since the last query and merge them into the sorted run
+ */
+void NamePrefixIndex::ensureSorted() {
+    if (sortedCount == entries.size()) {
+        return;
+    }
+
+    auto less = [this](const Entry& a, const Entry& b) { return entryLess(a, b); };
+    sort(entries.begin() + sortedCount, entries.end(), less);
+    inplace_merge(entries.begin(), entries.begin() + sortedCount, entries.end(), less);
+    sortedCount = entries.size();
+}
+
+/**
+ * Drop the entries of dead names and free their text
+ */
+void NamePrefixIndex::dropDeadEntries() {
+    ensureSorted();
+    entries.erase(remove_if(entries.begin(), entries.end(),
+                            [this](const Entry& e) { return nameRows[e.name] == NO_SLOT; }),
+                  entries.end());
+    sortedCount = entries.size();
+    deadEntries = 0;
+    for (size_t slot = 0; slot < foldedNames.size(); ++slot) {
+        if (nameRows[slot] == NO_SLOT) {
+            string().swap(foldedNames[slot]);
+        }
+    }
+}
+
+/**
+ * Index every word of an employee's name
+ *
+ * @param row The employee's row id
+ * @param fullName The employee's full name
+ */
+void NamePrefixIndex::add(uint32_t row, const string& fullName) {
+    remove(row);
+    if (rowNames.size() <= row) {
+        rowNames.resize(row + 1, NO_SLOT);
+    }
+    uint32_t slot = static_cast<uint32_t>(foldedNames.size());
+    foldedNames.push_back(foldCase(fullName));
+    nameRows.push_back(row);
+    rowNames[row] = slot;
+
+    const string& name = foldedNames[slot];
+    for (size_t i = 0; i < name.size(); ++i) {
+        if (name[i] != ' ' && (i == 0 || name[i - 1] == ' ')) {
+            Entry entry;
+            entry.name = slot;
+            entry.offset = static_cast<uint32_t>(i);
+            entries.push_back(entry);
+        }
+    }
+}
+
+/**
+ * Remove a row's name. Its entries stay in place, skipped by queries,
+ * until enough have died to be worth one pass over the array.
+ *
+ * @param row The row id to remove
+ */
+void NamePrefixIndex::remove(uint32_t row) {
+    if (row >= rowNames.size() || rowNames[row] == NO_SLOT) {
+        return;
+    }
+
+    uint32_t slot = rowNames[row];
+    const string& name = foldedNames[slot];
+    for (size_t i = 0; i < name.size(); ++i) {
+        deadEntries += name[i] != ' ' && (i == 0 || name[i - 1] == ' ') ? 1 : 0;
+    }
+    nameRows[slot] = NO_SLOT;
+    rowNames[row] = NO_SLOT;
+    if (deadEntries * 2 > entries.size()) {
+        dropDeadEntries();
+    }
+}
+
+/**
+ * Remove all names
+ */
+void NamePrefixIndex::clear() {
+    foldedNames.clear();
+    nameRows.clear();
+    rowNames.clear();
+    entries.clear();
+    sortedCount = 0;
+    deadEntries = 0;
+}
+
+/**
+ * Find employees with a name word starting with a prefix
+ *
+ * @param prefix The typed prefix (any case)
+ * @param limit Maximum number of rows to return
+ * @return Up to limit distinct row ids, in alphabetical order of the matched word
+ */
+vector<uint32_t> NamePrefixIndex::findPrefix(const string& prefix, size_t limit) {
+    vector<uint32_t> matches;
+    string folded = foldCase(prefix);
+    if (folded.empty()) {
+        return matches;
+    }
+
+    ensureSorted();
+    auto first = lower_bound(entries.begin(), entries.end(), folded,
+        [this](const Entry& e, const string& key) { return foldedNames[e.name].compare(e.offset, string::npos, key) < 0; });
+
+    for (auto it = first; it != entries.end() && matches.size() < limit; ++it) {
+        if (foldedNames[it->name].compare(it->offset, folded.size(), folded) != 0) {
+            break;
+        }
+        // A name can match on more than one word; dead names match nothing
+        uint32_t row = nameRows[it->name];
+        if (row != NO_SLOT && find(matches.begin(), matches.end(), row) == matches.end()) {
+            matches.push_back(row);
+        }
+    }
+    return matches;
+}
+
+//============================================================================
+// Fuzzy name matching: trigram index and bit-parallel edit distance
+//============================================================================
+
+/*
+ * Edit distance (Levenshtein) between a fixed pattern and many texts, using
+ * Myers' bit-parallel algorithm: one column of the dynamic-programming matrix
+ * is held as bit vectors, so each text character costs a handful of word
+ * operations instead of a loop over the pattern. Patterns longer than 64
+ * characters fall back to the classic row-by-row computation. Both sides are
+ * compared case-insensitively.
+ */
+class EditDistanceMatcher {
+
+private:
+    string pattern;        // Case-folded
+    uint64_t peq[256];     // Character (either case) -> bit mask of its positions in the pattern
+
+    unsigned fallbackDistance(const char* text, size_t length) const;
+
+public:
+    explicit EditDistanceMatcher(const string& text);
+    unsigned distance(const char* text, size_t length) const;
+};
+
+/**
+ * Constructor - precomputes the per-character position masks
+ *
+ * @param text The pattern to compare against
+ */
+EditDistanceMatcher::EditDistanceMatcher(const string& text) : pattern(foldCase(text)) {
+    memset(peq, 0, sizeof(peq));
+    for (size_t i = 0; i < pattern.size() && i < 64; ++i) {
+        unsigned char c = static_cast<unsigned char>(pattern[i]);
+        peq[c] |= 1ULL << i;
+        peq[static_cast<unsigned char>(toupper(c))] |= 1ULL << i;
+    }
+}
+
+/**
+ * Edit distance between the pattern and a text
+ *
+ * @param text The text to compare (any case)
+ * @param length Number of characters in the text
+ * @return Minimum number of insertions, deletions and substitutions
+ */
+unsigned EditDistanceMatcher::distance(const char* text, size_t length) const {
+    size_t m = pattern.size();
+    if (m == 0) {
+        return static_cast<unsigned>(length);
+    }
+    if (m > 64) {
+        return fallbackDistance(text, length);
+    }
+
+    // Pv/Mv: vertical +1/-1 deltas down the current column
+    uint64_t pv = ~0ULL;
+    uint64_t mv = 0;
+    uint64_t high = 1ULL << (m - 1);
+    unsigned score = static_cast<unsigned>(m);
+
+    for (size_t j = 0; j < length; ++j) {
+        uint64_t eq = peq[static_cast<unsigned char>(text[j])];
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+
+        if (ph & high) {
+            score++;
+        }
+        else if (mh & high) {
+            score--;
+        }
+
+        // Shifting in a +1 keeps the top row at D[0][j] = j (global alignment)
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+    }
+    return score;
+}
+
+/**
+ * Row-by-row edit distance for patterns that do not fit in one machine word
+ *
+ * @param text The text to compare (any case)
+ * @param length Number of characters in the text
+ * @return Minimum number of insertions, deletions and substitutions
+ */
+unsigned EditDistanceMatcher::fallbackDistance(const char* text, size_t length) const {
+    vector<unsigned> row(pattern.size() + 1);
+    for (size_t i = 0; i <= pattern.size(); ++i) {
+        row[i] = static_cast<unsigned>(i);
+    }
+
+    for (size_t j = 1; j <= length; ++j) {
+        unsigned diagonal = row[0];
+        row[0] = static_cast<unsigned>(j);
+        char c = static_cast<char>(tolower(static_cast<unsigned char>(text[j - 1])));
+        for (size_t i = 1; i <= pattern.size(); ++i) {
+            unsigned above = row[i];
+            row[i] = min(min(row[i] + 1, row[i - 1] + 1), diagonal + (pattern[i - 1] == c ? 0u : 1u));
+            diagonal = above;
+        }
+    }
+    return row[pattern.size()];
+}
+
+/*
+ * Index from name trigrams to the names that contain them. Each word is
+ * padded with a space on both sides before the trigrams are taken, so word
+ * starts and ends count as grams too. By the q-gram lemma a string within
+ * edit distance k of a query with g distinct trigrams shares at least g - 3k
+ * of them, so counting shared grams per name rules out almost every name
+ * before any edit distance is computed. Grams point at distinct names rather
+ * than rows: a directory repeats common names many times, and each distinct
+ * name only needs to be verified once.
+ */
+class TrigramIndex {
+
+private:
+    FieldValueIds nameValues;      // Full name, any case -> name id
+    FieldValueIds gramValues;      // Trigram -> gram id
+    PostingIndex names;            // Name id -> row ids
+    PostingIndex grams;            // Gram id -> name ids
+    string nameText;               // Every distinct name back to back, in name id order
+    vector<uint32_t> nameOffsets;  // Name id -> start in nameText, plus a final end offset
+    mutable vector<uint8_t> counts;         // Per-name shared gram count, zero between queries
+    mutable vector<uint32_t> touched;       // Names with a non-zero count
+
+    static const size_t LONG_LIST_LIMIT = 4;   // Most gram lists probed instead of counted
+
+    static vector<string> nameTrigrams(const string& name);
+
+public:
+    void add(uint32_t row, const string& name);
+    void remove(uint32_t row, const string& name);
+    void clear();
+    bool candidates(const string& query, unsigned maxDistance, vector<uint32_t>& nameIds) const;
+    const string& name(uint32_t nameId) const;
+    const char* nameData(uint32_t nameId, size_t& length) const;
+    const vector<uint32_t>& rows(uint32_t nameId) const;
+};
+
+/**
+ * Distinct trigrams of a case-folded, space-padded name
+ *
+ * @param name The name (any case)
+ * @return Sorted distinct trigrams
+ */
+vector<string> TrigramIndex::nameTrigrams(const string& name) {
+    // Collapse runs of spaces so "Ann  Lee" and "Ann Lee" share their grams
+    string padded = " ";
+    string folded = foldCase(name);
+    for (size_t i = 0; i < folded.size(); ++i) {
+        if (folded[i] != ' ' || padded[padded.size() - 1] != ' ') {
+            padded += folded[i];
+        }
+    }
+    if (padded[padded.size() - 1] != ' ') {
+        padded += ' ';
+    }
+
+    vector<string> trigrams;
+    for (size_t i = 0; i + 3 <= padded.size(); ++i) {
+        trigrams.push_back(padded.substr(i, 3));
+    }
+    sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    return trigrams;
+}
+
+/**
+ * Index an employee's name, adding its trigrams the first time the name is seen
+ *
+ * @param row The employee's row id
+ * @param name The employee's full name
+ */
+void TrigramIndex::add(uint32_t row, const string& name) {
+    uint32_t nameId = nameValues.intern(name);
+    bool firstRow = names.rows(nameId).empty();
+    names.add(nameId, row);
+    if (!firstRow) {
+        return;
+    }
+
+    // Names keep their id when their last row leaves, so text is only stored once
+    if (nameOffsets.empty()) {
+        nameOffsets.push_back(0);
+    }
+    if (nameId + 1 == nameOffsets.size()) {
+        nameText += name;
+        nameOffsets.push_back(static_cast<uint32_t>(nameText.size()));
+    }
+
+    vector<string> trigrams = nameTrigrams(name);
+    for (size_t i = 0; i < trigrams.size(); ++i) {
+        grams.add(gramValues.intern(trigrams[i]), nameId);
+    }
+}
+
+/**
+ * Remove an employee's name, dropping its trigrams once no row has the name
+ *
+ * @param row The employee's row id
+ * @param name The name the row was indexed with
+ */
+void TrigramIndex::remove(uint32_t row, const string& name) {
+    uint32_t nameId;
+    if (!nameValues.lookup(name, nameId)) {
+        return;
+    }
+    names.remove(nameId, row);
+    if (!names.rows(nameId).empty()) {
+        return;
+    }
+
+    vector<string> trigrams = nameTrigrams(name);
+    for (size_t i = 0; i < trigrams.size(); ++i) {
+        uint32_t gramId;
+        if (gramValues.lookup(trigrams[i], gramId)) {
+            grams.remove(gramId, nameId);
+        }
+    }
+}
+
+/**
+ * Remove all names
+ */
+void TrigramIndex::clear() {
+    nameValues.clear();
+    gramValues.clear();
+    names.clear();
+    grams.clear();
+    nameText.clear();
+    nameOffsets.clear();
+    counts.clear();
+    touched.clear();
+}
+
+/**
+ * Collect the names that share enough trigrams with a query to be within an
+ * edit distance of it
+ *
+ * @param query The query name
+ * @param maxDistance Largest edit distance of interest
+ * @param nameIds Receives the candidate name ids
+ * @return False if the query is too short for the trigram filter at this
+ *         distance, in which case every indexed name is returned
+ */
+bool TrigramIndex::candidates(const string& query, unsigned maxDistance, vector<uint32_t>& nameIds) const {
+    nameIds.clear();
+
+    vector<string> trigrams = nameTrigrams(query);
+    size_t lost = 3 * static_cast<size_t>(maxDistance);
+    if (trigrams.size() <= lost) {
+        // Too few grams to rule any name out: every indexed name is a candidate
+        for (uint32_t nameId = 0; nameId < nameValues.size(); ++nameId) {
+            if (!names.rows(nameId).empty()) {
+                nameIds.push_back(nameId);
+            }
+        }
+        return false;
+    }
+    size_t threshold = trigrams.size() - lost;
+
+    static const vector<uint32_t> empty;
+    vector<const vector<uint32_t>*> lists;
+    for (size_t i = 0; i < trigrams.size(); ++i) {
+        uint32_t gramId;
+        lists.push_back(gramValues.lookup(trigrams[i], gramId) ? &grams.rows(gramId) : &empty);
+    }
+    sort(lists.begin(), lists.end(),
+         [](const vector<uint32_t>* a, const vector<uint32_t>* b) { return a->size() < b->size(); });
+
+    // Count over the short lists only; a name can pick up at most one more
+    // gram from each long list, so it needs threshold - longCount here. The
+    // long lists (common grams such as "an ") are then probed per survivor.
+    size_t longCount = threshold - 1 < LONG_LIST_LIMIT ? threshold - 1 : LONG_LIST_LIMIT;
+    size_t shortCount = lists.size() - longCount;
+    size_t shortThreshold = threshold - longCount;
+
+    // Counts saturate well above any realistic threshold
+    if (counts.size() < nameValues.size()) {
+        counts.resize(nameValues.size(), 0);
+    }
+    for (size_t i = 0; i < shortCount; ++i) {
+        const vector<uint32_t>& list = *lists[i];
+        for (size_t j = 0; j < list.size(); ++j) {
+            uint8_t& count = counts[list[j]];
+            if (count == 0) {
+                touched.push_back(list[j]);
+            }
+            if (count < 255) {
+                count++;
+            }
+        }
+    }
+
+    vector<uint32_t> survivors;
+    for (size_t i = 0; i < touched.size(); ++i) {
+        if (counts[touched[i]] >= shortThreshold) {
+            survivors.push_back(touched[i]);
+        }
+    }
+    sort(survivors.begin(), survivors.end());
+
+    // Survivors are sorted, so each long list is searched from where the last probe stopped
+    vector<vector<uint32_t>::const_iterator> cursors;
+    for (size_t i = shortCount; i < lists.size(); ++i) {
+        cursors.push_back(lists[i]->begin());
+    }
+    for (size_t i = 0; i < survivors.size(); ++i) {
+        size_t count = counts[survivors[i]];
+        for (size_t l = 0; l < cursors.size() && count < threshold && count + (cursors.size() - l) >= threshold; ++l) {
+            const vector<uint32_t>& list = *lists[shortCount + l];
+            cursors[l] = lower_bound(cursors[l], list.end(), survivors[i]);
+            if (cursors[l] != list.end() && *cursors[l] == survivors[i]) {
+                count++;
+            }
+        }
+        if (count >= threshold) {
+            nameIds.push_back(survivors[i]);
+        }
+    }
+
+    for (size_t i = 0; i < touched.size(); ++i) {
+        counts[touched[i]] = 0;
+    }
+    touched.clear();
+    return true;
+}
+
+/**
+ * Get the spelling of an indexed name
+ *
+ * @param nameId The name id
+ * @return The name as first added
+ */
+const string& TrigramIndex::name(uint32_t nameId) const {
+    return nameValues.name(nameId);
+}
+
+/**
+ * Get the stored characters of an indexed name, for scanning many names quickly
+ *
+ * @param nameId The name id
+ * @param length Receives the number of characters
+ * @return Pointer to the first character (not null-terminated)
+ */
+const char* TrigramIndex::nameData(uint32_t nameId, size_t& length) const {
+    length = nameOffsets[nameId + 1] - nameOffsets[nameId];
+    return nameText.data() + nameOffsets[nameId];
+}
+
+/**
+ * Get the employees with an indexed name
+ *
+ * @param nameId The name id
+ * @return Sorted row ids
+ */
+const vector<uint32_t>& TrigramIndex::rows(uint32_t nameId) const {
+    return names.rows(nameId);
+}
+
+//============================================================================
+// Posting list set operations and skill queries
+//============================================================================
+
+/**
+ * Intersect two sorted row id lists of similar length with a linear merge
+ *
+ * @param a First sorted list
+ * @param b Second sorted list
+ * @param out Receives the sorted intersection
+ */
+void intersectMerge(const vector<uint32_t>& a, const vector<uint32_t>& b, vector<uint32_t>& out) {
+    out.clear();
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (a[i] < b[j]) {
+            i++;
+        }
+        else if (a[i] > b[j]) {
+            j++;
+        }
+        else {
+            out.push_back(a[i]);
+            i++;
+            j++;
+        }
+    }
+}
+
+/**
+ * Intersect a short sorted list with a much longer one
+ *
+ * For each row in the short list, the long list is searched in 16-element
+ * blocks: an exponential (galloping) search over the last element of each
+ * block finds the only block that can hold the row, and that block is then
+ * compared against the row four lanes at a time with SSE2.
+ *
+ * @param small The shorter sorted list
+ * @param large The longer sorted list
+ * @param out Receives the sorted intersection
+ */
+void intersectGalloping(const vector<uint32_t>& small, const vector<uint32_t>& large, vector<uint32_t>& out) {
+    out.clear();
+    const uint32_t* data = large.data();
+    size_t n = large.size();
+    size_t pos = 0;
+
+    for (size_t s = 0; s < small.size() && pos < n; ++s) {
+        uint32_t target = small[s];
+
+        // Gallop over whole blocks whose last element is still below the target
+        size_t blocks = (n - pos) / 16;
+        size_t lo = 0;
+        size_t hi = 1;
+        while (hi <= blocks && data[pos + hi * 16 - 1] < target) {
+            lo = hi;
+            hi *= 2;
+        }
+        hi = min(hi, blocks);
+        // Block 'blocks' stands for the partial tail; find the first block ending at or after the target
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (data[pos + mid * 16 + 15] < target) {
+                lo = mid + 1;
+            }
+            else {
+                hi = mid;
+            }
+        }
+        pos += lo * 16;
+
+        if (pos + 16 <= n) {
+#ifdef EMPLOYEE_HAVE_SSE2
+            __m128i key = _mm_set1_epi32(static_cast<int>(target));
+            const __m128i* block = reinterpret_cast<const __m128i*>(data + pos);
+            __m128i hits = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi32(key, _mm_loadu_si128(block)), _mm_cmpeq_epi32(key, _mm_loadu_si128(block + 1))),
+                _mm_or_si128(_mm_cmpeq_epi32(key, _mm_loadu_si128(block + 2)), _mm_cmpeq_epi32(key, _mm_loadu_si128(block + 3))));
+            if (_mm_movemask_epi8(hits) != 0) {
+                out.push_back(target);
+            }
+#else
+            if (binary_search(data + pos, data + pos + 16, target)) {
+                out.push_back(target);
+            }
+#endif
+        }
+        else {
+            // Fewer than 16 rows left - finish with a scalar scan
+            while (pos < n && data[pos] < target) {
+                pos++;
+            }
+            if (pos < n && data[pos] == target) {
+                out.push_back(target);
+            }
+        }
+    }
+}
+
+/**
+ * Intersect two sorted row id lists, picking the algorithm from their size ratio
+ *
+ * @param a First sorted list
+ * @param b Second sorted list
+ * @param out Receives the sorted intersection
+ */
+void intersectPostings(const vector<uint32_t>& a, const vector<uint32_t>& b, vector<uint32_t>& out) {
+    const vector<uint32_t>& small = a.size() <= b.size() ? a : b;
+    const vector<uint32_t>& large = a.size() <= b.size() ? b : a;
+
+    // Galloping wins once the long list has many elements per element of the short one
+    if (small.size() * 16 < large.size()) {
+        intersectGalloping(small, large, out);
+    }
+    else {
+        intersectMerge(small, large, out);
+    }
+}
+
+// One term of a skill query: a skill, optionally negated
+struct SkillTerm {
+    string skill;
+    bool negated;
+};
+
+/*
+ * Skill query in disjunctive normal form: the query matches an employee when
+ * every term of at least one clause matches. "C++ AND Python OR Java AND NOT
+ * SQL" is the two clauses {C++, Python} and {Java, NOT SQL}.
+ */
+struct SkillQuery {
+    vector<vector<SkillTerm> > clauses;
+};
+
+/**
+ * Parse a skill query such as "C++ AND Python AND NOT Agile OR Java"
+ *
+ * NOT binds tightest, then AND, then OR. Keywords are case-insensitive; a
+ * skill containing a keyword can be written in double quotes.
+ *
+ * @param text The query text
+ * @param query Receives the parsed query
+ * @param error Receives a message when the query is malformed
+ * @return True if the query parsed
+ */
+bool parseSkillQuery(const string& text, SkillQuery& query, string& error) {
+    query.clauses.assign(1, vector<SkillTerm>());
+    SkillTerm term;
+    term.negated = false;
+    bool expectSkill = true;  // False right after a complete term
+
+    size_t i = 0;
+    while (i < text.size()) {
+        if (isspace(static_cast<unsigned char>(text[i]))) {
+            i++;
+            continue;
+        }
+
+        // Read one word, or one quoted phrase taken literally
+        string word;
+        bool quoted = text[i] == '"';
+        if (quoted) {
+            size_t close = text.find('"', i + 1);
+            if (close == string::npos) {
+                error = "Missing closing quote.";
+                return false;
+            }
+            word = text.substr(i + 1, close - i - 1);
+            i = close + 1;
+        }
+        else {
+            size_t end = i;
+            while (end < text.size() && !isspace(static_cast<unsigned char>(text[end]))) {
+                end++;
+            }
+            word = text.substr(i, end - i);
+            i = end;
+        }
+
+        string keyword = quoted ? "" : foldCase(word);
+        if (keyword == "and" || keyword == "or") {
+            if (expectSkill) {
+                error = "Expected a skill before " + word + ".";
+                return false;
+            }
+            query.clauses.back().push_back(term);
+            if (keyword == "or") {
+                query.clauses.push_back(vector<SkillTerm>());
+            }
+            term.skill.clear();
+            term.negated = false;
+            expectSkill = true;
+        }
+        else if (keyword == "not") {
+            if (!expectSkill || term.negated) {
+                error = "NOT must come right before a skill.";
+                return false;
+            }
+            term.negated = true;
+        }
+        else {
+            // Consecutive plain words form one multi-word skill such as "Team Leadership"
+            term.skill += (term.skill.empty() ? "" : " ") + word;
+            expectSkill = false;
+        }
+    }
+
+    if (expectSkill) {
+        error = query.clauses.size() == 1 && query.clauses[0].empty() && !term.negated
+            ? "Please enter at least one skill." : "The query ends without a skill.";
+        return false;
+    }
+    query.clauses.back().push_back(term);
+    return true;
+}
+
+/**
+ * Evaluate a skill query against a skill posting index
+ *
+ * Within a clause the positive terms are intersected shortest list first so
+ * the running result only shrinks, then the negated terms are subtracted.
+ * The clause results are merged for OR.
+ *
+ * @param query The parsed query
+ * @param skills Skill group id -> sorted row ids
+ * @param skillNames Dictionary the skill group ids come from
+ * @param universe Every live row id, sorted (used by clauses with only NOT terms)
+ * @return Sorted row ids matching the query
+ */
+vector<uint32_t> evaluateSkillQuery(const SkillQuery& query, const PostingIndex& skills, const StringDictionary& skillNames,
+                                    const vector<uint32_t>& universe) {
+    static const vector<uint32_t> empty;
+    vector<uint32_t> result;
+    vector<uint32_t> clauseRows;
+    vector<uint32_t> scratch;
+
+    for (size_t c = 0; c < query.clauses.size(); ++c) {
+        vector<const vector<uint32_t>*> include;
+        vector<const vector<uint32_t>*> exclude;
+        for (size_t t = 0; t < query.clauses[c].size(); ++t) {
+            const SkillTerm& term = query.clauses[c][t];
+            uint32_t skillId;
+            const vector<uint32_t>* list = skillNames.findGroup(term.skill, skillId) ? &skills.rows(skillId) : &empty;
+            (term.negated ? exclude : include).push_back(list);
+        }
+
+        if (include.empty()) {
+            clauseRows = universe;
+        }
+        else {
+            sort(include.begin(), include.end(),
+                 [](const vector<uint32_t>* a, const vector<uint32_t>* b) { return a->size() < b->size(); });
+            clauseRows = *include[0];
+            for (size_t i = 1; i < include.size() && !clauseRows.empty(); ++i) {
+                intersectPostings(clauseRows, *include[i], scratch);
+                clauseRows.swap(scratch);
+            }
+        }
+
+        for (size_t i = 0; i < exclude.size() && !clauseRows.empty(); ++i) {
+            scratch.clear();
+            set_difference(clauseRows.begin(), clauseRows.end(), exclude[i]->begin(), exclude[i]->end(),
+                           back_inserter(scratch));
+            clauseRows.swap(scratch);
+        }
+
+        scratch.clear();
+        set_union(result.begin(), result.end(), clauseRows.begin(), clauseRows.end(), back_inserter(scratch));
+        result.swap(scratch);
+    }
+
+    return result;
+}
+
+//============================================================================
+// Compressed row bitmaps and record filters
+//============================================================================
+
+/*
+ * Set of row ids in the roaring layout. Ids are split by their high 16 bits
+ * into containers of up to 65536 rows. A sparse container is a sorted array
+ * of the low 16 bits. Past 4096 rows it becomes a 65536-bit bitset, which is
+ * never larger than the array it replaces. Bitset pairs combine 128 bits at a
+ * time, and every container keeps its cardinality, so counts never list rows.
+ */
+class RowBitmap {
+
+public:
+    enum Operation { AND, OR, ANDNOT };
+
+private:
+    struct Container {
+        uint16_t key;              // High 16 bits shared by every row in the container
+        uint32_t cardinality;
+        vector<uint16_t> array;    // Sorted low bits while sparse
+        vector<uint64_t> bits;     // BITSET_WORDS words once dense; the array is then empty
+
+        bool isBitset() const { return !bits.empty(); }
+    };
+
+    static const uint32_t ARRAY_LIMIT = 4096;
+    static const size_t BITSET_WORDS = 1024;
+
+    vector<Container> containers;  // Sorted by key
+
+    size_t findContainer(uint16_t key) const;
+    static void toBitset(Container& container);
+    static void toArray(Container& container);
+    static uint32_t combineWords(const uint64_t* a, const uint64_t* b, uint64_t* out, Operation operation);
+    static bool combineContainers(const Container& a, const Container& b, Operation operation, Container& out);
+    static uint32_t intersectionSize(const Container& a, const Container& b);
+
+public:
+    void add(uint32_t row);
+    void remove(uint32_t row);
+    bool contains(uint32_t row) const;
+    uint64_t cardinality() const;
+    bool empty() const;
+    void clear();
+    size_t memoryBytes() const;
+    void toRows(vector<uint32_t>& out) const;
+
+    static RowBitmap combine(const RowBitmap& a, const RowBitmap& b, Operation operation);
+    static uint64_t intersectCount(const RowBitmap& a, const RowBitmap& b);
+};
+
+/**
+ * Position of the first container whose key is not less than a key
+ *
+ * @param key High 16 bits of a row id
+ * @return Index into containers (containers.size() if every key is smaller)
+ */
+size_t RowBitmap::findContainer(uint16_t key) const {
+    size_t low = 0;
+    size_t high = containers.size();
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (containers[middle].key < key) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/**
+ * Switch a container from array to bitset form
+ *
+ * @param container The container to convert
+ */
+void RowBitmap::toBitset(Container& container) {
+    container.bits.assign(BITSET_WORDS, 0);
+    for (size_t i = 0; i < container.array.size(); ++i) {
+        container.bits[container.array[i] >> 6] |= 1ULL << (container.array[i] & 63);
+    }
+    vector<uint16_t>().swap(container.array);
+}
+
+/**
+ * Switch a container from bitset to array form
+ *
+ * @param container The container to convert
+ */
+void RowBitmap::toArray(Container& container) {
+    container.array.clear();
+    container.array.reserve(container.cardinality);
+    for (size_t w = 0; w < BITSET_WORDS; ++w) {
+        uint64_t word = container.bits[w];
+        while (word != 0) {
+            container.array.push_back(static_cast<uint16_t>(w * 64 + countTrailingZeros64(word)));
+            word &= word - 1;
+        }
+    }
+    vector<uint64_t>().swap(container.bits);
+}
+
+/**
+ * Combine two bitsets word by word
+ *
+ * @param a First bitset (BITSET_WORDS words)
+ * @param b Second bitset (BITSET_WORDS words)
+ * @param out Receives the combined bitset
+ * @param operation AND, OR or ANDNOT (a and not b)
+ * @return Number of bits set in the result
+ */
+uint32_t RowBitmap::combineWords(const uint64_t* a, const uint64_t* b, uint64_t* out, Operation operation) {
+    uint32_t count = 0;
+#ifdef EMPLOYEE_HAVE_SSE2
+    for (size_t w = 0; w < BITSET_WORDS; w += 2) {
+        __m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + w));
+        __m128i right = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + w));
+        __m128i result = operation == AND ? _mm_and_si128(left, right)
+                       : operation == OR ? _mm_or_si128(left, right)
+                       : _mm_andnot_si128(right, left);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + w), result);
+        count += popCount64(out[w]) + popCount64(out[w + 1]);
+    }
+#else
+    for (size_t w = 0; w < BITSET_WORDS; ++w) {
+        out[w] = operation == AND ? a[w] & b[w] : operation == OR ? a[w] | b[w] : a[w] & ~b[w];
+        count += popCount64(out[w]);
+    }
+#endif
+    return count;
+}
+
+/**
+ * Combine two containers with the same key
+ *
+ * @param a First container
+ * @param b Second container
+ * @param operation AND, OR or ANDNOT (a and not b)
+ * @param out Receives the result, in whichever form suits its cardinality
+ * @return False if the result is empty
+ */
+bool RowBitmap::combineContainers(const Container& a, const Container& b, Operation operation, Container& out) {
+    out.key = a.key;
+    out.array.clear();
+    out.bits.clear();
+
+    if (a.isBitset() && b.isBitset()) {
+        out.bits.resize(BITSET_WORDS);
+        out.cardinality = combineWords(a.bits.data(), b.bits.data(), out.bits.data(), operation);
+    }
+    else if (a.isBitset() || b.isBitset()) {
+        const Container& dense = a.isBitset() ? a : b;
+        const Container& sparse = a.isBitset() ? b : a;
+        if (operation == OR || (operation == ANDNOT && a.isBitset())) {
+            // Start from the bitset and set or clear the array's bits
+            out.bits = dense.bits;
+            out.cardinality = dense.cardinality;
+            for (size_t i = 0; i < sparse.array.size(); ++i) {
+                uint64_t& word = out.bits[sparse.array[i] >> 6];
+                uint64_t bit = 1ULL << (sparse.array[i] & 63);
+                if (operation == OR && !(word & bit)) {
+                    word |= bit;
+                    out.cardinality++;
+                }
+                else if (operation == ANDNOT && (word & bit)) {
+                    word &= ~bit;
+                    out.cardinality--;
+                }
+            }
+        }
+        else {
+            // Keep the array values whose bit is set (AND) or clear (array ANDNOT bitset)
+            bool keepSet = operation == AND;
+            for (size_t i = 0; i < sparse.array.size(); ++i) {
+                bool set = (dense.bits[sparse.array[i] >> 6] >> (sparse.array[i] & 63)) & 1;
+                if (set == keepSet) {
+                    out.array.push_back(sparse.array[i]);
+                }
+            }
+            out.cardinality = static_cast<uint32_t>(out.array.size());
+        }
+    }
+    else {
+        if (operation == AND) {
+            set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), back_inserter(out.array));
+        }
+        else if (operation == OR) {
+            set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), back_inserter(out.array));
+        }
+        else {
+            set_difference(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), back_inserter(out.array));
+        }
+        out.cardinality = static_cast<uint32_t>(out.array.size());
+        if (out.cardinality > ARRAY_LIMIT) {
+            toBitset(out);
+        }
+    }
+
+    if (out.isBitset() && out.cardinality <= ARRAY_LIMIT) {
+        toArray(out);
+    }
+    return out.cardinality > 0;
+}
+
+/**
+ * Count the rows two containers with the same key have in common
+ *
+ * @param a First container
+ * @param b Second container
+ * @return Size of the intersection
+ */
+uint32_t RowBitmap::intersectionSize(const Container& a, const Container& b) {
+    uint32_t count = 0;
+    if (a.isBitset() && b.isBitset()) {
+        for (size_t w = 0; w < BITSET_WORDS; ++w) {
+            count += popCount64(a.bits[w] & b.bits[w]);
+        }
+    }
+    else if (a.isBitset() || b.isBitset()) {
+        const Container& dense = a.isBitset() ? a : b;
+        const Container& sparse = a.isBitset() ? b : a;
+        for (size_t i = 0; i < sparse.array.size(); ++i) {
+            count += (dense.bits[sparse.array[i] >> 6] >> (sparse.array[i] & 63)) & 1;
+        }
+    }
+    else {
+        size_t i = 0;
+        size_t j = 0;
+        while (i < a.array.size() && j < b.array.size()) {
+            if (a.array[i] < b.array[j]) {
+                i++;
+            }
+            else if (b.array[j] < a.array[i]) {
+                j++;
+            }
+            else {
+                count++;
+                i++;
+                j++;
+            }
+        }
+    }
+    return count;
+}
+
+/**
+ * Add a row
+ *
+ * @param row The row id
+ */
+void RowBitmap::add(uint32_t row) {
+    uint16_t key = static_cast<uint16_t>(row >> 16);
+    uint16_t low = static_cast<uint16_t>(row & 0xFFFF);
+    size_t index = findContainer(key);
+    if (index == containers.size() || containers[index].key != key) {
+        Container container;
+        container.key = key;
+        container.cardinality = 0;
+        containers.insert(containers.begin() + index, container);
+    }
+
+    Container& container = containers[index];
+    if (container.isBitset()) {
+        uint64_t& word = container.bits[low >> 6];
+        uint64_t bit = 1ULL << (low & 63);
+        if (!(word & bit)) {
+            word |= bit;
+            container.cardinality++;
+        }
+        return;
+    }
+
+    // Rows mostly arrive in increasing order, so check the end first
+    if (container.array.empty() || container.array.back() < low) {
+        container.array.push_back(low);
+    }
+    else {
+        vector<uint16_t>::iterator position = lower_bound(container.array.begin(), container.array.end(), low);
+        if (*position == low) {
+            return;
+        }
+        container.array.insert(position, low);
+    }
+    container.cardinality++;
+    if (container.cardinality > ARRAY_LIMIT) {
+        toBitset(container);
+    }
+}
+
+/**
+ * Remove a row if present
+ *
+ * @param row The row id
+ */
+void RowBitmap::remove(uint32_t row) {
+    uint16_t key = static_cast<uint16_t>(row >> 16);
+    uint16_t low = static_cast<uint16_t>(row & 0xFFFF);
+    size_t index = findContainer(key);
+    if (index == containers.size() || containers[index].key != key) {
+        return;
+    }
+
+    Container& container = containers[index];
+    if (container.isBitset()) {
+        uint64_t& word = container.bits[low >> 6];
+        uint64_t bit = 1ULL << (low & 63);
+        if (!(word & bit)) {
+            return;
+        }
+        word &= ~bit;
+        container.cardinality--;
+        if (container.cardinality <= ARRAY_LIMIT) {
+            toArray(container);
+        }
+    }
+    else {
+        vector<uint16_t>::iterator position = lower_bound(container.array.begin(), container.array.end(), low);
+        if (position == container.array.end() || *position != low) {
+            return;
+        }
+        container.array.erase(position);
+        container.cardinality--;
+    }
+
+    if (container.cardinality == 0) {
+        containers.erase(containers.begin() + index);
+    }
+}
+
+/**
+ * Check whether a row is present
+ *
+ * @param row The row id
+ * @return True if the row is in the bitmap
+ */
+bool RowBitmap::contains(uint32_t row) const {
+    uint16_t key = static_cast<uint16_t>(row >> 16);
+    uint16_t low = static_cast<uint16_t>(row & 0xFFFF);
+    size_t index = findContainer(key);
+    if (index == containers.size() || containers[index].key != key) {
+        return false;
+    }
+
+    const Container& container = containers[index];
+    if (container.isBitset()) {
+        return (container.bits[low >> 6] >> (low & 63)) & 1;
+    }
+    return binary_search(container.array.begin(), container.array.end(), low);
+}
+
+/**
+ * Number of rows in the bitmap
+ *
+ * @return Sum of the container cardinalities
+ */
+uint64_t RowBitmap::cardinality() const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < containers.size(); ++i) {
+        total += containers[i].cardinality;
+    }
+    return total;
+}
+
+/**
+ * Check whether the bitmap has no rows
+ *
+ * @return True if empty
+ */
+bool RowBitmap::empty() const {
+    return containers.empty();
+}
+
+/**
+ * Remove every row
+ */
+void RowBitmap::clear() {
+    containers.clear();
+}
+
+/**
+ * Heap and object bytes used by the bitmap
+ *
+ * @return Approximate memory footprint
+ */
+size_t RowBitmap::memoryBytes() const {
+    size_t bytes = sizeof(RowBitmap) + containers.capacity() * sizeof(Container);
+    for (size_t i = 0; i < containers.size(); ++i) {
+        bytes += containers[i].array.capacity() * sizeof(uint16_t) + containers[i].bits.capacity() * sizeof(uint64_t);
+    }
+    return bytes;
+}
+
+/**
+ * List the rows in increasing order
+ *
+ * @param out Receives the row ids (appended)
+ */
+void RowBitmap::toRows(vector<uint32_t>& out) const {
+    for (size_t c = 0; c < containers.size(); ++c) {
+        const Container& container = containers[c];
+        uint32_t base = static_cast<uint32_t>(container.key) << 16;
+        if (container.isBitset()) {
+            for (size_t w = 0; w < BITSET_WORDS; ++w) {
+                uint64_t word = container.bits[w];
+                while (word != 0) {
+                    out.push_back(base + static_cast<uint32_t>(w * 64 + countTrailingZeros64(word)));
+                    word &= word - 1;
+                }
+            }
+        }
+        else {
+            for (size_t i = 0; i < container.array.size(); ++i) {
+                out.push_back(base + container.array[i]);
+            }
+        }
+    }
+}
+
+/**
+ * Combine two bitmaps
+ *
+ * @param a First bitmap
+ * @param b Second bitmap
+ * @param operation AND, OR or ANDNOT (rows of a not in b)
+ * @return The combined bitmap
+ */
+RowBitmap RowBitmap::combine(const RowBitmap& a, const RowBitmap& b, Operation operation) {
+    RowBitmap result;
+    size_t i = 0;
+    size_t j = 0;
+    Container scratch;
+
+    while (i < a.containers.size() || j < b.containers.size()) {
+        bool fromA = j == b.containers.size() || (i < a.containers.size() && a.containers[i].key < b.containers[j].key);
+        bool fromB = i == a.containers.size() || (j < b.containers.size() && b.containers[j].key < a.containers[i].key);
+
+        if (fromA) {
+            if (operation != AND) {
+                result.containers.push_back(a.containers[i]);
+            }
+            i++;
+        }
+        else if (fromB) {
+            if (operation == OR) {
+                result.containers.push_back(b.containers[j]);
+            }
+            j++;
+        }
+        else {
+            if (combineContainers(a.containers[i], b.containers[j], operation, scratch)) {
+                result.containers.push_back(scratch);
+            }
+            i++;
+            j++;
+        }
+    }
+    return result;
+}
+
+/**
+ * Count the rows two bitmaps have in common without building the intersection
+ *
+ * @param a First bitmap
+ * @param b Second bitmap
+ * @return Size of the intersection
+ */
+uint64_t RowBitmap::intersectCount(const RowBitmap& a, const RowBitmap& b) {
+    uint64_t count = 0;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.containers.size() && j < b.containers.size()) {
+        if (a.containers[i].key < b.containers[j].key) {
+            i++;
+        }
+        else if (b.containers[j].key < a.containers[i].key) {
+            j++;
+        }
+        else {
+            count += intersectionSize(a.containers[i], b.containers[j]);
+            i++;
+            j++;
+        }
+    }
+    return count;
+}
+
+/*
+ * Field value -> bitmap of the rows holding it. Values are keyed by group
+ * id in the tree's store, the same way as in PostingIndex.
+ */
+class BitmapIndex {
+
+private:
+    vector<RowBitmap> bitmaps;  // Group id -> rows
+    RowBitmap noRows;
+
+public:
+    void add(uint32_t valueId, uint32_t rowId);
+    void remove(uint32_t valueId, uint32_t rowId);
+    const RowBitmap& rows(uint32_t valueId) const;
+    size_t valueCount() const;
+    size_t memoryBytes() const;
+    void clear();
+};
+
+/**
+ * Record that a row holds a value
+ *
+ * @param valueId The value's group id
+ * @param rowId The row
+ */
+void BitmapIndex::add(uint32_t valueId, uint32_t rowId) {
+    if (valueId >= bitmaps.size()) {
+        bitmaps.resize(valueId + 1);
+    }
+    bitmaps[valueId].add(rowId);
+}
+
+/**
+ * Record that a row no longer holds a value
+ *
+ * @param valueId The value's group id
+ * @param rowId The row
+ */
+void BitmapIndex::remove(uint32_t valueId, uint32_t rowId) {
+    if (valueId < bitmaps.size()) {
+        bitmaps[valueId].remove(rowId);
+    }
+}
+
+/**
+ * Get the rows holding a value
+ *
+ * @param valueId The value's group id
+ * @return The value's bitmap (empty for values no row holds)
+ */
+const RowBitmap& BitmapIndex::rows(uint32_t valueId) const {
+    return valueId < bitmaps.size() ? bitmaps[valueId] : noRows;
+}
+
+/**
+ * One past the highest group id with a bitmap
+ *
+ * @return Number of bitmap slots
+ */
+size_t BitmapIndex::valueCount() const {
+    return bitmaps.size();
+}
+
+/**
+ * Bytes used by all bitmaps
+ *
+ * @return Approximate memory footprint of the bitmaps
+ */
+size_t BitmapIndex::memoryBytes() const {
+    size_t bytes = 0;
+    for (size_t i = 0; i < bitmaps.size(); ++i) {
+        bytes += bitmaps[i].memoryBytes();
+    }
+    return bytes;
+}
+
+/**
+ * Remove all rows
+ */
+void BitmapIndex::clear() {
+    bitmaps.clear();
+}
+
+// Record fields a filter can test
+enum class FilterField {
+    DEPARTMENT,
+    TITLE,
+    SKILL
+};
+
+// One filter term, such as title~Senior or NOT skill=Agile
+struct FilterTerm {
+    FilterField field;
+    bool contains;   // '~' matches values containing the text, '=' whole values (both ignore case)
+    bool negated;
+    string value;
+    vector<uint32_t> valueIds;  // Sorted dictionary ids the term matches, set by resolveFilterIds for record scans
+    SkillSet skills;            // The same ids as a skill set, for skill terms
+};
+
+/*
+ * Record filter in disjunctive normal form, like SkillQuery: it matches an
+ * employee when every term of at least one clause matches.
+ */
+struct RecordFilter {
+    vector<vector<FilterTerm> > clauses;
+};
+
+/**
+ * Parse a record filter such as
+ * "department=Engineering AND title~Senior AND NOT skill=Agile OR department=HR"
+ *
+ * Fields are department, title and skill; '=' compares the whole value and
+ * '~' looks for the text inside the value. NOT binds tightest, then AND, then
+ * OR. A value containing AND or OR can be written in double quotes.
+ *
+ * @param text The filter text
+ * @param filter Receives the parsed filter
+ * @param error Receives a message when the filter is malformed
+ * @return True if the filter parsed
+ */
+bool parseRecordFilter(const string& text, RecordFilter& filter, string& error) {
+    filter.clauses.assign(1, vector<FilterTerm>());
+    size_t i = 0;
+
+    while (true) {
+        FilterTerm term;
+        term.negated = false;
+
+        while (i < text.size() && isspace(static_cast<unsigned char>(text[i]))) {
+            i++;
+        }
+        if (i == text.size()) {
+            error = filter.clauses.size() == 1 && filter.clauses[0].empty()
+                ? "Please enter at least one condition." : "The filter ends without a condition.";
+            return false;
+        }
+        if (i + 3 < text.size() && foldCase(text.substr(i, 3)) == "not" && isspace(static_cast<unsigned char>(text[i + 3]))) {
+            term.negated = true;
+            i += 4;
+            while (i < text.size() && isspace(static_cast<unsigned char>(text[i]))) {
+                i++;
+            }
+        }
+
+        // Field name, then '=' or '~'
+        size_t fieldStart = i;
+        while (i < text.size() && isalpha(static_cast<unsigned char>(text[i]))) {
+            i++;
+        }
+        string field = foldCase(text.substr(fieldStart, i - fieldStart));
+        if (field == "department") {
+            term.field = FilterField::DEPARTMENT;
+        }
+        else if (field == "title") {
+            term.field = FilterField::TITLE;
+        }
+        else if (field == "skill") {
+            term.field = FilterField::SKILL;
+        }
+        else {
+            error = "Unknown field \"" + text.substr(fieldStart, i - fieldStart) + "\" (use department, title or skill).";
+            return false;
+        }
+        while (i < text.size() && isspace(static_cast<unsigned char>(text[i]))) {
+            i++;
+        }
+        if (i == text.size() || (text[i] != '=' && text[i] != '~')) {
+            error = "Expected = or ~ after " + field + ".";
+            return false;
+        }
+        term.contains = text[i] == '~';
+        i++;
+        while (i < text.size() && isspace(static_cast<unsigned char>(text[i]))) {
+            i++;
+        }
+
+        // Value: a quoted phrase, or words up to the next AND/OR
+        if (i < text.size() && text[i] == '"') {
+            size_t close = text.find('"', i + 1);
+            if (close == string::npos) {
+                error = "Missing closing quote.";
+                return false;
+            }
+            term.value = text.substr(i + 1, close - i - 1);
+            i = close + 1;
+        }
+        else {
+            while (i < text.size()) {
+                size_t wordStart = i;
+                while (wordStart < text.size() && isspace(static_cast<unsigned char>(text[wordStart]))) {
+                    wordStart++;
+                }
+                size_t wordEnd = wordStart;
+                while (wordEnd < text.size() && !isspace(static_cast<unsigned char>(text[wordEnd]))) {
+                    wordEnd++;
+                }
+                string keyword = foldCase(text.substr(wordStart, wordEnd - wordStart));
+                if (wordStart == wordEnd || keyword == "and" || keyword == "or") {
+                    break;
+                }
+                term.value += (term.value.empty() ? "" : " ") + text.substr(wordStart, wordEnd - wordStart);
+                i = wordEnd;
+            }
+        }
+        if (term.value.empty()) {
+            error = "Missing value for " + field + ".";
+            return false;
+        }
+        filter.clauses.back().push_back(term);
+
+        // AND, OR or the end
+        while (i < text.size() && isspace(static_cast<unsigned char>(text[i]))) {
+            i++;
+        }
+        if (i == text.size()) {
+            return true;
+        }
+        size_t wordEnd = i;
+        while (wordEnd < text.size() && !isspace(static_cast<unsigned char>(text[wordEnd]))) {
+            wordEnd++;
+        }
+        string keyword = foldCase(text.substr(i, wordEnd - i));
+        if (keyword == "or") {
+            filter.clauses.push_back(vector<FilterTerm>());
+        }
+        else if (keyword != "and") {
+            error = "Expected AND or OR before " + text.substr(i, wordEnd - i) + ".";
+            return false;
+        }
+        i = wordEnd;
+    }
+}
+
+//============================================================================
+// Reporting structure validation
+//============================================================================
+
+/**
+ * Split the range [0, count) into one contiguous chunk per thread and run
+ * work(begin, end, threadIndex) on each chunk concurrently
+ *
+ * @param count Number of items
+ * @param threadCount Number of threads to use (at least 1)
+ * @param work Callable taking (size_t begin, size_t end, unsigned threadIndex)
+ */
+template <typename Work>
+void runInParallel(size_t count, unsigned threadCount, Work work) {
+    threadCount = static_cast<unsigned>(max<size_t>(1, min<size_t>(threadCount, count)));
+    if (threadCount <= 1) {
+        work(0, count, 0u);
+        return;
+    }
+
+    vector<thread> threads;
+    size_t chunk = (count + threadCount - 1) / threadCount;
+    for (unsigned t = 0; t < threadCount; ++t) {
+        size_t begin = min(count, t * chunk);
+        size_t end = min(count, begin + chunk);
+        threads.push_back(thread(work, begin, end, t));
+    }
+    for (size_t t = 0; t < threads.size(); ++t) {
+        threads[t].join();
+    }
+}
+
+// Problems found in the reporting structure
+struct ValidationIssues {
+    vector<string> duplicateIds;
+    vector<pair<string, string> > danglingManagers;  // (employee ID, manager ID that does not exist)
+    vector<vector<string> > cycles;                  // Each cycle in reporting order, smallest ID first
+};
+
+/*
+ * Checks a reporting graph given as parallel arrays of IDs and manager IDs.
+ * Every phase runs over contiguous chunks on all threads:
+ *
+ *  1. hash every ID and insert it into a lock-free open-addressing table;
+ *  2. resolve each manager ID through the table, collecting dangling ones;
+ *  3. union each employee with their manager in a lock-free union-find.
+ *
+ * Each employee has at most one manager, so a component holds at most one
+ * cycle. The one edge per cycle that finds both ends already connected is
+ * always on the cycle, because the employee it leaves has no other path to
+ * its manager. The cycle is then read off by following managers from there.
+ */
+class ReportingGraphValidator {
+
+private:
+    static const uint32_t NO_ROW = 0xFFFFFFFF;
+
+    const vector<StringView>& ids;
+    const vector<StringView>& managerIds;
+    unsigned threadCount;
+    vector<size_t> hashes;
+    vector<atomic<uint32_t> > slots;  // Row + 1, 0 when empty
+    size_t slotMask;
+    vector<uint32_t> managers;        // Row -> manager's row, or NO_ROW
+    vector<atomic<uint32_t> > sets;   // Union-find parent links
+
+    bool insertId(uint32_t row);
+    uint32_t findRow(const StringView& id, size_t hash) const;
+    uint32_t findSet(uint32_t row);
+    bool unite(uint32_t a, uint32_t b);
+
+public:
+    ReportingGraphValidator(const vector<StringView>& employeeIds, const vector<StringView>& employeeManagerIds,
+                            unsigned threads);
+    ValidationIssues run();
+};
+
+const uint32_t ReportingGraphValidator::NO_ROW;
+
+/**
+ * Constructor
+ *
+ * @param employeeIds Each employee's ID
+ * @param employeeManagerIds Each employee's manager ID (empty for none), same order
+ * @param threads Number of threads to use
+ */
+ReportingGraphValidator::ReportingGraphValidator(const vector<StringView>& employeeIds,
+                                                 const vector<StringView>& employeeManagerIds, unsigned threads)
+    : ids(employeeIds), managerIds(employeeManagerIds), threadCount(max(1u, threads)), slotMask(0) {
+}
+
+/**
+ * Claim a table slot for a row's ID
+ *
+ * @param row The row to insert
+ * @return False if the ID appears more than once (one such call per extra copy)
+ */
+bool ReportingGraphValidator::insertId(uint32_t row) {
+    size_t position = hashes[row] & slotMask;
+    while (true) {
+        uint32_t occupant = slots[position].load();
+        if (occupant == 0) {
+            if (slots[position].compare_exchange_strong(occupant, row + 1)) {
+                return true;
+            }
+            continue;  // Another row took the slot first; look at it
+        }
+
+        uint32_t other = occupant - 1;
+        if (hashes[other] == hashes[row] && ids[other] == ids[row]) {
+            // The earliest row keeps the ID, so results never depend on thread timing
+            if (other < row || slots[position].compare_exchange_strong(occupant, row + 1)) {
+                return false;
+            }
+            continue;
+        }
+        position = (position + 1) & slotMask;
+    }
+}
+
+/**
+ * Look up the row holding an ID
+ *
+ * @param id The ID to find
+ * @param hash hashText of the ID
+ * @return The row, or NO_ROW if no employee has the ID
+ */
+uint32_t ReportingGraphValidator::findRow(const StringView& id, size_t hash) const {
+    for (size_t position = hash & slotMask; ; position = (position + 1) & slotMask) {
+        uint32_t occupant = slots[position].load();
+        if (occupant == 0) {
+            return NO_ROW;
+        }
+        if (hashes[occupant - 1] == hash && ids[occupant - 1] == id) {
+            return occupant - 1;
+        }
+    }
+}
+
+/**
+ * Find the representative of a row's set, halving the path on the way
+ *
+ * @param row Any row
+ * @return The set's root row
+ */
+uint32_t ReportingGraphValidator::findSet(uint32_t row) {
+    while (true) {
+        uint32_t parent = sets[row].load();
+        if (parent == row) {
+            return row;
+        }
+        uint32_t grandparent = sets[parent].load();
+        if (grandparent != parent) {
+            // Losing this race is harmless: another thread shortened the path
+            sets[row].compare_exchange_weak(parent, grandparent);
+        }
+        row = grandparent;
+    }
+}
+
+/**
+ * Merge the sets of two rows
+ *
+ * Roots are linked larger index under smaller, and only with a
+ * compare-and-swap that confirms the root is still a root.
+ *
+ * @param a First row
+ * @param b Second row
+ * @return False if the rows were already in the same set
+ */
+bool ReportingGraphValidator::unite(uint32_t a, uint32_t b) {
+    while (true) {
+        a = findSet(a);
+        b = findSet(b);
+        if (a == b) {
+            return false;
+        }
+        if (a < b) {
+            swap(a, b);
+        }
+        uint32_t expected = a;
+        if (sets[a].compare_exchange_strong(expected, b)) {
+            return true;
+        }
+    }
+}
+
+/**
+ * Run all checks
+ *
+ * @return Every duplicate ID, dangling manager reference and reporting cycle
+ */
+ValidationIssues ReportingGraphValidator::run() {
+    size_t count = ids.size();
+    ValidationIssues issues;
+    vector<ValidationIssues> found(threadCount);
+
+    size_t slotCount = 16;
+    while (slotCount < count * 2) {
+        slotCount *= 2;
+    }
+    slotMask = slotCount - 1;
+    hashes.resize(count);
+    vector<atomic<uint32_t> >(slotCount).swap(slots);
+    vector<atomic<uint32_t> >(count).swap(sets);
+    managers.resize(count);
+
+    runInParallel(slotCount, threadCount, [this](size_t begin, size_t end, unsigned) {
+        for (size_t i = begin; i < end; ++i) {
+            slots[i].store(0, memory_order_relaxed);
+        }
+    });
+    runInParallel(count, threadCount, [this, &found](size_t begin, size_t end, unsigned thread) {
+        for (size_t row = begin; row < end; ++row) {
+            hashes[row] = hashText(ids[row]);
+            sets[row].store(static_cast<uint32_t>(row), memory_order_relaxed);
+        }
+        for (size_t row = begin; row < end; ++row) {
+            if (!insertId(static_cast<uint32_t>(row))) {
+                found[thread].duplicateIds.push_back(ids[row].str());
+            }
+        }
+    });
+
+    runInParallel(count, threadCount, [this, &found](size_t begin, size_t end, unsigned thread) {
+        for (size_t row = begin; row < end; ++row) {
+            const StringView& managerId = managerIds[row];
+            managers[row] = managerId.empty() ? NO_ROW : findRow(managerId, hashText(managerId));
+            if (!managerId.empty() && managers[row] == NO_ROW) {
+                found[thread].danglingManagers.push_back(make_pair(ids[row].str(), managerId.str()));
+            }
+        }
+    });
+
+    // Rows whose link closes a cycle; each cycle is reported by exactly one of them
+    vector<vector<uint32_t> > closingRows(threadCount);
+    runInParallel(count, threadCount, [this, &closingRows](size_t begin, size_t end, unsigned thread) {
+        for (size_t row = begin; row < end; ++row) {
+            if (managers[row] != NO_ROW && !unite(static_cast<uint32_t>(row), managers[row])) {
+                closingRows[thread].push_back(static_cast<uint32_t>(row));
+            }
+        }
+    });
+
+    for (unsigned t = 0; t < threadCount; ++t) {
+        issues.duplicateIds.insert(issues.duplicateIds.end(), found[t].duplicateIds.begin(), found[t].duplicateIds.end());
+        issues.danglingManagers.insert(issues.danglingManagers.end(), found[t].danglingManagers.begin(),
+                                       found[t].danglingManagers.end());
+        for (size_t i = 0; i < closingRows[t].size(); ++i) {
+            vector<string> cycle;
+            uint32_t start = closingRows[t][i];
+            uint32_t row = start;
+            do {
+                cycle.push_back(ids[row].str());
+                row = managers[row];
+            } while (row != start);
+            rotate(cycle.begin(), min_element(cycle.begin(), cycle.end()), cycle.end());
+            issues.cycles.push_back(cycle);
+        }
+    }
+
+    sort(issues.duplicateIds.begin(), issues.duplicateIds.end());
+    sort(issues.danglingManagers.begin(), issues.danglingManagers.end());
+    sort(issues.cycles.begin(), issues.cycles.end());
+    return issues;
+}
+
+//============================================================================
+// Binary Search Tree class definition
+//============================================================================
+
+class BinarySearchTree {
+
+private:
+    Node* root;
+    IndexBackend backend;
+    shared_ptr<EmployeeStore> store;  // Text and values of the employees, shared with copies of the tree
+    AdaptiveRadixTree radixIndex;  // Only populated for IndexBackend::RADIX
+    EmployeeCache cache;           // Hot nodes resolved by findEmployeeById
+    BloomFilter idFilter;          // Rejects most unknown IDs before any lookup
+    uint64_t filterRejected;
+    uint64_t filterFalsePositives;
+    size_t employeeCount;
+    size_t deadTextBytes;          // Store text only removed or replaced employees still point at
+    vector<string> skippedDuplicates;  // IDs the last load left out because an earlier record had them
+    vector<Node*> rows;            // Row id -> node (nullptr once removed)
+    PostingIndex departmentIndex;  // Department -> row ids
+    PostingIndex managerIndex;     // Manager ID -> row ids of direct reports, matched exactly like locateNode
+    PostingIndex skillIndex;       // Skill -> row ids
+    NamePrefixIndex nameIndex;     // Name words -> row ids
+    TrigramIndex nameTrigrams;     // Name trigrams -> row ids, for fuzzy search
+    BitmapIndex departmentBitmaps; // Department -> row bitmap, for record filters
+    BitmapIndex titleBitmaps;      // Title -> row bitmap
+    BitmapIndex skillBitmaps;      // Skill -> row bitmap
+    RowBitmap liveRows;            // Every row in use
+
+    // Euler-tour layout of the reporting forest: every org subtree is a contiguous range
+    vector<uint32_t> orgTour;      // Row ids in depth-first order
+    vector<uint32_t> tourEntry;    // Row id -> position of the employee in orgTour
+    vector<uint32_t> tourExit;     // Row id -> one past the last position of their org
+    vector<uint32_t> tourDepth;    // Row id -> number of managers above the employee
+    vector<uint32_t> tourParent;   // Row id -> row of the manager above in the tour, or NO_MANAGER
+    vector<uint32_t> depthAtPosition;             // Tour position -> depth, scanned by range-minimum queries
+    vector<vector<uint32_t> > blockMinima;        // [level][block] -> shallowest position in 2^level blocks
+    bool orgTourValid;
+
+    // Running totals for every manager's whole org, kept current on each change
+    vector<uint32_t> orgParent;    // Row id -> row of the manager it counts toward, or NO_MANAGER
+    vector<uint32_t> orgHeadcount; // Row id -> number of employees under them, all levels
+    vector<vector<pair<uint32_t, uint32_t> > > orgDepartmentMix;  // Row id -> (department id, count), by id
+
+    static const uint32_t NO_MANAGER = 0xFFFFFFFF;
+    static const uint32_t TOUR_BLOCK = 32;        // Tour positions per range-minimum block
+
+    Node* searchNode(Node* node, const string& employeeId);
+    Node* locateNode(const string& employeeId);
+    void printEmployeeList(Node* node);
+    void destroyTree(Node* node);
+    Node* copyTree(Node* node);  // Helper to deep copy a tree
+    Node* buildBalanced(vector<Employee>& employees, size_t begin, size_t end);
+    void collectEmployees(Node* node, vector<const Employee*>& employees) const;
+    void rebuildIndexes();
+    void rebuildFilter(size_t expectedKeys);
+    void indexSubtree(Node* node);
+    void filterSubtree(Node* node);
+    void assignRows(Node* node);
+    void addToSecondaryIndexes(Node* node);
+    void indexFields(Node* node);
+    void removeFromSecondaryIndexes(Node* node);
+    void rebuildOrgTour();
+    void appendOrgSubtree(uint32_t rootRow, const vector<uint32_t>& reportKeys, vector<bool>& visited);
+    void resolveManagerRows(vector<uint32_t>& managerRows, vector<uint32_t>& reportKeys);
+    void buildBlockMinima();
+    uint32_t shallowestPosition(uint32_t first, uint32_t last) const;
+    uint32_t lowestCommonManagerRow(uint32_t a, uint32_t b);
+    void attachToOrgTotals(Node* node);
+    void rebuildOrgTotals();
+    void detachFromOrgTotals(Node* node);
+    void propagateOrgTotals(uint32_t row, int sign);
+    vector<pair<uint32_t, uint32_t> > ownAndOrgMix(uint32_t row) const;
+    static void mergeDepartmentMix(vector<pair<uint32_t, uint32_t> >& totals, const vector<pair<uint32_t, uint32_t> >& mix, int sign);
+    void printOrgLine(const Employee& employee, size_t indent);
+    const RowBitmap* filterTermRows(const FilterTerm& term, RowBitmap& scratch) const;
+    void collectClauseRows(const vector<FilterTerm>& clause, vector<RowBitmap>& scratch,
+                           vector<const RowBitmap*>& include, vector<const RowBitmap*>& exclude) const;
+    RowBitmap evaluateFilter(const RecordFilter& filter) const;
+
+    // AVL helper functions:
+    int getHeight(Node* node);
+    int getBalance(Node* node);
+    void updateHeight(Node* node);
+    Node* rotateRight(Node* y);
+    Node* rotateLeft(Node* x);
+    Node* insertNodeAVL(Node* node, Employee employee, Node*& insertedNode);  // AVL insert
+    Node* removeNodeAVL(Node* node, const string& employeeId, Node*& removedNode);  // AVL delete
+    Node* detachMin(Node* node, Node*& minNode);
+    Node* rebalance(Node* node);
+
+public:
+    explicit BinarySearchTree(IndexBackend indexBackend = IndexBackend::AVL);
+    ~BinarySearchTree();
+    BinarySearchTree(const BinarySearchTree& other);                    // Copy constructor
+    BinarySearchTree& operator=(const BinarySearchTree& other);        // Assignment operator
+    void displayEmployee(const Employee& employee);
+    bool addEmployee(Employee employee);
+    bool updateEmployee(const Employee& employee);
+    bool removeEmployee(const string& employeeId);
+    void clear();
+    void bulkLoad(vector<Employee>& employees);
+    void compactStore();
+    size_t getDeadTextBytes() const;
+    void setSkippedDuplicates(const vector<string>& employeeIds);
+    const shared_ptr<EmployeeStore>& employeeStore() const;
+    vector<const Employee*> getEmployeesInOrder() const;
+    bool saveSnapshot(const string& fileName, uint64_t generation, string& error) const;
+    bool loadSnapshot(const string& fileName, uint64_t& generation, string& error);
+    void printEmployeeList();
+    Employee findEmployeeById(const string& employeeId);
+    IndexBackend getIndexBackend() const;
+    size_t size() const;
+    void setCacheCapacity(size_t maxEntries);
+    CacheStats getCacheStats();
+    void resetCacheStats();
+    void setFilterFalsePositiveRate(double rate);
+    FilterStats getFilterStats() const;
+    bool printDepartmentList(const string& department);
+    vector<pair<string, size_t> > getDepartmentHeadcounts() const;
+    size_t printDirectReports(const string& managerId);
+    size_t printOrgSubtree(const string& managerId);
+    bool isInOrganization(const string& employeeId, const string& managerId);
+    Employee findLowestCommonManager(const string& firstId, const string& secondId);
+    ValidationIssues validateReportingStructure(unsigned threadCount) const;
+    size_t getOrgHeadcount(const string& managerId);
+    vector<pair<string, size_t> > getOrgDepartmentMix(const string& managerId);
+    size_t printSkillMatches(const SkillQuery& query);
+    vector<Employee> findEmployeesByNamePrefix(const string& prefix, size_t limit);
+    vector<pair<unsigned, Employee> > findEmployeesByFuzzyName(const string& query, unsigned maxDistance, size_t limit);
+    uint64_t countFilterMatches(const RecordFilter& filter) const;
+    size_t printFilterMatches(const RecordFilter& filter);
+};
+
+const uint32_t BinarySearchTree::NO_MANAGER;
+const uint32_t BinarySearchTree::TOUR_BLOCK;
+
+/**
+ * Default constructor
+ *
+ * @param indexBackend Structure used for lookups and ordered listings
+ */
+BinarySearchTree::BinarySearchTree(IndexBackend indexBackend)
+    : backend(indexBackend), store(make_shared<EmployeeStore>()), filterRejected(0), filterFalsePositives(0), employeeCount(0),
+      deadTextBytes(0), orgTourValid(false) {
+    // Initialize empty tree
+    root = nullptr;
+    idFilter.reset(0);
+}
+
+/**
+ * Number of employees stored in the tree
+ */
+size_t BinarySearchTree::size() const {
+    return employeeCount;
+}
+
+/**
+ * Change how many resolved records the lookup cache keeps
+ *
+ * @param maxEntries Maximum cached records (0 disables the cache)
+ */
+void BinarySearchTree::setCacheCapacity(size_t maxEntries) {
+    cache.setCapacity(maxEntries);
+}
+
+/**
+ * Get the lookup cache hit, miss and invalidation counters
+ */
+CacheStats BinarySearchTree::getCacheStats() {
+    return cache.getStats();
+}
+
+/**
+ * Reset the lookup cache counters
+ */
+void BinarySearchTree::resetCacheStats() {
+    cache.resetStats();
+}
+
+/**
+ * Change the target false-positive rate of the ID filter and rebuild it
+ *
+ * @param rate Target false-positive rate (0 disables the filter)
+ */
+void BinarySearchTree::setFilterFalsePositiveRate(double rate) {
+    idFilter.setFalsePositiveRate(rate);
+    rebuildFilter(employeeCount);
+}
+
+/**
+ * Get the ID filter configuration and rejection counters
+ */
+FilterStats BinarySearchTree::getFilterStats() const {
+    FilterStats stats;
+    stats.configuredRate = idFilter.getFalsePositiveRate();
+    stats.estimatedRate = idFilter.estimatedFalsePositiveRate();
+    stats.rejected = filterRejected;
+    stats.falsePositives = filterFalsePositives;
+    stats.memoryBytes = idFilter.memoryBytes();
+    stats.hashCount = idFilter.getHashCount();
+    return stats;
+}
+
+/**
+ * Get the structure used for lookups and ordered listings
+ */
+IndexBackend BinarySearchTree::getIndexBackend() const {
+    return backend;
+}
+
+/**
+ * Display employee information
+ *
+ * @param employee The employee object containing the ID, name, department, title, manager, and skills
+ */
+void BinarySearchTree::displayEmployee(const Employee& employee) {
+    cout << "Employee ID: " << employee.employeeId << endl;
+    cout << "Full Name: " << employee.fullName << endl;
+    cout << "Department: " << employee.department() << endl;
+    cout << "Title: " << employee.title() << endl;
+    cout << "Manager ID: ";
+
+    // If there is no manager, output "None" (for executives)
+    if (employee.managerId().empty()) {
+        cout << "None (Executive Level)";
+    }
+    else {
+        cout << employee.managerId();
+    }
+    cout << endl;
+
+    cout << "Skills: ";
+    // If there are no skills, output "None"
+    if (employee.skillCount() == 0) {
+        cout << "None";
+    }
+    // Else output all skills
+    else {
+        for (size_t i = 0; i < employee.skillCount(); ++i) {
+            cout << employee.skill(i);
+            if (i < employee.skillCount() - 1) {
+                cout << ", ";  // Add comma between skills
+            }
+        }
+    }
+    cout << endl;
+}
+
+/**
+ * Insert a new employee into the AVL tree
+ *
+ * @param employee The employee object to be added to the tree
+ * @return False if an employee with the same ID is already in the tree
+ */
+bool BinarySearchTree::addEmployee(Employee employee) {
+    employee.moveToStore(store);
+    Node* insertedNode = nullptr;
+    root = insertNodeAVL(root, employee, insertedNode);  // Use AVL insertion and update root
+
+    if (insertedNode == nullptr) {
+        return false;  // Duplicate ID, tree unchanged
+    }
+    employeeCount++;
+
+    // Resize the filter once it holds more keys than it was sized for
+    if (employeeCount > idFilter.getCapacity()) {
+        rebuildFilter(employeeCount * 2);
+    }
+    else {
+        idFilter.add(insertedNode->employee.employeeId.str());
+    }
+
+    // Keep the radix index pointing at the new node
+    if (backend == IndexBackend::RADIX) {
+        radixIndex.insert(insertedNode->employee.employeeId.str(), insertedNode);
+    }
+    cache.invalidate(insertedNode->employee.employeeId.str());
+
+    insertedNode->rowId = static_cast<uint32_t>(rows.size());
+    rows.push_back(insertedNode);
+    addToSecondaryIndexes(insertedNode);
+    return true;
+}
+
+/**
+ * Replace the details of an existing employee (the ID itself cannot change)
+ *
+ * @param employee The updated employee record
+ * @return True if the employee existed and was updated
+ */
+bool BinarySearchTree::updateEmployee(const Employee& employee) {
+    Node* node = locateNode(employee.employeeId.str());
+    if (node == nullptr) {
+        return false;
+    }
+
+    removeFromSecondaryIndexes(node);
+    deadTextBytes += node->employee.employeeId.size() + node->employee.fullName.size();
+    node->employee = employee;
+    node->employee.moveToStore(store);
+    addToSecondaryIndexes(node);
+    cache.invalidate(employee.employeeId.str());
+    return true;
+}
+
+/**
+ * Remove an employee from the tree
+ *
+ * @param employeeId The ID of the employee to remove
+ * @return True if the employee existed and was removed
+ */
+bool BinarySearchTree::removeEmployee(const string& employeeId) {
+    Node* removedNode = nullptr;
+    root = removeNodeAVL(root, employeeId, removedNode);
+    if (removedNode == nullptr) {
+        return false;
+    }
+
+    // The ID stays in the Bloom filter until the next rebuild, costing only a wasted lookup
+    if (backend == IndexBackend::RADIX) {
+        radixIndex.remove(employeeId);
+    }
+    cache.invalidate(employeeId);
+    employeeCount--;
+    deadTextBytes += removedNode->employee.employeeId.size() + removedNode->employee.fullName.size();
+
+    removeFromSecondaryIndexes(removedNode);
+    rows[removedNode->rowId] = nullptr;
+    delete removedNode;
+    return true;
+}
+
+/**
+ * Add a node's row to the field indexes and the org totals
+ *
+ * @param node The node whose employee should be indexed
+ */
+void BinarySearchTree::addToSecondaryIndexes(Node* node) {
+    indexFields(node);
+    attachToOrgTotals(node);
+    orgTourValid = false;
+}
+
+/**
+ * Add a node's row to the field, name and bitmap indexes
+ *
+ * @param node The node whose employee should be indexed
+ */
+void BinarySearchTree::indexFields(Node* node) {
+    const Employee& employee = node->employee;
+    if (employee.departmentId != 0) {
+        uint32_t department = store->departments.group(employee.departmentId);
+        departmentIndex.add(department, node->rowId);
+        departmentBitmaps.add(department, node->rowId);
+    }
+    if (employee.managerKey != 0) {
+        managerIndex.add(employee.managerKey, node->rowId);
+    }
+    if (employee.titleId != 0) {
+        titleBitmaps.add(store->titles.group(employee.titleId), node->rowId);
+    }
+    for (size_t i = 0; i < employee.skillCount(); ++i) {
+        uint32_t skill = store->skills.group(employee.skills[i]);
+        skillIndex.add(skill, node->rowId);
+        skillBitmaps.add(skill, node->rowId);
+    }
+    string fullName = employee.fullName.str();
+    nameIndex.add(node->rowId, fullName);
+    nameTrigrams.add(node->rowId, fullName);
+    liveRows.add(node->rowId);
+}
+
+/**
+ * Remove a node's row from the field indexes
+ *
+ * @param node The node whose employee is being removed or changed
+ */
+void BinarySearchTree::removeFromSecondaryIndexes(Node* node) {
+    detachFromOrgTotals(node);
+    const Employee& employee = node->employee;
+    uint32_t department = store->departments.group(employee.departmentId);
+    departmentIndex.remove(department, node->rowId);
+    departmentBitmaps.remove(department, node->rowId);
+    managerIndex.remove(employee.managerKey, node->rowId);
+    titleBitmaps.remove(store->titles.group(employee.titleId), node->rowId);
+    for (size_t i = 0; i < employee.skillCount(); ++i) {
+        uint32_t skill = store->skills.group(employee.skills[i]);
+        skillIndex.remove(skill, node->rowId);
+        skillBitmaps.remove(skill, node->rowId);
+    }
+    nameIndex.remove(node->rowId);
+    nameTrigrams.remove(node->rowId, employee.fullName.str());
+    liveRows.remove(node->rowId);
+    orgTourValid = false;
+}
+
+/**
+ * Print every employee in a department, reading only that department's rows
+ *
+ * @param department The department name (any case)
+ * @return True if the department has at least one employee
+ */
+bool BinarySearchTree::printDepartmentList(const string& department) {
+    uint32_t departmentId;
+    if (!store->departments.findGroup(department, departmentId) || departmentIndex.rows(departmentId).empty()) {
+        return false;
+    }
+
+    const vector<uint32_t>& departmentRows = departmentIndex.rows(departmentId);
+    for (size_t i = 0; i < departmentRows.size(); ++i) {
+        displayEmployee(rows[departmentRows[i]]->employee);
+        cout << endl;
+    }
+    return true;
+}
+
+/**
+ * Lay the reporting forest out in depth-first order so that each employee's
+ * whole org occupies orgTour[tourEntry[row] .. tourExit[row])
+ *
+ * The layout is rebuilt lazily by the first org query after a change.
+ */
+void BinarySearchTree::rebuildOrgTour() {
+    orgTour.clear();
+    orgTour.reserve(employeeCount);
+    tourEntry.assign(rows.size(), 0);
+    tourExit.assign(rows.size(), 0);
+    tourDepth.assign(rows.size(), 0);
+    tourParent.assign(rows.size(), NO_MANAGER);
+    vector<bool> visited(rows.size(), false);
+    vector<uint32_t> managerRows;
+    vector<uint32_t> reportKeys;
+    resolveManagerRows(managerRows, reportKeys);
+
+    // Start from everyone without a (known) manager: executives and dangling references
+    for (uint32_t row = 0; row < rows.size(); ++row) {
+        if (rows[row] != nullptr && (managerRows[row] == NO_MANAGER || managerRows[row] == row)) {
+            appendOrgSubtree(row, reportKeys, visited);
+        }
+    }
+
+    // Anyone left over sits on a reporting cycle; give each cycle an arbitrary root
+    for (uint32_t row = 0; row < rows.size(); ++row) {
+        if (rows[row] != nullptr && !visited[row]) {
+            appendOrgSubtree(row, reportKeys, visited);
+        }
+    }
+
+    buildBlockMinima();
+    orgTourValid = true;
+}
+
+/**
+ * Build the sparse table used to find the shallowest employee in any range
+ * of the tour
+ *
+ * Level 0 holds the shallowest position of each TOUR_BLOCK-position block,
+ * and level k the shallowest of 2^k consecutive blocks. Working on blocks
+ * keeps the table to a few megabytes at a million employees; queries scan at
+ * most two partial blocks on top of two table reads.
+ */
+void BinarySearchTree::buildBlockMinima() {
+    depthAtPosition.resize(orgTour.size());
+    for (size_t position = 0; position < orgTour.size(); ++position) {
+        depthAtPosition[position] = tourDepth[orgTour[position]];
+    }
+
+    size_t blockCount = (orgTour.size() + TOUR_BLOCK - 1) / TOUR_BLOCK;
+    blockMinima.assign(1, vector<uint32_t>(blockCount));
+    for (size_t block = 0; block < blockCount; ++block) {
+        uint32_t best = static_cast<uint32_t>(block * TOUR_BLOCK);
+        uint32_t end = static_cast<uint32_t>(min(orgTour.size(), (block + 1) * TOUR_BLOCK));
+        for (uint32_t position = best + 1; position < end; ++position) {
+            if (depthAtPosition[position] < depthAtPosition[best]) {
+                best = position;
+            }
+        }
+        blockMinima[0][block] = best;
+    }
+
+    for (size_t span = 2; span <= blockCount; span *= 2) {
+        const vector<uint32_t>& previous = blockMinima.back();
+        vector<uint32_t> level(blockCount - span + 1);
+        for (size_t block = 0; block < level.size(); ++block) {
+            uint32_t left = previous[block];
+            uint32_t right = previous[block + span / 2];
+            level[block] = depthAtPosition[right] < depthAtPosition[left] ? right : left;
+        }
+        blockMinima.push_back(level);
+    }
+}
+
+/**
+ * Find the shallowest employee in a range of tour positions
+ *
+ * @param first First position of the range
+ * @param last Last position of the range (inclusive, not before first)
+ * @return Tour position of a shallowest employee in the range
+ */
+uint32_t BinarySearchTree::shallowestPosition(uint32_t first, uint32_t last) const {
+    uint32_t firstBlock = first / TOUR_BLOCK;
+    uint32_t lastBlock = last / TOUR_BLOCK;
+    uint32_t best = first;
+
+    // Scan the ends directly; whole blocks in between come from the table
+    uint32_t scanEnd = firstBlock == lastBlock ? last : (firstBlock + 1) * TOUR_BLOCK - 1;
+    for (uint32_t position = first + 1; position <= scanEnd; ++position) {
+        if (depthAtPosition[position] < depthAtPosition[best]) {
+            best = position;
+        }
+    }
+    if (firstBlock == lastBlock) {
+        return best;
+    }
+    for (uint32_t position = lastBlock * TOUR_BLOCK; position <= last; ++position) {
+        if (depthAtPosition[position] < depthAtPosition[best]) {
+            best = position;
+        }
+    }
+
+    if (firstBlock + 1 < lastBlock) {
+        uint32_t blocks = lastBlock - firstBlock - 1;
+        uint32_t level = 0;
+        while ((2u << level) <= blocks) {
+            level++;
+        }
+        uint32_t left = blockMinima[level][firstBlock + 1];
+        uint32_t right = blockMinima[level][lastBlock - (1u << level)];
+        if (depthAtPosition[left] < depthAtPosition[best]) {
+            best = left;
+        }
+        if (depthAtPosition[right] < depthAtPosition[best]) {
+            best = right;
+        }
+    }
+    return best;
+}
+
+/**
+ * Lowest employee whose org contains both rows (each employee counts as part
+ * of their own org)
+ *
+ * @param a Row id of the first employee
+ * @param b Row id of the second employee
+ * @return Row id of the common manager, or NO_MANAGER if they share none
+ */
+uint32_t BinarySearchTree::lowestCommonManagerRow(uint32_t a, uint32_t b) {
+    if (!orgTourValid) {
+        rebuildOrgTour();
+    }
+
+    if (tourEntry[a] > tourEntry[b]) {
+        swap(a, b);
+    }
+    if (tourEntry[b] < tourExit[a]) {
+        return a;  // b is in a's org
+    }
+
+    // The shallowest employee strictly after a and up to b is a direct report
+    // of the common manager, or the top of b's separate reporting tree
+    uint32_t position = shallowestPosition(tourEntry[a] + 1, tourEntry[b]);
+    return tourParent[orgTour[position]];
+}
+
+/**
+ * Resolve every employee's manager to a row, and every manager to the key
+ * their reports are filed under in the manager index, with one lookup per
+ * distinct manager instead of one per employee
+ *
+ * @param managerRows Receives row -> row of the employee's manager, or NO_MANAGER if unknown
+ * @param reportKeys Receives row -> manager index key of the employee's reports, or NO_MANAGER
+ */
+void BinarySearchTree::resolveManagerRows(vector<uint32_t>& managerRows, vector<uint32_t>& reportKeys) {
+    managerRows.assign(rows.size(), NO_MANAGER);
+    reportKeys.assign(rows.size(), NO_MANAGER);
+    for (uint32_t key = 1; key < managerIndex.valueCount(); ++key) {
+        const vector<uint32_t>& reports = managerIndex.rows(key);
+        Node* manager = reports.empty() ? nullptr : locateNode(store->managers.value(key));
+        if (manager == nullptr) {
+            continue;
+        }
+        reportKeys[manager->rowId] = key;
+        for (size_t i = 0; i < reports.size(); ++i) {
+            managerRows[reports[i]] = manager->rowId;
+        }
+    }
+}
+
+/**
+ * Append an employee and everyone under them to the Euler tour
+ *
+ * Uses an explicit stack so very deep reporting chains cannot overflow the call stack.
+ *
+ * @param rootRow Row id of the employee at the top of the org
+ * @param reportKeys Row -> manager index key of the employee's reports, from resolveManagerRows
+ * @param visited Rows already placed in the tour
+ */
+void BinarySearchTree::appendOrgSubtree(uint32_t rootRow, const vector<uint32_t>& reportKeys, vector<bool>& visited) {
+    // Each frame is (row, index of the next direct report to visit)
+    vector<pair<uint32_t, size_t> > stack;
+    visited[rootRow] = true;
+    tourEntry[rootRow] = static_cast<uint32_t>(orgTour.size());
+    tourDepth[rootRow] = 0;
+    orgTour.push_back(rootRow);
+    stack.push_back(make_pair(rootRow, 0));
+
+    while (!stack.empty()) {
+        uint32_t row = stack.back().first;
+        const vector<uint32_t>* reports = reportKeys[row] == NO_MANAGER ? nullptr : &managerIndex.rows(reportKeys[row]);
+
+        size_t& next = stack.back().second;
+        if (reports == nullptr || next >= reports->size()) {
+            tourExit[row] = static_cast<uint32_t>(orgTour.size());
+            stack.pop_back();
+            continue;
+        }
+
+        uint32_t child = (*reports)[next++];
+        if (!visited[child]) {
+            visited[child] = true;
+            tourEntry[child] = static_cast<uint32_t>(orgTour.size());
+            tourDepth[child] = tourDepth[row] + 1;
+            tourParent[child] = row;
+            orgTour.push_back(child);
+            stack.push_back(make_pair(child, 0));
+        }
+    }
+}
+
+/**
+ * Print a one-line summary of an employee for org listings
+ *
+ * @param employee The employee to print
+ * @param indent Number of levels to indent by
+ */
+void BinarySearchTree::printOrgLine(const Employee& employee, size_t indent) {
+    cout << string(indent * 2, ' ') << employee.employeeId << " - " << employee.fullName;
+    if (!employee.title().empty()) {
+        cout << ", " << employee.title();
+    }
+    cout << endl;
+}
+
+/**
+ * Print the employees who report directly to a manager
+ *
+ * @param managerId The manager's employee ID
+ * @return Number of direct reports printed
+ */
+size_t BinarySearchTree::printDirectReports(const string& managerId) {
+    uint32_t managerKey;
+    if (!store->managers.find(managerId, managerKey)) {
+        return 0;
+    }
+
+    const vector<uint32_t>& reports = managerIndex.rows(managerKey);
+    for (size_t i = 0; i < reports.size(); ++i) {
+        printOrgLine(rows[reports[i]]->employee, 0);
+    }
+    return reports.size();
+}
+
+/**
+ * Check whether an employee is anywhere in a manager's org, in O(1) once the
+ * Euler tour is built
+ *
+ * @param employeeId The employee to check
+ * @param managerId The manager whose org is searched
+ * @return True if the manager is above the employee in the reporting chain
+ */
+bool BinarySearchTree::isInOrganization(const string& employeeId, const string& managerId) {
+    Node* employee = locateNode(employeeId);
+    Node* manager = locateNode(managerId);
+    if (employee == nullptr || manager == nullptr || employee == manager) {
+        return false;
+    }
+
+    if (!orgTourValid) {
+        rebuildOrgTour();
+    }
+    uint32_t position = tourEntry[employee->rowId];
+    return tourEntry[manager->rowId] < position && position < tourExit[manager->rowId];
+}
+
+/**
+ * Find the lowest manager whose org contains two employees
+ *
+ * If one employee is in the other's org, that other employee is the answer.
+ * Reporting cycles are cut where the tour first enters them.
+ *
+ * @param firstId The first employee's ID
+ * @param secondId The second employee's ID
+ * @return The common manager, or an employee with an empty ID if there is none
+ */
+Employee BinarySearchTree::findLowestCommonManager(const string& firstId, const string& secondId) {
+    Node* first = locateNode(firstId);
+    Node* second = locateNode(secondId);
+    if (first == nullptr || second == nullptr) {
+        return Employee(store);
+    }
+
+    uint32_t row = lowestCommonManagerRow(first->rowId, second->rowId);
+    return row == NO_MANAGER ? Employee(store) : rows[row]->employee;
+}
+
+/**
+ * Hook an employee into the org totals: adopt the reports already waiting
+ * for them, then add their whole org to every manager above
+ *
+ * A link that would close a reporting cycle is left out, so the totals
+ * always describe a forest.
+ *
+ * @param node The employee, already in the manager index
+ */
+void BinarySearchTree::attachToOrgTotals(Node* node) {
+    uint32_t row = node->rowId;
+    if (orgParent.size() < rows.size()) {
+        orgParent.resize(rows.size(), NO_MANAGER);
+        orgHeadcount.resize(rows.size(), 0);
+        orgDepartmentMix.resize(rows.size());
+    }
+    orgHeadcount[row] = 0;
+    orgDepartmentMix[row].clear();
+
+    // Reports added before their manager were counted as tops of their own orgs until now
+    uint32_t managerKey;
+    if (store->managers.find(node->employee.employeeId.str(), managerKey)) {
+        const vector<uint32_t>& reports = managerIndex.rows(managerKey);
+        for (size_t i = 0; i < reports.size(); ++i) {
+            if (reports[i] != row && orgParent[reports[i]] == NO_MANAGER) {
+                orgParent[reports[i]] = row;
+                propagateOrgTotals(reports[i], 1);
+            }
+        }
+    }
+
+    // While rows are being renumbered a manager not reached yet still has a stale row id;
+    // they adopt this employee when their own turn comes
+    Node* manager = node->employee.managerId().empty() ? nullptr : locateNode(node->employee.managerId());
+    if (manager == nullptr || manager == node || manager->rowId >= rows.size() || rows[manager->rowId] != manager) {
+        return;
+    }
+    for (uint32_t above = manager->rowId; above != NO_MANAGER; above = orgParent[above]) {
+        if (above == row) {
+            return;  // The manager is in this employee's org
+        }
+    }
+    orgParent[row] = manager->rowId;
+    propagateOrgTotals(row, 1);
+}
+
+/**
+ * Take an employee out of the org totals: subtract their whole org from
+ * every manager above and let their reports stand alone
+ *
+ * @param node The employee, with the fields they were indexed under
+ */
+void BinarySearchTree::detachFromOrgTotals(Node* node) {
+    uint32_t row = node->rowId;
+    if (row >= orgParent.size()) {
+        return;
+    }
+    propagateOrgTotals(row, -1);
+    orgParent[row] = NO_MANAGER;
+
+    uint32_t managerKey;
+    if (store->managers.find(node->employee.employeeId.str(), managerKey)) {
+        const vector<uint32_t>& reports = managerIndex.rows(managerKey);
+        for (size_t i = 0; i < reports.size(); ++i) {
+            if (orgParent[reports[i]] == row) {
+                orgParent[reports[i]] = NO_MANAGER;
+            }
+        }
+    }
+    orgHeadcount[row] = 0;
+    orgDepartmentMix[row].clear();
+}
+
+/**
+ * Add or subtract an employee and their org from the totals of every
+ * manager above them
+ *
+ * @param row The employee whose org moves
+ * @param sign 1 to add, -1 to subtract
+ */
+void BinarySearchTree::propagateOrgTotals(uint32_t row, int sign) {
+    vector<pair<uint32_t, uint32_t> > mix = ownAndOrgMix(row);
+    uint32_t headcount = orgHeadcount[row] + 1;
+
+    for (uint32_t above = orgParent[row]; above != NO_MANAGER; above = orgParent[above]) {
+        orgHeadcount[above] += sign > 0 ? headcount : -headcount;
+        mergeDepartmentMix(orgDepartmentMix[above], mix, sign);
+    }
+}
+
+/**
+ * Department mix of an employee's org with the employee's own department
+ * counted in, as it adds to the managers above them
+ *
+ * @param row The employee
+ * @return (department group id, count) pairs, by id
+ */
+vector<pair<uint32_t, uint32_t> > BinarySearchTree::ownAndOrgMix(uint32_t row) const {
+    vector<pair<uint32_t, uint32_t> > mix = orgDepartmentMix[row];
+    uint32_t departmentId = store->departments.group(rows[row]->employee.departmentId);
+    if (departmentId != 0) {
+        vector<pair<uint32_t, uint32_t> >::iterator entry =
+            lower_bound(mix.begin(), mix.end(), make_pair(departmentId, 0u));
+        if (entry != mix.end() && entry->first == departmentId) {
+            entry->second++;
+        }
+        else {
+            mix.insert(entry, make_pair(departmentId, 1u));
+        }
+    }
+    return mix;
+}
+
+/**
+ * Add or subtract one department mix from another, dropping departments
+ * that fall to zero
+ *
+ * @param totals The mix to change, sorted by department id
+ * @param mix The mix to add or subtract, sorted by department id
+ * @param sign 1 to add, -1 to subtract
+ */
+void BinarySearchTree::mergeDepartmentMix(vector<pair<uint32_t, uint32_t> >& totals,
+                                          const vector<pair<uint32_t, uint32_t> >& mix, int sign) {
+    vector<pair<uint32_t, uint32_t> > merged;
+    merged.reserve(totals.size() + mix.size());
+    size_t i = 0;
+    size_t j = 0;
+    while (i < totals.size() || j < mix.size()) {
+        if (j == mix.size() || (i < totals.size() && totals[i].first < mix[j].first)) {
+            merged.push_back(totals[i++]);
+        }
+        else if (i == totals.size() || mix[j].first < totals[i].first) {
+            merged.push_back(mix[j++]);
+        }
+        else {
+            uint32_t count = sign > 0 ? totals[i].second + mix[j].second : totals[i].second - mix[j].second;
+            if (count > 0) {
+                merged.push_back(make_pair(totals[i].first, count));
+            }
+            i++;
+            j++;
+        }
+    }
+    totals.swap(merged);
+}
+
+/**
+ * Compute the org totals of every manager in one pass after a load
+ *
+ * Employees are linked to their managers in row order with the same rule
+ * as attachToOrgTotals, so the same links are left out of reporting
+ * cycles, but each org is then added to its manager once, from the deepest
+ * employees up, instead of to every manager above on each insert.
+ */
+void BinarySearchTree::rebuildOrgTotals() {
+    vector<uint32_t> managerRows;
+    vector<uint32_t> reportKeys;
+    resolveManagerRows(managerRows, reportKeys);
+    orgParent.assign(rows.size(), NO_MANAGER);
+    orgHeadcount.assign(rows.size(), 0);
+    orgDepartmentMix.assign(rows.size(), vector<pair<uint32_t, uint32_t> >());
+
+    for (uint32_t row = 0; row < rows.size(); ++row) {
+        if (rows[row] == nullptr) {
+            continue;
+        }
+
+        // Reports with an earlier row were tops of their own orgs until now
+        if (reportKeys[row] != NO_MANAGER) {
+            const vector<uint32_t>& reports = managerIndex.rows(reportKeys[row]);
+            for (size_t i = 0; i < reports.size() && reports[i] < row; ++i) {
+                orgParent[reports[i]] = row;
+            }
+        }
+
+        // A manager with a later row adopts this employee on their own turn
+        uint32_t manager = managerRows[row];
+        if (manager == NO_MANAGER || manager >= row) {
+            continue;
+        }
+        uint32_t above = manager;
+        while (above != NO_MANAGER && above != row) {
+            above = orgParent[above];
+        }
+        if (above == NO_MANAGER) {
+            orgParent[row] = manager;
+        }
+    }
+
+    // Order employees deepest first, so every org is complete before it is added to its manager
+    vector<uint32_t> depth(rows.size(), NO_MANAGER);
+    vector<uint32_t> path;
+    uint32_t maxDepth = 0;
+    for (uint32_t row = 0; row < rows.size(); ++row) {
+        uint32_t top = row;
+        while (top != NO_MANAGER && depth[top] == NO_MANAGER) {
+            path.push_back(top);
+            top = orgParent[top];
+        }
+        uint32_t level = top == NO_MANAGER ? 0 : depth[top] + 1;
+        while (!path.empty()) {
+            depth[path.back()] = level++;
+            path.pop_back();
+        }
+        maxDepth = max(maxDepth, depth[row]);
+    }
+    vector<uint32_t> start(maxDepth + 2, 0);
+    for (uint32_t row = 0; row < rows.size(); ++row) {
+        start[maxDepth - depth[row] + 1]++;
+    }
+    for (size_t level = 1; level < start.size(); ++level) {
+        start[level] += start[level - 1];
+    }
+    vector<uint32_t> deepestFirst(rows.size());
+    for (uint32_t row = 0; row < rows.size(); ++row) {
+        deepestFirst[start[maxDepth - depth[row]]++] = row;
+    }
+
+    for (size_t i = 0; i < deepestFirst.size(); ++i) {
+        uint32_t row = deepestFirst[i];
+        uint32_t manager = orgParent[row];
+        if (rows[row] == nullptr || manager == NO_MANAGER) {
+            continue;
+        }
+        orgHeadcount[manager] += orgHeadcount[row] + 1;
+        mergeDepartmentMix(orgDepartmentMix[manager], ownAndOrgMix(row), 1);
+    }
+}
+
+/**
+ * Check every manager reference and look for reporting cycles. IDs the
+ * last load left out as repeats are reported as duplicates.
+ *
+ * @param threadCount Number of threads to use
+ * @return The problems found
+ */
+ValidationIssues BinarySearchTree::validateReportingStructure(unsigned threadCount) const {
+    vector<StringView> ids;
+    vector<StringView> managerIds;
+    ids.reserve(employeeCount);
+    managerIds.reserve(employeeCount);
+    for (size_t row = 0; row < rows.size(); ++row) {
+        if (rows[row] != nullptr) {
+            ids.push_back(rows[row]->employee.employeeId);
+            managerIds.push_back(StringView(rows[row]->employee.managerId()));
+        }
+    }
+    ValidationIssues issues = ReportingGraphValidator(ids, managerIds, threadCount).run();
+    issues.duplicateIds.insert(issues.duplicateIds.end(), skippedDuplicates.begin(), skippedDuplicates.end());
+    sort(issues.duplicateIds.begin(), issues.duplicateIds.end());
+    return issues;
+}
+
+/**
+ * Number of employees anywhere under a manager, read from the running totals
+ *
+ * @param managerId The manager's employee ID
+ * @return Headcount of the manager's org (excluding the manager)
+ */
+size_t BinarySearchTree::getOrgHeadcount(const string& managerId) {
+    Node* manager = locateNode(managerId);
+    return manager == nullptr ? 0 : orgHeadcount[manager->rowId];
+}
+
+/**
+ * Department mix of everyone under a manager, read from the running totals
+ *
+ * @param managerId The manager's employee ID
+ * @return (department, headcount) pairs, largest first
+ */
+vector<pair<string, size_t> > BinarySearchTree::getOrgDepartmentMix(const string& managerId) {
+    vector<pair<string, size_t> > mix;
+    Node* manager = locateNode(managerId);
+    if (manager == nullptr) {
+        return mix;
+    }
+
+    const vector<pair<uint32_t, uint32_t> >& totals = orgDepartmentMix[manager->rowId];
+    for (size_t i = 0; i < totals.size(); ++i) {
+        mix.push_back(make_pair(store->departments.value(totals[i].first), totals[i].second));
+    }
+    stable_sort(mix.begin(), mix.end(), [](const pair<string, size_t>& a, const pair<string, size_t>& b) {
+        return a.second > b.second;
+    });
+    return mix;
+}
+
+/**
+ * Print everyone under a manager, directly or transitively, as one
+ * contiguous scan of the Euler tour
+ *
+ * @param managerId The manager's employee ID
+ * @return Number of employees printed (excluding the manager)
+ */
+size_t BinarySearchTree::printOrgSubtree(const string& managerId) {
+    Node* manager = locateNode(managerId);
+    if (manager == nullptr) {
+        return 0;
+    }
+
+    if (!orgTourValid) {
+        rebuildOrgTour();
+    }
+
+    uint32_t row = manager->rowId;
+    uint32_t baseDepth = tourDepth[row];
+    for (uint32_t position = tourEntry[row] + 1; position < tourExit[row]; ++position) {
+        uint32_t member = orgTour[position];
+        printOrgLine(rows[member]->employee, tourDepth[member] - baseDepth - 1);
+    }
+    return tourExit[row] - tourEntry[row] - 1;
+}
+
+/**
+ * Print every employee matching a skill query
+ *
+ * @param query The parsed skill query
+ * @return Number of matching employees
+ */
+size_t BinarySearchTree::printSkillMatches(const SkillQuery& query) {
+    vector<uint32_t> universe;
+    bool needsUniverse = false;
+    for (size_t c = 0; c < query.clauses.size(); ++c) {
+        bool positive = false;
+        for (size_t t = 0; t < query.clauses[c].size(); ++t) {
+            positive = positive || !query.clauses[c][t].negated;
+        }
+        needsUniverse = needsUniverse || !positive;
+    }
+    if (needsUniverse) {
+        universe.reserve(employeeCount);
+        for (uint32_t row = 0; row < rows.size(); ++row) {
+            if (rows[row] != nullptr) {
+                universe.push_back(row);
+            }
+        }
+    }
+
+    vector<uint32_t> matches = evaluateSkillQuery(query, skillIndex, store->skills, universe);
+    for (size_t i = 0; i < matches.size(); ++i) {
+        printOrgLine(rows[matches[i]]->employee, 0);
+    }
+    return matches.size();
+}
+
+/**
+ * Find employees with a name word starting with a prefix
+ *
+ * @param prefix The typed prefix (any case)
+ * @param limit Maximum number of employees to return
+ * @return Matching employees in alphabetical order of the matched word
+ */
+vector<Employee> BinarySearchTree::findEmployeesByNamePrefix(const string& prefix, size_t limit) {
+    vector<uint32_t> matches = nameIndex.findPrefix(prefix, limit);
+    vector<Employee> employees;
+    employees.reserve(matches.size());
+    for (size_t i = 0; i < matches.size(); ++i) {
+        employees.push_back(rows[matches[i]]->employee);
+    }
+    return employees;
+}
+
+/**
+ * Find the employees whose name is closest to a possibly misspelled query
+ *
+ * A single-word query is compared with each word of the name as well as the
+ * whole name, so "Davs" finds "Catherine Davis".
+ *
+ * @param query The name as typed
+ * @param maxDistance Largest edit distance to accept
+ * @param limit Maximum number of matches to return
+ * @return (distance, employee) pairs, closest first, ties by name
+ */
+vector<pair<unsigned, Employee> > BinarySearchTree::findEmployeesByFuzzyName(const string& query, unsigned maxDistance, size_t limit) {
+    vector<pair<unsigned, Employee> > results;
+    string trimmed = query;
+    size_t start = trimmed.find_first_not_of(" \t");
+    if (start == string::npos) {
+        return results;
+    }
+    trimmed = trimmed.substr(start, trimmed.find_last_not_of(" \t") - start + 1);
+
+    // A query too short for the trigram filter is compared with every name
+    vector<uint32_t> candidates;
+    nameTrigrams.candidates(trimmed, maxDistance, candidates);
+
+    EditDistanceMatcher matcher(trimmed);
+    bool singleWord = trimmed.find(' ') == string::npos;
+    vector<pair<unsigned, uint32_t> > scored;
+
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        size_t length;
+        const char* name = nameTrigrams.nameData(candidates[i], length);
+
+        // Each edit changes the length by at most one
+        if (!singleWord && (length > trimmed.size() + maxDistance || length + maxDistance < trimmed.size())) {
+            continue;
+        }
+        unsigned best = matcher.distance(name, length);
+
+        if (singleWord) {
+            size_t wordStart = 0;
+            while (wordStart < length) {
+                size_t wordEnd = wordStart;
+                while (wordEnd < length && name[wordEnd] != ' ') {
+                    wordEnd++;
+                }
+                if (wordEnd > wordStart) {
+                    best = min(best, matcher.distance(name + wordStart, wordEnd - wordStart));
+                }
+                wordStart = wordEnd + 1;
+            }
+        }
+
+        if (best <= maxDistance) {
+            scored.push_back(make_pair(best, candidates[i]));
+        }
+    }
+
+    sort(scored.begin(), scored.end(), [this](const pair<unsigned, uint32_t>& a, const pair<unsigned, uint32_t>& b) {
+        if (a.first != b.first) {
+            return a.first < b.first;
+        }
+        return nameTrigrams.name(a.second) < nameTrigrams.name(b.second);
+    });
+
+    for (size_t i = 0; i < scored.size() && results.size() < limit; ++i) {
+        const vector<uint32_t>& matchRows = nameTrigrams.rows(scored[i].second);
+        for (size_t j = 0; j < matchRows.size() && results.size() < limit; ++j) {
+            results.push_back(make_pair(scored[i].first, rows[matchRows[j]]->employee));
+        }
+    }
+    return results;
+}
+
+/**
+ * Rows matching one filter term, ignoring its negation
+ *
+ * @param term The filter term
+ * @param scratch Holds the result when it has to be built (contains terms)
+ * @return The index's own bitmap for '=' terms, otherwise scratch
+ */
+const RowBitmap* BinarySearchTree::filterTermRows(const FilterTerm& term, RowBitmap& scratch) const {
+    static const RowBitmap none;
+    const BitmapIndex& index = term.field == FilterField::DEPARTMENT ? departmentBitmaps
+                             : term.field == FilterField::TITLE ? titleBitmaps : skillBitmaps;
+    const StringDictionary& values = term.field == FilterField::DEPARTMENT ? store->departments
+                                   : term.field == FilterField::TITLE ? store->titles : store->skills;
+
+    if (!term.contains) {
+        uint32_t valueId;
+        return values.findGroup(term.value, valueId) ? &index.rows(valueId) : &none;
+    }
+
+    // Only the distinct values are searched for the text, never the records
+    string needle = foldCase(term.value);
+    scratch.clear();
+    for (uint32_t valueId = 0; valueId < index.valueCount(); ++valueId) {
+        if (values.group(valueId) == valueId && foldCase(values.value(valueId)).find(needle) != string::npos) {
+            scratch = RowBitmap::combine(scratch, index.rows(valueId), RowBitmap::OR);
+        }
+    }
+    return &scratch;
+}
+
+/**
+ * Resolve the terms of one filter clause to bitmaps
+ *
+ * @param clause The clause's terms
+ * @param scratch Storage for bitmaps built for the clause, one per term
+ * @param include Receives the positive terms' bitmaps, smallest first
+ * @param exclude Receives the negated terms' bitmaps
+ */
+void BinarySearchTree::collectClauseRows(const vector<FilterTerm>& clause, vector<RowBitmap>& scratch,
+                                         vector<const RowBitmap*>& include, vector<const RowBitmap*>& exclude) const {
+    scratch.assign(clause.size(), RowBitmap());
+    include.clear();
+    exclude.clear();
+
+    vector<pair<uint64_t, const RowBitmap*> > positive;
+    for (size_t t = 0; t < clause.size(); ++t) {
+        const RowBitmap* matches = filterTermRows(clause[t], scratch[t]);
+        if (clause[t].negated) {
+            exclude.push_back(matches);
+        }
+        else {
+            positive.push_back(make_pair(matches->cardinality(), matches));
+        }
+    }
+
+    // Intersecting smallest first keeps every intermediate result small
+    sort(positive.begin(), positive.end());
+    for (size_t i = 0; i < positive.size(); ++i) {
+        include.push_back(positive[i].second);
+    }
+}
+
+/**
+ * Evaluate a record filter entirely on bitmaps
+ *
+ * @param filter The parsed filter
+ * @return Rows matching the filter
+ */
+RowBitmap BinarySearchTree::evaluateFilter(const RecordFilter& filter) const {
+    RowBitmap result;
+    vector<RowBitmap> scratch;
+    vector<const RowBitmap*> include;
+    vector<const RowBitmap*> exclude;
+
+    for (size_t c = 0; c < filter.clauses.size(); ++c) {
+        collectClauseRows(filter.clauses[c], scratch, include, exclude);
+
+        RowBitmap clauseRows = include.empty() ? liveRows : *include[0];
+        for (size_t i = 1; i < include.size() && !clauseRows.empty(); ++i) {
+            clauseRows = RowBitmap::combine(clauseRows, *include[i], RowBitmap::AND);
+        }
+        for (size_t i = 0; i < exclude.size() && !clauseRows.empty(); ++i) {
+            clauseRows = RowBitmap::combine(clauseRows, *exclude[i], RowBitmap::ANDNOT);
+        }
+        result = c == 0 ? clauseRows : RowBitmap::combine(result, clauseRows, RowBitmap::OR);
+    }
+    return result;
+}
+
+/**
+ * Count the employees matching a record filter without reading any records
+ *
+ * @param filter The parsed filter
+ * @return Number of matching employees
+ */
+uint64_t BinarySearchTree::countFilterMatches(const RecordFilter& filter) const {
+    // A plain AND of terms only needs the size of its last intersection
+    if (filter.clauses.size() == 1) {
+        vector<RowBitmap> scratch;
+        vector<const RowBitmap*> include;
+        vector<const RowBitmap*> exclude;
+        collectClauseRows(filter.clauses[0], scratch, include, exclude);
+
+        if (exclude.empty() && include.size() == 2) {
+            return RowBitmap::intersectCount(*include[0], *include[1]);
+        }
+        if (exclude.empty() && include.size() > 2) {
+            RowBitmap partial = RowBitmap::combine(*include[0], *include[1], RowBitmap::AND);
+            for (size_t i = 2; i + 1 < include.size(); ++i) {
+                partial = RowBitmap::combine(partial, *include[i], RowBitmap::AND);
+            }
+            return RowBitmap::intersectCount(partial, *include.back());
+        }
+    }
+    return evaluateFilter(filter).cardinality();
+}
+
+/**
+ * Print every employee matching a record filter
+ *
+ * @param filter The parsed filter
+ * @return Number of matching employees
+ */
+size_t BinarySearchTree::printFilterMatches(const RecordFilter& filter) {
+    vector<uint32_t> matches;
+    evaluateFilter(filter).toRows(matches);
+    for (size_t i = 0; i < matches.size(); ++i) {
+        printOrgLine(rows[matches[i]]->employee, 0);
+    }
+    return matches.size();
+}
+
+/**
+ * Count employees per department from the posting list sizes
+ *
+ * @return (department, headcount) pairs in alphabetical order, empty departments omitted
+ */
+vector<pair<string, size_t> > BinarySearchTree::getDepartmentHeadcounts() const {
+    vector<pair<string, size_t> > headcounts;
+    for (uint32_t id = 0; id < departmentIndex.valueCount(); ++id) {
+        if (!departmentIndex.rows(id).empty()) {
+            headcounts.push_back(make_pair(store->departments.value(id), departmentIndex.rows(id).size()));
+        }
+    }
+    sort(headcounts.begin(), headcounts.end());
+    return headcounts;
+}
+
+/**
+ * Searches the tree for a specific employee by their ID
+ */
+Employee BinarySearchTree::findEmployeeById(const string& employeeId) {
+    // Hot records are resolved without touching the filter or the tree
+    Node* node = cache.lookup(employeeId);
+    if (node != nullptr) {
+        return node->employee;
+    }
+
+    // Unknown IDs are usually rejected after reading a single filter block
+    if (!idFilter.mightContain(employeeId)) {
+        filterRejected++;
+        return Employee(store);
+    }
+
+    node = locateNode(employeeId);
+    if (node == nullptr) {
+        if (idFilter.isEnabled()) {
+            filterFalsePositives++;
+        }
+        return Employee(store);
+    }
+    cache.store(node);
+    return node->employee;
+}
+
+/**
+ * Find the node holding an employee using the selected index backend
+ *
+ * @param employeeId The ID of the employee to be found
+ * @return The node holding the employee, or nullptr if not found
+ */
+Node* BinarySearchTree::locateNode(const string& employeeId) {
+    if (backend == IndexBackend::RADIX) {
+        return radixIndex.find(employeeId);
+    }
+
+    // Begin the search from the root
+    return searchNode(root, employeeId);
+}
+
+/**
+ * Helper function to search for an employee by their ID
+ *
+ * @param node The node to start searching from
+ * @param employeeId The ID of the employee to be found
+ * @return The node holding the employee, or nullptr if not found
+ */
+Node* BinarySearchTree::searchNode(Node* node, const string& employeeId) {
+    // Start at the given subtree root
+    Node* cur = node;
+
+    // Keep looping downwards until we find the matching employeeId or reach the bottom of the tree
+    while (cur != nullptr) {
+        // Check if we found the employee
+        if (employeeId == cur->employee.employeeId) {
+            return cur;  // Return the node holding the employee
+        }
+        // If the employeeId is smaller than the current node's employeeId, move left
+        else if (employeeId < cur->employee.employeeId) {
+            cur = cur->left;
+        }
+        // If the employeeId is larger than the current node's employeeId, move right
+        else {
+            cur = cur->right;
+        }
+    }
+
+    // No employee with that ID
+    return nullptr;
+}
+
+/**
+ * Prints the list of employees in the tree in alphanumeric order
+ */
+void BinarySearchTree::printEmployeeList() {
+    if (backend == IndexBackend::RADIX) {
+        // The radix tree visits keys in the same byte order as the AVL in-order traversal
+        radixIndex.forEach([this](Node* node) {
+            displayEmployee(node->employee);
+            cout << endl;
+        });
+        return;
+    }
+
+    // In order traversal starting from the root
+    printEmployeeList(root);
+}
+
+/**
+ * Helper function that prints the employees in alphanumeric order using in-order traversal
+ *
+ * @param node The current node in the tree
+ */
+void BinarySearchTree::printEmployeeList(Node* node) {
+    if (node != nullptr) {
+        printEmployeeList(node->left);  // Traverse the left subtree
+        displayEmployee(node->employee);  // Output employee details
+        cout << endl; // Add a new line between employees
+        printEmployeeList(node->right);  // Traverse the right subtree
+    }
+}
+
+/**
+ * Destructor - prevents memory leaks by cleaning up all nodes
+ */
+BinarySearchTree::~BinarySearchTree() {
+    destroyTree(root);
+}
+
+/**
+ * Helper function to recursively delete all nodes in the tree
+ *
+ * @param node The current node to delete (and its subtrees)
+ */
+void BinarySearchTree::destroyTree(Node* node) {
+    if (node != nullptr) {
+        destroyTree(node->left);   // Delete left subtree
+        destroyTree(node->right);  // Delete right subtree
+        delete node;               // Delete current node
+    }
+}
+
+/**
+ * Copy constructor - creates a deep copy of another tree
+ *
+ * @param other The tree to copy from
+ */
+BinarySearchTree::BinarySearchTree(const BinarySearchTree& other)
+    : backend(other.backend), store(other.store), cache(other.cache.getCapacity()), idFilter(other.idFilter.getFalsePositiveRate()),
+      filterRejected(0), filterFalsePositives(0), employeeCount(other.employeeCount), deadTextBytes(other.deadTextBytes),
+      skippedDuplicates(other.skippedDuplicates), orgTourValid(false) {
+    root = copyTree(other.root);
+    rebuildIndexes();
+}
+
+/**
+ * Assignment operator - assigns one tree to another with deep copy
+ *
+ * @param other The tree to copy from
+ * @return Reference to this tree
+ */
+BinarySearchTree& BinarySearchTree::operator=(const BinarySearchTree& other) {
+    if (this != &other) {  // Avoid self-assignment
+        // Clean up existing tree
+        destroyTree(root);
+        // Copy the other tree
+        backend = other.backend;
+        store = other.store;
+        employeeCount = other.employeeCount;
+        deadTextBytes = other.deadTextBytes;
+        skippedDuplicates = other.skippedDuplicates;
+        root = copyTree(other.root);
+        rebuildIndexes();
+    }
+    return *this;
+}
+
+/**
+ * Remove every employee, keeping the index backend and cache settings.
+ * The tree starts a fresh store, so the old records' text is freed once
+ * no copy of the tree shares it.
+ */
+void BinarySearchTree::clear() {
+    destroyTree(root);
+    root = nullptr;
+    employeeCount = 0;
+    deadTextBytes = 0;
+    skippedDuplicates.clear();
+    store = make_shared<EmployeeStore>();
+    rebuildIndexes();
+}
+
+/**
+ * Replace every employee with a list already sorted by ID. The tree is
+ * built balanced in one pass and indexed once, instead of rebalancing
+ * and indexing on every insert.
+ *
+ * @param employees Employees in ascending ID order with no duplicate IDs;
+ *                  the list is emptied
+ */
+void BinarySearchTree::bulkLoad(vector<Employee>& employees) {
+    for (size_t i = 0; i < employees.size(); ++i) {
+        employees[i].moveToStore(store);
+    }
     destroyTree(root);
+    root = buildBalanced(employees, 0, employees.size());
+    employeeCount = employees.size();
+    deadTextBytes = 0;  // Callers start from a fresh store
+    skippedDuplicates.clear();
+    vector<Employee>().swap(employees);
+    rebuildIndexes();
+}
+
+/**
+ * Move every employee into a fresh store, freeing the text and values
+ * that only removed or replaced employees used. Value ids change, so the
+ * indexes are rebuilt. Records copied out of the tree keep the old store
+ * alive until the last of them is gone.
+ */
+void BinarySearchTree::compactStore() {
+    shared_ptr<EmployeeStore> compacted = make_shared<EmployeeStore>();
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (rows[i] != nullptr) {
+            rows[i]->employee.moveToStore(compacted);
+        }
+    }
+    store = compacted;
+    deadTextBytes = 0;
+    rebuildIndexes();
+}
+
+/**
+ * Get how much of the store's ID and name text no employee in the tree
+ * uses any more
+ *
+ * @return Bytes freed by the next compactStore()
+ */
+size_t BinarySearchTree::getDeadTextBytes() const {
+    return deadTextBytes;
+}
+
+/**
+ * Remember IDs a load left out because an earlier record had them, so
+ * validation can report them. They are forgotten when the data is replaced.
+ *
+ * @param employeeIds The repeated IDs, once per record left out
+ */
+void BinarySearchTree::setSkippedDuplicates(const vector<string>& employeeIds) {
+    skippedDuplicates = employeeIds;
+}
+
+/**
+ * Get the store that employees built for this tree should use
+ *
+ * @return The tree's text arena and intern tables, replaced by clear()
+ */
+const shared_ptr<EmployeeStore>& BinarySearchTree::employeeStore() const {
+    return store;
+}
+
+/**
+ * Rebuild the secondary indexes so they point at this tree's nodes
+ */
+void BinarySearchTree::rebuildIndexes() {
+    cache.clear();
+    radixIndex.clear();
+    if (backend == IndexBackend::RADIX) {
+        indexSubtree(root);
+    }
+    rebuildFilter(employeeCount);
+
+    // Renumber rows in ID order, which also drops the holes left by removals
+    rows.clear();
+    departmentIndex.clear();
+    managerIndex.clear();
+    skillIndex.clear();
+    nameIndex.clear();
+    nameTrigrams.clear();
+    departmentBitmaps.clear();
+    titleBitmaps.clear();
+    skillBitmaps.clear();
+    liveRows.clear();
+    assignRows(root);
+
+    // Reporting-chain queries are ready as soon as the data is loaded
+    rebuildOrgTotals();
+    rebuildOrgTour();
+}
+
+/**
+ * Helper function that numbers rows in-order and indexes their fields
+ *
+ * @param node The root of the subtree to number
+ */
+void BinarySearchTree::assignRows(Node* node) {
+    if (node != nullptr) {
+        assignRows(node->left);
+        node->rowId = static_cast<uint32_t>(rows.size());
+        rows.push_back(node);
+        indexFields(node);
+        assignRows(node->right);
+    }
+}
+
+/**
+ * Resize the ID filter and refill it from the tree, dropping removed IDs
+ *
+ * @param expectedKeys Number of keys to size the filter for
+ */
+void BinarySearchTree::rebuildFilter(size_t expectedKeys) {
+    idFilter.reset(expectedKeys);
+    if (idFilter.isEnabled()) {
+        filterSubtree(root);
+    }
+}
+
+/**
+ * Helper function that adds every ID of a subtree to the filter
+ *
+ * @param node The root of the subtree to add
+ */
+void BinarySearchTree::filterSubtree(Node* node) {
+    if (node != nullptr) {
+        filterSubtree(node->left);
+        idFilter.add(node->employee.employeeId.str());
+        filterSubtree(node->right);
+    }
+}
+
+/**
+ * Helper function that adds every node of a subtree to the radix index
+ *
+ * @param node The root of the subtree to index
+ */
+void BinarySearchTree::indexSubtree(Node* node) {
+    if (node != nullptr) {
+        indexSubtree(node->left);
+        radixIndex.insert(node->employee.employeeId.str(), node);
+        indexSubtree(node->right);
+    }
+}
+
+/**
+ * Helper function to recursively copy a tree
+ *
+ * @param node The root of the subtree to copy
+ * @return Pointer to the root of the new copied subtree
+ */
+Node* BinarySearchTree::copyTree(Node* node) {
+    if (node == nullptr) {
+        return nullptr;
+    }
+
+    // Create new node with same employee data
+    Node* newNode = new Node(node->employee);
+    newNode->height = node->height;  // Copy height for AVL
+    newNode->rowId = node->rowId;
+
+    // Recursively copy left and right subtrees
+    newNode->left = copyTree(node->left);
+    newNode->right = copyTree(node->right);
+
+    return newNode;
+}
+
+/**
+ * Helper function that builds a balanced subtree from sorted employees
+ *
+ * @param employees Employees in ascending ID order
+ * @param begin First employee of the subtree
+ * @param end One past the last employee of the subtree
+ * @return Pointer to the root of the new subtree
+ */
+Node* BinarySearchTree::buildBalanced(vector<Employee>& employees, size_t begin, size_t end) {
+    if (begin == end) {
+        return nullptr;
+    }
+
+    // The middle employee is the root, so the halves differ in size by at most one
+    size_t middle = begin + (end - begin) / 2;
+    Node* node = new Node(employees[middle]);
+    node->left = buildBalanced(employees, begin, middle);
+    node->right = buildBalanced(employees, middle + 1, end);
+    updateHeight(node);
+    return node;
+}
+
+/**
+ * Get height of a node (0 for null nodes)
+ *
+ * @param node The node to get height of
+ * @return Height of the node
+ */
+int BinarySearchTree::getHeight(Node* node) {
+    return node ? node->height : 0;
+}
+
+/**
+ * Get balance factor of a node (right height - left height)
+ *
+ * @param node The node to get balance factor of
+ * @return Balance factor (-1, 0, 1 for balanced; -2, +2 for unbalanced)
+ */
+int BinarySearchTree::getBalance(Node* node) {
+    return node ? getHeight(node->right) - getHeight(node->left) : 0;
+}
+
+/**
+ * Update height of a node based on its children's heights
+ *
+ * @param node The node to update height for
+ */
+void BinarySearchTree::updateHeight(Node* node) {
+    if (node) {
+        node->height = 1 + max(getHeight(node->left), getHeight(node->right));
+    }
+}
+
+/**
+ * Right rotation (for left-heavy trees)
+ *
+ *     y                    x
+ *    / \                  / \
+ *   x   T3      -->      T1  y
+ *  / \                      / \
+ * T1  T2                   T2  T3
+ *
+ * @param y The unbalanced node
+ * @return New root of the subtree
+ */
+Node* BinarySearchTree::rotateRight(Node* y) {
+    Node* x = y->left;
+    Node* T2 = x->right;
+
+    // Perform rotation
+    x->right = y;
+    y->left = T2;
+
+    // Update heights (order matters: y first, then x)
+    updateHeight(y);
+    updateHeight(x);
+
+    // Return new root
+    return x;
+}
+
+/**
+ * Left rotation (for right-heavy trees)
+ *
+ *   x                      y
+ *  / \                    / \
+ * T1  y        -->       x   T3
+ *    / \                / \
+ *   T2  T3             T1  T2
+ *
+ * @param x The unbalanced node
+ * @return New root of the subtree
+ */
+Node* BinarySearchTree::rotateLeft(Node* x) {
+    Node* y = x->right;
+    Node* T2 = y->left;
+
+    // Perform rotation
+    y->left = x;
+    x->right = T2;
+
+    // Update heights (order matters: x first, then y)
+    updateHeight(x);
+    updateHeight(y);
+
+    // Return new root
+    return y;
+}
+
+/**
+ * AVL insertion - maintains tree balance automatically
+ *
+ * @param node Current node (subtree root)
+ * @param employee Employee to insert
+ * @param insertedNode Set to the newly created node, left unchanged for duplicates
+ * @return New root of the subtree after insertion and balancing
+ */
+Node* BinarySearchTree::insertNodeAVL(Node* node, Employee employee, Node*& insertedNode) {
+    // 1. Normal BST insertion
+    if (node == nullptr) {
+        insertedNode = new Node(employee);
+        return insertedNode;
+    }
+
+    if (employee.employeeId < node->employee.employeeId) {
+        node->left = insertNodeAVL(node->left, employee, insertedNode);
+    }
+    else if (employee.employeeId > node->employee.employeeId) {
+        node->right = insertNodeAVL(node->right, employee, insertedNode);
+    }
+    else {
+        // Duplicate keys not allowed, return unchanged
+        return node;
+    }
+
+    // 2. Update height of current node
+    updateHeight(node);
+
+    // 3. Get balance factor
+    int balance = getBalance(node);
+
+    // 4. If unbalanced, there are 4 rotation cases:
+
+    // Left-Left Case (balance < -1 and new node went to left of left child)
+    if (balance < -1 && employee.employeeId < node->left->employee.employeeId) {
+        return rotateRight(node);
+    }
+
+    // Right-Right Case (balance > 1 and new node went to right of right child)
+    if (balance > 1 && employee.employeeId > node->right->employee.employeeId) {
+        return rotateLeft(node);
+    }
+
+    // Left-Right Case (balance < -1 and new node went to right of left child)
+    if (balance < -1 && employee.employeeId > node->left->employee.employeeId) {
+        node->left = rotateLeft(node->left);
+        return rotateRight(node);
+    }
+
+    // Right-Left Case (balance > 1 and new node went to left of right child)
+    if (balance > 1 && employee.employeeId < node->right->employee.employeeId) {
+        node->right = rotateRight(node->right);
+        return rotateLeft(node);
+    }
+
+    // Return unchanged node if balanced
+    return node;
+}
+
+/**
+ * Restore the AVL property at a node after one of its subtrees shrank
+ *
+ * @param node The subtree root to rebalance
+ * @return New root of the subtree
+ */
+Node* BinarySearchTree::rebalance(Node* node) {
+    updateHeight(node);
+    int balance = getBalance(node);
+
+    // Left heavy: Left-Left or Left-Right case
+    if (balance < -1) {
+        if (getBalance(node->left) > 0) {
+            node->left = rotateLeft(node->left);
+        }
+        return rotateRight(node);
+    }
+
+    // Right heavy: Right-Right or Right-Left case
+    if (balance > 1) {
+        if (getBalance(node->right) < 0) {
+            node->right = rotateRight(node->right);
+        }
+        return rotateLeft(node);
+    }
+
+    return node;
+}
+
+/**
+ * Unlink the smallest node of a subtree
+ *
+ * @param node Root of the subtree
+ * @param minNode Set to the unlinked node
+ * @return New root of the subtree
+ */
+Node* BinarySearchTree::detachMin(Node* node, Node*& minNode) {
+    if (node->left == nullptr) {
+        minNode = node;
+        return node->right;
+    }
+
+    node->left = detachMin(node->left, minNode);
+    return rebalance(node);
+}
+
+/**
+ * AVL deletion - unlinks the node and rebalances on the way back up
+ *
+ * Nodes are relinked rather than having their employee data swapped, so
+ * pointers held by the secondary indexes stay valid for every other employee.
+ *
+ * @param node Current node (subtree root)
+ * @param employeeId ID of the employee to remove
+ * @param removedNode Set to the unlinked node (caller deletes it), left unchanged if not found
+ * @return New root of the subtree after removal and balancing
+ */
+Node* BinarySearchTree::removeNodeAVL(Node* node, const string& employeeId, Node*& removedNode) {
+    if (node == nullptr) {
+        return nullptr;
+    }
+
+    if (employeeId < node->employee.employeeId) {
+        node->left = removeNodeAVL(node->left, employeeId, removedNode);
+    }
+    else if (employeeId > node->employee.employeeId) {
+        node->right = removeNodeAVL(node->right, employeeId, removedNode);
+    }
+    else {
+        removedNode = node;
+
+        // Zero or one child: the child takes this node's place
+        if (node->left == nullptr || node->right == nullptr) {
+            return node->left ? node->left : node->right;
+        }
+
+        // Two children: the in-order successor takes this node's place
+        Node* successor = nullptr;
+        Node* newRight = detachMin(node->right, successor);
+        successor->left = node->left;
+        successor->right = newRight;
+        node = successor;
+    }
+
+    return rebalance(node);
+}
+
+//============================================================================
+// Command line options
+//============================================================================
+
+// How the input file is read into the tree
+enum class LoadStrategy {
+    AUTO,      // STREAM on one core, CHUNKED on more
+    STREAM,    // One thread reads blocks and inserts each record as it is parsed
+    CHUNKED,   // Every core parses and sorts a chunk, then the tree is built in one pass
+    PIPELINE   // Parser threads hand batches through lock-free queues to one inserting thread
+};
+
+struct ProgramOptions {
+    IndexBackend backend;
+    LoadStrategy loadStrategy;
+    size_t cacheCapacity;    // Records kept by the lookup cache (0 disables it)
+    double filterRate;       // Target false-positive rate of the ID filter (0 disables it)
+    string benchmark;        // Benchmark to run instead of the menu (empty for none)
+    size_t benchmarkSize;    // Number of synthetic employees used by benchmarks
+    string benchmarkFile;    // CSV file read by the load benchmark (empty to generate one)
+    vector<string> lookupIds;  // IDs to look up in the snapshot instead of running the menu
+    bool changeLog;            // Log changes so they survive a restart
+    size_t checkpointRecords;  // Logged changes between automatic checkpoints (0 for only when saving)
+
+    ProgramOptions()
+        : backend(IndexBackend::AVL), loadStrategy(LoadStrategy::AUTO), cacheCapacity(EmployeeCache::DEFAULT_CAPACITY),
+          filterRate(BloomFilter::DEFAULT_FALSE_POSITIVE_RATE), benchmarkSize(200000), changeLog(true),
+          checkpointRecords(10000) {}
+};
+
+//============================================================================
+// Function declarations for main() helpers
+//============================================================================
+struct Persistence;
+
+void displayMenu();
+int getUserChoice();
+bool loadEmployeeData(BinarySearchTree& tree, const string& fileName, LoadStrategy strategy);
+void reloadEmployeeData(BinarySearchTree& tree, bool dataLoaded, const string& fileName, Persistence& persistence);
+void printEmployeeDirectory(BinarySearchTree& tree, bool dataLoaded);
+void searchForEmployee(BinarySearchTree& tree, bool dataLoaded);
+void printLookupStatistics(BinarySearchTree& tree, bool dataLoaded);
+void listDepartment(BinarySearchTree& tree, bool dataLoaded);
+void printDepartmentHeadcounts(BinarySearchTree& tree, bool dataLoaded);
+void listDirectReports(BinarySearchTree& tree, bool dataLoaded);
+void listOrganization(BinarySearchTree& tree, bool dataLoaded);
+void searchBySkills(BinarySearchTree& tree, bool dataLoaded);
+void searchByName(BinarySearchTree& tree, bool dataLoaded);
+void fuzzySearchByName(BinarySearchTree& tree, bool dataLoaded);
+void filterEmployees(BinarySearchTree& tree, bool dataLoaded);
+void checkReportingChain(BinarySearchTree& tree, bool dataLoaded);
+void printOrganizationSummary(BinarySearchTree& tree, bool dataLoaded);
+void validateOrganization(BinarySearchTree& tree, bool dataLoaded);
+bool saveEmployeeSnapshot(BinarySearchTree& tree, bool dataLoaded, const string& fileName, Persistence& persistence);
+bool loadEmployeeSnapshot(BinarySearchTree& tree, const string& fileName, uint64_t& generation);
+bool lookupEmployeesInSnapshot(const vector<string>& employeeIds, const string& fileName);
+bool startChangeLog(const string& fileName, Persistence& persistence);
+bool checkpointEmployeeData(BinarySearchTree& tree, const string& fileName, Persistence& persistence);
+void checkpointIfDue(BinarySearchTree& tree, const string& fileName, Persistence& persistence);
+bool commitLogRecord(Persistence& persistence, uint64_t sequence);
+bool restoreEmployeeData(BinarySearchTree& tree, const string& fileName, Persistence& persistence);
+bool recoverEmployeeData(BinarySearchTree& tree, const string& fileName, Persistence& persistence);
+void addEmployeeRecord(BinarySearchTree& tree, bool dataLoaded, const string& fileName, Persistence& persistence);
+void updateEmployeeRecord(BinarySearchTree& tree, bool dataLoaded, const string& fileName, Persistence& persistence);
+void removeEmployeeRecord(BinarySearchTree& tree, bool dataLoaded, const string& fileName, Persistence& persistence);
+size_t printValidationIssues(const ValidationIssues& issues, size_t limit);
+string readEmployeeId(const string& prompt);
+bool processMenuChoice(int choice, BinarySearchTree& tree, bool& dataLoaded, const string& fileName,
+                       LoadStrategy loadStrategy, Persistence& persistence);
+bool parseCommandLine(int argc, char* argv[], ProgramOptions& options);
+bool runBenchmark(const ProgramOptions& options);
+
+// New helper function declarations
+vector<string> parseCSVLine(const StringView& line);
+vector<StringView> parseSkills(const StringView& skillsString);
+bool validateEmployeeData(const EmployeeFields& fields);
+
+//============================================================================
+// CSV field separator scanning
+//============================================================================
+
+// Appends the offset of every comma outside quotes in a line
+typedef void (*SeparatorScanner)(const char* data, size_t size, vector<uint32_t>& separators);
+
+/**
+ * Turn quote positions into "inside quotes" positions: bit i of the result
+ * is the XOR of bits 0..i, so it is set from an opening quote up to (not
+ * including) its closing quote
+ *
+ * @param quotes Bit i set if byte i is a quote
+ * @return Prefix XOR of the bits
+ */
+inline uint64_t prefixXor(uint64_t quotes) {
+    quotes ^= quotes << 1;
+    quotes ^= quotes << 2;
+    quotes ^= quotes << 4;
+    quotes ^= quotes << 8;
+    quotes ^= quotes << 16;
+    quotes ^= quotes << 32;
+    return quotes;
+}
+
+/**
+ * Append the offsets of the commas outside quotes in one 64-byte chunk
+ *
+ * @param commas Bit i set if byte i of the chunk is a comma
+ * @param inside Bit i set if byte i of the chunk is inside quotes
+ * @param base Offset of the chunk in the line
+ * @param separators Receives the offsets
+ */
+inline void appendSeparators(uint64_t commas, uint64_t inside, uint32_t base, vector<uint32_t>& separators) {
+    uint64_t bits = commas & ~inside;
+    while (bits != 0) {
+        separators.push_back(base + countTrailingZeros64(bits));
+        bits &= bits - 1;
+    }
+}
+
+/**
+ * Find separators one byte at a time
+ *
+ * @param data Start of the line
+ * @param size Length of the line
+ * @param separators Receives the offset of every comma outside quotes
+ */
+void scanSeparatorsScalar(const char* data, size_t size, vector<uint32_t>& separators) {
+    bool inQuotes = false;
+    for (size_t i = 0; i < size; ++i) {
+        if (data[i] == '"') {
+            inQuotes = !inQuotes;
+        }
+        else if (data[i] == ',' && !inQuotes) {
+            separators.push_back(static_cast<uint32_t>(i));
+        }
+    }
+}
+
+#ifdef EMPLOYEE_HAVE_SSE2
+/**
+ * Find separators 64 bytes at a time with SSE2 compares: one bitmask of
+ * commas and one of quotes per chunk, quoted regions from the prefix XOR of
+ * the quote mask, carried from chunk to chunk
+ *
+ * @param data Start of the line
+ * @param size Length of the line
+ * @param separators Receives the offset of every comma outside quotes
+ */
+void scanSeparatorsSSE2(const char* data, size_t size, vector<uint32_t>& separators) {
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i quote = _mm_set1_epi8('"');
+    uint64_t carry = 0;  // All ones when the previous chunk ended inside quotes
+    char tail[64];
+    for (size_t offset = 0; offset < size; offset += 64) {
+        const char* chunk = data + offset;
+        if (size - offset < 64) {
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, chunk, size - offset);
+            chunk = tail;
+        }
+        uint64_t commas = 0;
+        uint64_t quotes = 0;
+        for (int part = 0; part < 4; ++part) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(chunk + 16 * part));
+            commas |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, comma))))
+                      << (16 * part);
+            quotes |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, quote))))
+                      << (16 * part);
+        }
+        uint64_t inside = quotes == 0 ? carry : prefixXor(quotes) ^ carry;
+        appendSeparators(commas, inside, static_cast<uint32_t>(offset), separators);
+        carry = static_cast<uint64_t>(static_cast<int64_t>(inside) >> 63);
+    }
+}
+#endif
+
+#ifdef EMPLOYEE_HAVE_AVX2_DISPATCH
+/**
+ * Find separators 64 bytes at a time with AVX2 compares, taking the prefix
+ * XOR of the quote mask as a carry-less multiply by all ones
+ *
+ * @param data Start of the line
+ * @param size Length of the line
+ * @param separators Receives the offset of every comma outside quotes
+ */
+EMPLOYEE_TARGET_AVX2 void scanSeparatorsAVX2(const char* data, size_t size, vector<uint32_t>& separators) {
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m128i allOnes = _mm_set1_epi8(static_cast<char>(0xFF));
+    uint64_t carry = 0;
+    char tail[64];
+    for (size_t offset = 0; offset < size; offset += 64) {
+        const char* chunk = data + offset;
+        if (size - offset < 64) {
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, chunk, size - offset);
+            chunk = tail;
+        }
+        __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(chunk));
+        __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(chunk + 32));
+        uint64_t commas = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, comma))) |
+                          static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, comma))))
+                              << 32;
+        uint64_t quotes = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, quote))) |
+                          static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, quote))))
+                              << 32;
+        uint64_t inside = carry;
+        if (quotes != 0) {
+            __m128i product = _mm_clmulepi64_si128(_mm_set_epi64x(0, static_cast<long long>(quotes)), allOnes, 0);
+            inside ^= static_cast<uint64_t>(_mm_cvtsi128_si64(product));
+        }
+        appendSeparators(commas, inside, static_cast<uint32_t>(offset), separators);
+        carry = static_cast<uint64_t>(static_cast<int64_t>(inside) >> 63);
+    }
+}
+#endif
+
+/**
+ * Pick the fastest separator scanner the CPU supports
+ *
+ * @param name Receives the scanner's name
+ * @return The scanner
+ */
+SeparatorScanner selectSeparatorScanner(const char*& name) {
+#ifdef EMPLOYEE_HAVE_AVX2_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("pclmul")) {
+        name = "AVX2";
+        return scanSeparatorsAVX2;
+    }
+#endif
+#ifdef EMPLOYEE_HAVE_SSE2
+    name = "SSE2";
+    return scanSeparatorsSSE2;
+#else
+    name = "scalar";
+    return scanSeparatorsScalar;
+#endif
+}
+
+/**
+ * The separator scanner chosen for this CPU, picked on first use
+ *
+ * @return The scanner
+ */
+SeparatorScanner defaultSeparatorScanner() {
+    static const char* name = "";
+    static SeparatorScanner scanner = selectSeparatorScanner(name);
+    return scanner;
+}
+
+//============================================================================
+// Utility Functions for file reading and employee creation
+//============================================================================
+
+/**
+ * Enhanced CSV parsing function that properly handles quoted fields
+ *
+ * Every field is copied into a new string; the loader uses CsvTokenizer,
+ * which splits lines the same way without copying.
+ *
+ * @param line The CSV line to parse
+ * @return Vector of parsed tokens
+ */
+vector<string> parseCSVLine(const StringView& line) {
+    vector<string> tokens;
+    string currentToken = "";
+    bool inQuotes = false;
+
+    for (size_t i = 0; i < line.length(); ++i) {
+        char c = line[i];
+
+        if (c == '"') {
+            // Toggle quote state
+            inQuotes = !inQuotes;
+        }
+        else if (c == ',' && !inQuotes) {
+            // End of token - trim whitespace and add to vector
+            string trimmed = currentToken;
+            // Remove leading/trailing whitespace
+            size_t start = trimmed.find_first_not_of(" \t\r\n");
+            if (start != string::npos) {
+                size_t end = trimmed.find_last_not_of(" \t\r\n");
+                trimmed = trimmed.substr(start, end - start + 1);
+            }
+            else {
+                trimmed = "";
+            }
+            tokens.push_back(trimmed);
+            currentToken = "";
+        }
+        else {
+            currentToken += c;
+        }
+    }
+
+    // Don't forget the last token
+    if (!currentToken.empty() || !tokens.empty()) {
+        string trimmed = currentToken;
+        // Remove leading/trailing whitespace
+        size_t start = trimmed.find_first_not_of(" \t\r\n");
+        if (start != string::npos) {
+            size_t end = trimmed.find_last_not_of(" \t\r\n");
+            trimmed = trimmed.substr(start, end - start + 1);
+        }
+        else {
+            trimmed = "";
+        }
+        tokens.push_back(trimmed);
+    }
+
+    return tokens;
+}
+
+/**
+ * Trim spaces, tabs and line breaks from both ends of a view
+ *
+ * @param value The view to trim
+ * @return The trimmed view
+ */
+StringView trimView(const StringView& value) {
+    const char* begin = value.data();
+    const char* end = begin + value.size();
+    while (begin < end && (*begin == ' ' || *begin == '\t' || *begin == '\r' || *begin == '\n')) {
+        begin++;
+    }
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r' || end[-1] == '\n')) {
+        end--;
+    }
+    return StringView(begin, end - begin);
+}
+
+/*
+ * Splits CSV lines into fields without copying. Quotes group commas into
+ * a field and are removed, "" inside quotes stands for one quote, and each
+ * field is trimmed of surrounding whitespace. Fields are views into the
+ * line; only a field whose quotes sit inside its text (such as a""b or
+ * x"y"z) is unescaped into storage owned by the tokenizer. Views stay
+ * valid until the next split() or until the line goes away.
+ *
+ * The commas that end fields are found by a SeparatorScanner, by default
+ * the widest SIMD one the CPU supports.
+ */
+class CsvTokenizer {
+
+private:
+    SeparatorScanner scanner;
+    vector<uint32_t> separators;
+    vector<StringView> fields;
+    deque<string> unescaped;  // Deque, so earlier strings never move
+    size_t unescapedUsed;
+
+    StringView unescape(const char* begin, const char* end);
+
+public:
+    explicit CsvTokenizer(SeparatorScanner separatorScanner = defaultSeparatorScanner())
+        : scanner(separatorScanner), unescapedUsed(0) {}
+    const vector<StringView>& split(const StringView& line);
+};
+
+/**
+ * Copy a field with its quotes removed
+ *
+ * @param begin Start of the raw field
+ * @param end End of the raw field
+ * @return View of the unescaped, trimmed text
+ */
+StringView CsvTokenizer::unescape(const char* begin, const char* end) {
+    if (unescapedUsed == unescaped.size()) {
+        unescaped.push_back(string());
+    }
+    string& text = unescaped[unescapedUsed++];
+    text.clear();
+    bool inQuotes = false;
+    for (const char* c = begin; c < end; ++c) {
+        if (*c != '"') {
+            text += *c;
+        }
+        else if (inQuotes && c + 1 < end && c[1] == '"') {
+            text += '"';
+            ++c;
+        }
+        else {
+            inQuotes = !inQuotes;
+        }
+    }
+    return trimView(StringView(text));
+}
+
+/**
+ * Split one CSV line
+ *
+ * @param line The line to split
+ * @return The fields; a line with nothing but quotes has none
+ */
+const vector<StringView>& CsvTokenizer::split(const StringView& line) {
+    fields.clear();
+    separators.clear();
+    unescapedUsed = 0;
+    scanner(line.data(), line.size(), separators);
+
+    // Like parseCSVLine, a line holding nothing but quotes has no fields
+    if (separators.empty() && static_cast<size_t>(count(line.data(), line.data() + line.size(), '"')) == line.size()) {
+        return fields;
+    }
+
+    const char* fieldStart = line.data();
+    for (size_t i = 0; i <= separators.size(); ++i) {
+        const char* fieldEnd = line.data() + (i < separators.size() ? separators[i] : line.size());
+        StringView raw = trimView(StringView(fieldStart, fieldEnd - fieldStart));
+        if (memchr(raw.data(), '"', raw.size()) == nullptr) {
+            fields.push_back(raw);
+        }
+        else if (raw.size() >= 2 && raw[0] == '"' && raw[raw.size() - 1] == '"' &&
+                 memchr(raw.data() + 1, '"', raw.size() - 2) == nullptr) {
+            fields.push_back(trimView(StringView(raw.data() + 1, raw.size() - 2)));  // "text": no copy needed
+        }
+        else {
+            fields.push_back(unescape(fieldStart, fieldEnd));
+        }
+        fieldStart = fieldEnd + 1;
+    }
+    return fields;
+}
+
+/**
+ * Parse individual skills from a comma-separated skills string
+ *
+ * @param skillsString The skills string to parse
+ * @return A view of each non-empty, trimmed skill
+ */
+vector<StringView> parseSkills(const StringView& skillsString) {
+    vector<StringView> skills;
+    const char* cursor = skillsString.data();
+    const char* end = cursor + skillsString.size();
+    while (cursor < end) {
+        const char* comma = static_cast<const char*>(memchr(cursor, ',', end - cursor));
+        const char* skillEnd = comma != nullptr ? comma : end;
+        StringView skill = trimView(StringView(cursor, skillEnd - cursor));
+        if (!skill.empty()) {
+            skills.push_back(skill);
+        }
+        cursor = skillEnd + 1;
+    }
+    return skills;
+}
+
+/**
+ * Validate employee data for basic integrity
+ *
+ * @param fields The fields of the employee record to validate
+ * @return True if employee data is valid, false otherwise
+ */
+bool validateEmployeeData(const EmployeeFields& fields) {
+    // Check required fields
+    if (fields.employeeId.empty() || fields.fullName.empty()) {
+        return false;
+    }
+
+    // Check for reasonable field lengths
+    if (fields.employeeId.length() > 20 ||
+        fields.fullName.length() > 100 ||
+        fields.department.length() > 50 ||
+        fields.title.length() > 100 ||
+        fields.managerId.length() > 20) {
+        return false;
+    }
+
+    // Check employee ID format (should start with EMP)
+    if (!fields.employeeId.startsWith("EMP")) {
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * Read-only view of a whole file. On POSIX systems the file is mapped into
+ * memory and the kernel is told it will be read front to back, so pages are
+ * read ahead and released behind the parser; elsewhere it is read into a
+ * single buffer.
+ */
+class MappedFile {
+
+private:
+    const char* bytes;
+    size_t length;
+    bool mapped;
+    vector<char> buffer;  // Used when memory mapping is unavailable
+
+public:
+    MappedFile() : bytes(nullptr), length(0), mapped(false) {}
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const string& fileName, string& error);
+    void close();
+    void adviseRandomAccess();
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+};
+
+/**
+ * Map a file for reading
+ *
+ * @param fileName The name of the file to map
+ * @param error Receives the reason on failure
+ * @return True if the file's contents are available through data()
+ */
+bool MappedFile::open(const string& fileName, string& error) {
+    close();
+#if !defined(_WIN32)
+    int descriptor = ::open(fileName.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        error = "Could not open file: " + fileName;
+        return false;
+    }
+    struct stat info;
+    if (fstat(descriptor, &info) != 0) {
+        ::close(descriptor);
+        error = "Could not read file size: " + fileName;
+        return false;
+    }
+    if (info.st_size > 0) {
+        void* address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (address == MAP_FAILED) {
+            ::close(descriptor);
+            error = "Could not map file: " + fileName;
+            return false;
+        }
+        madvise(address, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+        bytes = static_cast<const char*>(address);
+        length = static_cast<size_t>(info.st_size);
+        mapped = true;
+    }
+    ::close(descriptor);  // The mapping stays valid after the descriptor is closed
+#else
+    ifstream file(fileName, ios::binary);
+    if (!file.is_open()) {
+        error = "Could not open file: " + fileName;
+        return false;
+    }
+    buffer.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    bytes = buffer.data();
+    length = buffer.size();
+#endif
+    return true;
+}
+
+/**
+ * Tell the system the file will be read at scattered offsets rather than
+ * front to back, so it stops reading ahead
+ */
+void MappedFile::adviseRandomAccess() {
+#if !defined(_WIN32)
+    if (mapped) {
+        madvise(const_cast<char*>(bytes), length, MADV_RANDOM);
+    }
+#endif
+}
+
+/**
+ * Unmap the file; views into it become invalid
+ */
+void MappedFile::close() {
+#if !defined(_WIN32)
+    if (mapped) {
+        munmap(const_cast<char*>(bytes), length);
+    }
+#endif
+    vector<char>().swap(buffer);
+    bytes = nullptr;
+    length = 0;
+    mapped = false;
+}
+
+/**
+ * Force everything written to an open file out to the storage device, so
+ * it survives a crash or power loss
+ *
+ * @param file The file
+ * @return True if the data is on disk
+ */
+bool flushFileToDisk(FILE* file) {
+    if (fflush(file) != 0) {
+        return false;
+    }
+#if defined(_WIN32)
+    return _commit(_fileno(file)) == 0;
+#elif defined(__linux__)
+    return fdatasync(fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+/**
+ * Cut an open file down to a size
+ *
+ * @param file The file
+ * @param size The new size in bytes
+ * @return True if the file was truncated
+ */
+bool truncateOpenFile(FILE* file, uint64_t size) {
+    if (fflush(file) != 0) {
+        return false;
+    }
+#if defined(_WIN32)
+    return _chsize_s(_fileno(file), static_cast<long long>(size)) == 0;
+#else
+    return ftruncate(fileno(file), static_cast<off_t>(size)) == 0;
+#endif
+}
+
+/**
+ * Force a closed file's contents out to the storage device
+ *
+ * @param fileName The file
+ * @return True if the data is on disk
+ */
+bool syncFile(const string& fileName) {
+    FILE* file = fopen(fileName.c_str(), "ab");
+    if (file == nullptr) {
+        return false;
+    }
+    bool synced = flushFileToDisk(file);
+    return fclose(file) == 0 && synced;
+}
+
+/**
+ * Force the directory entry of a newly created or renamed file out to the
+ * storage device. Windows keeps directory entries durable by itself.
+ *
+ * @param fileName The file whose directory should be synced
+ * @return True if the directory is on disk
+ */
+bool syncParentDirectory(const string& fileName) {
+#if !defined(_WIN32)
+    size_t separator = fileName.find_last_of('/');
+    string directory = separator == string::npos ? "." : fileName.substr(0, max<size_t>(separator, 1));
+    int descriptor = ::open(directory.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        return false;
+    }
+    bool synced = fsync(descriptor) == 0;
+    ::close(descriptor);
+    return synced;
+#else
+    (void)fileName;
+    return true;
+#endif
+}
+
+/**
+ * Split a block of text into lines the way getline does: '\n' ends a line
+ * and a final line without one still counts
+ *
+ * @param data Start of the text
+ * @param size Number of bytes
+ * @return A view of every line, without its '\n'
+ */
+vector<StringView> splitLines(const char* data, size_t size) {
+    vector<StringView> lines;
+    const char* end = data + size;
+    while (data < end) {
+        const char* newline = static_cast<const char*>(memchr(data, '\n', end - data));
+        const char* lineEnd = newline != nullptr ? newline : end;
+        lines.push_back(StringView(data, lineEnd - data));
+        data = lineEnd + 1;
+    }
+    return lines;
+}
+
+// Finds the '\n' that ends a CSV record, as findRecordEnd describes
+typedef const char* (*RecordEndFinder)(const char* data, const char* end, bool& inQuotes, size_t& lineBreaks);
+
+/**
+ * Find the '\n' that ends a CSV record with memchr, one line at a time
+ *
+ * @param data Where to continue scanning
+ * @param end End of the text available
+ * @param inQuotes Quote state at data; left at the state where the scan stopped
+ * @param lineBreaks Incremented for every line break found inside quotes
+ * @return The '\n' that ends the record, or nullptr if it runs past end
+ */
+const char* findRecordEndScalar(const char* data, const char* end, bool& inQuotes, size_t& lineBreaks) {
+    while (data < end) {
+        const char* newline = static_cast<const char*>(memchr(data, '\n', end - data));
+        const char* lineEnd = newline != nullptr ? newline : end;
+        const char* quote = data;
+        while ((quote = static_cast<const char*>(memchr(quote, '"', lineEnd - quote))) != nullptr) {
+            inQuotes = !inQuotes;
+            quote++;
+        }
+        if (newline == nullptr) {
+            return nullptr;
+        }
+        if (!inQuotes) {
+            return newline;
+        }
+        lineBreaks++;
+        data = newline + 1;
+    }
+    return nullptr;
+}
+
+/**
+ * Find the record end in one 64-byte block: the first newline outside quotes
+ *
+ * @param newlines Bit i set if byte i of the block is '\n'
+ * @param inside Bit i set if byte i of the block is inside quotes
+ * @param lineBreaks Incremented for every newline inside quotes before the record end
+ * @return Offset of the record end in the block, or 64 if the record goes on
+ */
+inline unsigned recordEndInBlock(uint64_t newlines, uint64_t inside, size_t& lineBreaks) {
+    uint64_t ends = newlines & ~inside;
+    uint64_t before = ends == 0 ? ~0ULL : (ends & (~ends + 1)) - 1;
+    lineBreaks += popCount64(newlines & inside & before);
+    return ends == 0 ? 64 : countTrailingZeros64(ends);
+}
+
+#ifdef EMPLOYEE_HAVE_SSE2
+/**
+ * Find the '\n' that ends a CSV record 64 bytes at a time: a newline mask
+ * and a quote mask per block, quoted regions from the prefix XOR of the
+ * quote mask, and the record end as the first newline outside them
+ *
+ * @param data Where to continue scanning
+ * @param end End of the text available
+ * @param inQuotes Quote state at data; left at the state where the scan stopped
+ * @param lineBreaks Incremented for every line break found inside quotes
+ * @return The '\n' that ends the record, or nullptr if it runs past end
+ */
+const char* findRecordEndSSE2(const char* data, const char* end, bool& inQuotes, size_t& lineBreaks) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i quote = _mm_set1_epi8('"');
+    size_t size = end - data;
+    uint64_t carry = inQuotes ? ~0ULL : 0;
+    char tail[64];
+    for (size_t offset = 0; offset < size; offset += 64) {
+        const char* block = data + offset;
+        if (size - offset < 64) {
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, block, size - offset);
+            block = tail;
+        }
+        uint64_t newlines = 0;
+        uint64_t quotes = 0;
+        for (int part = 0; part < 4; ++part) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * part));
+            newlines |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline))))
+                        << (16 * part);
+            quotes |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, quote))))
+                      << (16 * part);
+        }
+        uint64_t inside = quotes == 0 ? carry : prefixXor(quotes) ^ carry;
+        unsigned recordEnd = recordEndInBlock(newlines, inside, lineBreaks);
+        if (recordEnd < 64) {
+            inQuotes = false;
+            return data + offset + recordEnd;
+        }
+        carry = static_cast<uint64_t>(static_cast<int64_t>(inside) >> 63);
+    }
+    inQuotes = carry != 0;
+    return nullptr;
+}
+#endif
+
+#ifdef EMPLOYEE_HAVE_AVX2_DISPATCH
+/**
+ * Find the '\n' that ends a CSV record 64 bytes at a time with AVX2
+ * compares, taking the prefix XOR of the quote mask as a carry-less
+ * multiply by all ones
+ *
+ * @param data Where to continue scanning
+ * @param end End of the text available
+ * @param inQuotes Quote state at data; left at the state where the scan stopped
+ * @param lineBreaks Incremented for every line break found inside quotes
+ * @return The '\n' that ends the record, or nullptr if it runs past end
+ */
+EMPLOYEE_TARGET_AVX2 const char* findRecordEndAVX2(const char* data, const char* end, bool& inQuotes, size_t& lineBreaks) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m128i allOnes = _mm_set1_epi8(static_cast<char>(0xFF));
+    size_t size = end - data;
+    uint64_t carry = inQuotes ? ~0ULL : 0;
+    char tail[64];
+    for (size_t offset = 0; offset < size; offset += 64) {
+        const char* block = data + offset;
+        if (size - offset < 64) {
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, block, size - offset);
+            block = tail;
+        }
+        __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+        __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+        uint64_t newlines = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, newline))) |
+                            static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, newline))))
+                                << 32;
+        uint64_t quotes = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, quote))) |
+                          static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, quote))))
+                              << 32;
+        uint64_t inside = carry;
+        if (quotes != 0) {
+            __m128i product = _mm_clmulepi64_si128(_mm_set_epi64x(0, static_cast<long long>(quotes)), allOnes, 0);
+            inside ^= static_cast<uint64_t>(_mm_cvtsi128_si64(product));
+        }
+        unsigned recordEnd = recordEndInBlock(newlines, inside, lineBreaks);
+        if (recordEnd < 64) {
+            inQuotes = false;
+            return data + offset + recordEnd;
+        }
+        carry = static_cast<uint64_t>(static_cast<int64_t>(inside) >> 63);
+    }
+    inQuotes = carry != 0;
+    return nullptr;
+}
+#endif
+
+/**
+ * Pick the fastest record end finder the CPU supports
+ *
+ * @param name Receives the finder's name
+ * @return The finder
+ */
+RecordEndFinder selectRecordEndFinder(const char*& name) {
+#ifdef EMPLOYEE_HAVE_AVX2_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("pclmul")) {
+        name = "AVX2";
+        return findRecordEndAVX2;
+    }
+#endif
+#ifdef EMPLOYEE_HAVE_SSE2
+    name = "SSE2";
+    return findRecordEndSSE2;
+#else
+    name = "scalar";
+    return findRecordEndScalar;
+#endif
+}
+
+/**
+ * Find the '\n' that ends a CSV record. A line break inside quotes belongs
+ * to the field, so such a record runs on over several lines. Uses the
+ * finder chosen for this CPU, picked on first use.
+ *
+ * @param data Where to continue scanning
+ * @param end End of the text available
+ * @param inQuotes Quote state at data; left at the state where the scan stopped
+ * @param lineBreaks Incremented for every line break found inside quotes
+ * @return The '\n' that ends the record, or nullptr if it runs past end
+ */
+inline const char* findRecordEnd(const char* data, const char* end, bool& inQuotes, size_t& lineBreaks) {
+    static const char* name = "";
+    static RecordEndFinder finder = selectRecordEndFinder(name);
+    return finder(data, end, inQuotes, lineBreaks);
+}
+
+/*
+ * Reads a file in fixed-size blocks and hands out one record at a time.
+ * A record is a line, as getline would return it, unless a quoted field
+ * holds a line break; then the record continues to the line where the
+ * quotes close. The unfinished record at the end of a block is moved to
+ * the front of the buffer before the next block is read, so memory stays
+ * at one block (or the longest record) however large the file.
+ */
+class LineStream {
+
+private:
+    static const size_t BLOCK_SIZE = 1 << 20;
+
+    ifstream file;
+    vector<char> buffer;
+    size_t begin;       // Start of the unread text in the buffer
+    size_t end;         // End of the text read so far
+    bool finished;      // The file has no more bytes
+    size_t lineCount;   // Physical lines read, counting the ones inside records
+    size_t recordLine;  // Line on which the last record started
+
+public:
+    LineStream() : begin(0), end(0), finished(false), lineCount(0), recordLine(0) {}
+
+    bool open(const string& fileName, string& error);
+    bool next(StringView& line);
+    size_t linesRead() const { return lineCount; }
+    size_t lineNumber() const { return recordLine; }
+};
+
+/**
+ * Open a file for streaming
+ *
+ * @param fileName The name of the file to read
+ * @param error Receives the reason on failure
+ * @return True if the file was opened
+ */
+bool LineStream::open(const string& fileName, string& error) {
+    file.open(fileName, ios::binary);
+    if (!file.is_open()) {
+        error = "Could not open file: " + fileName;
+        return false;
+    }
+    buffer.resize(BLOCK_SIZE);
+    begin = end = 0;
+    finished = false;
+    lineCount = 0;
+    recordLine = 0;
+    return true;
+}
+
+/**
+ * Get the next record
+ *
+ * @param line Receives a view of the record without its final '\n'; it
+ *             stays valid until the next call
+ * @return False once every record has been returned
+ */
+bool LineStream::next(StringView& line) {
+    size_t searchFrom = begin;
+    bool inQuotes = false;
+    size_t lineBreaks = 0;
+    while (true) {
+        const char* recordEnd = findRecordEnd(buffer.data() + searchFrom, buffer.data() + end, inQuotes, lineBreaks);
+        if (recordEnd != nullptr) {
+            size_t lineEnd = recordEnd - buffer.data();
+            line = StringView(buffer.data() + begin, lineEnd - begin);
+            begin = lineEnd + 1;
+            recordLine = lineCount + 1;
+            lineCount += 1 + lineBreaks;
+            return true;
+        }
+        if (finished) {
+            if (begin == end) {
+                return false;
+            }
+            line = StringView(buffer.data() + begin, end - begin);  // Last record has no '\n'
+            begin = end;
+            recordLine = lineCount + 1;
+            lineCount += 1 + lineBreaks;
+            return true;
+        }
+
+        // Keep the partial record, then refill the rest of the buffer;
+        // the text already scanned is not scanned again
+        size_t partial = end - begin;
+        memmove(buffer.data(), buffer.data() + begin, partial);
+        begin = 0;
+        end = partial;
+        searchFrom = partial;
+        if (end == buffer.size()) {
+            buffer.resize(buffer.size() * 2);  // A single record longer than the buffer
+        }
+        file.read(buffer.data() + end, static_cast<streamsize>(buffer.size() - end));
+        end += static_cast<size_t>(file.gcount());
+        finished = file.gcount() == 0;
+    }
+}
+
+// Why a record was not loaded
+enum class RecordStatus {
+    VALID,
+    TOO_FEW_FIELDS,
+    INVALID
+};
+
+/**
+ * Split one CSV record into employee fields and validate them. Nothing is
+ * stored or interned, so any number of threads can do this at once.
+ *
+ * @param line The CSV record
+ * @param tokenizer Tokenizer reused from record to record
+ * @param fields Receives views of the fields; they stay valid until the
+ *               tokenizer's next split or until the record goes away
+ * @return VALID, or why the record has to be skipped
+ */
+RecordStatus readEmployeeFields(const StringView& line, CsvTokenizer& tokenizer, EmployeeFields& fields) {
+    // Split the line in place; fields point into the line
+    const vector<StringView>& tokens = tokenizer.split(line);
+
+    // Validate minimum required fields
+    if (tokens.size() < 2) {
+        return RecordStatus::TOO_FEW_FIELDS;
+    }
+
+    // Required fields, then optional fields with bounds checking
+    fields.employeeId = tokens[0];
+    fields.fullName = tokens[1];
+    fields.department = (tokens.size() > 2) ? tokens[2] : StringView();
+    fields.title = (tokens.size() > 3) ? tokens[3] : StringView();
+    fields.managerId = (tokens.size() > 4) ? tokens[4] : StringView();
+    fields.skills = (tokens.size() > 5) ? tokens[5] : StringView();
+
+    return validateEmployeeData(fields) ? RecordStatus::VALID : RecordStatus::INVALID;
+}
+
+/**
+ * Print the warning for a record that was skipped
+ *
+ * @param status Why the record was skipped
+ * @param lineNumber 1-based line on which the record starts
+ * @param employeeId The record's employee ID, if it had one
+ */
+void reportSkippedRecord(RecordStatus status, size_t lineNumber, const StringView& employeeId) {
+    if (status == RecordStatus::TOO_FEW_FIELDS) {
+        cout << "Warning: Skipping line " << lineNumber << " - insufficient data" << endl;
+    }
+    else {
+        cout << "Warning: Skipping invalid employee data: " << employeeId << endl;
+    }
+}
+
+/**
+ * Store validated fields in an employee, copying the text into its store's
+ * arena and dictionaries. Only one thread may use a store at a time.
+ *
+ * @param fields The employee's fields
+ * @param skills The employee's skills, already split
+ * @param skillCount Number of skills
+ * @param employee Receives the employee
+ */
+void buildEmployee(const EmployeeFields& fields, const StringView* skills, size_t skillCount, Employee& employee) {
+    employee.setEmployeeId(fields.employeeId);
+    employee.setFullName(fields.fullName);
+    employee.setDepartment(fields.department);
+    employee.setTitle(fields.title);
+    employee.setManagerId(fields.managerId);
+    for (size_t i = 0; i < skillCount; ++i) {
+        employee.addSkill(skills[i]);
+    }
+}
+
+/**
+ * Build an employee from one record of the input file
+ *
+ * @param line The CSV record
+ * @param lineNumber 1-based line on which the record starts, for warnings
+ * @param tokenizer Tokenizer reused from record to record
+ * @param employee Receives the employee
+ * @return True if the record holds a valid employee; warnings are printed otherwise
+ */
+bool parseEmployeeLine(const StringView& line, size_t lineNumber, CsvTokenizer& tokenizer, Employee& employee) {
+    EmployeeFields fields;
+    RecordStatus status = readEmployeeFields(line, tokenizer, fields);
+    if (status != RecordStatus::VALID) {
+        reportSkippedRecord(status, lineNumber, fields.employeeId);
+        return false;
+    }
+
+    // Handle skills field (6th field) with proper parsing
+    vector<StringView> skills = parseSkills(fields.skills);
+    buildEmployee(fields, skills.data(), skills.size(), employee);
+    return true;
+}
+
+/**
+ * Read the input file block by block, inserting each employee as soon as
+ * its record is complete. No copy of the file or of its records is kept,
+ * so peak memory is one block plus the tree.
+ *
+ * @param fileName The name of the file to be read
+ * @param tree The tree to fill; it is cleared once the file has data
+ * @return True if the file was read
+ */
+bool streamEmployees(const string& fileName, BinarySearchTree& tree) {
+    LineStream lines;
+    CsvTokenizer tokenizer;
+    StringView line;
+    try {
+        string error;
+        if (!lines.open(fileName, error)) {
+            throw runtime_error(error);
+        }
+        if (!lines.next(line)) {
+            throw runtime_error("File is empty: " + fileName);
+        }
+    }
+    catch (const exception& e) {
+        cout << "File reading error: " << e.what() << endl;
+        return false;
+    }
+
+    tree.clear();
+    int successCount = 0;
+    int errorCount = 0;
+    vector<string> duplicateIds;
+
+    cout << "Parsing employee data..." << endl;
+
+    // The first line is the header row
+    while (lines.next(line)) {
+        // Skip empty lines
+        if (line.empty()) {
+            continue;
+        }
+
+        Employee employee(tree.employeeStore());
+        if (!parseEmployeeLine(line, lines.lineNumber(), tokenizer, employee)) {
+            errorCount++;
+            continue;
+        }
+
+        // Add the employee to the tree; a repeated ID keeps its first record
+        if (tree.addEmployee(employee)) {
+            successCount++;
+        }
+        else {
+            duplicateIds.push_back(employee.employeeId.str());
+        }
+    }
+    tree.setSkippedDuplicates(duplicateIds);
+
+    cout << "Successfully read " << lines.linesRead() << " lines from " << fileName << endl;
+    cout << "Data loading complete: " << successCount << " employees loaded";
+    if (errorCount > 0) {
+        cout << " (" << errorCount << " errors)";
+    }
+    cout << endl;
+
+    return true;
+}
+
+/**
+ * Split a CSV file into chunks that each start where a record starts, so
+ * every chunk can be parsed on its own. A newline only ends a record when
+ * it is outside quotes, and whether an offset is inside quotes depends on
+ * every quote before it. So the file is first cut into equal slices and
+ * the quotes in each slice are counted in parallel; the running parity of
+ * those counts says whether each slice starts inside quotes, and each
+ * slice start then moves forward to the next record boundary.
+ *
+ * @param data The file's text
+ * @param size Number of bytes
+ * @param chunkCount Number of chunks wanted
+ * @param threadCount Number of threads to use
+ * @return chunkCount + 1 offsets; chunk i is [offsets[i], offsets[i + 1]),
+ *         and a chunk is empty if a record spans its whole slice
+ */
+vector<size_t> findChunkBoundaries(const char* data, size_t size, size_t chunkCount, unsigned threadCount) {
+    vector<size_t> sliceStart(chunkCount + 1);
+    for (size_t c = 0; c <= chunkCount; ++c) {
+        sliceStart[c] = static_cast<size_t>(static_cast<double>(size) * c / chunkCount);
+    }
+    sliceStart[chunkCount] = size;
+
+    // Pass 1: quote parity of every slice
+    vector<char> oddQuotes(chunkCount, 0);
+    runInParallel(chunkCount, threadCount, [&](size_t first, size_t last, unsigned) {
+        for (size_t c = first; c < last; ++c) {
+            size_t quotes = 0;
+            for (const char* p = data + sliceStart[c]; p < data + sliceStart[c + 1]; ++p) {
+                quotes += *p == '"';
+            }
+            oddQuotes[c] = static_cast<char>(quotes & 1);
+        }
+    });
+
+    // An odd number of quotes before a slice means it starts inside quotes
+    vector<char> startsInQuotes(chunkCount, 0);
+    for (size_t c = 1; c < chunkCount; ++c) {
+        startsInQuotes[c] = startsInQuotes[c - 1] ^ oddQuotes[c - 1];
+    }
+
+    // Pass 2: each slice start moves past the end of the record it falls in
+    vector<size_t> boundaries(chunkCount + 1, size);
+    boundaries[0] = 0;
+    runInParallel(chunkCount, threadCount, [&](size_t first, size_t last, unsigned) {
+        for (size_t c = max<size_t>(first, 1); c < last; ++c) {
+            bool inQuotes = startsInQuotes[c] != 0;
+            size_t lineBreaks = 0;
+            const char* recordEnd = findRecordEnd(data + sliceStart[c], data + size, inQuotes, lineBreaks);
+            boundaries[c] = recordEnd != nullptr ? static_cast<size_t>(recordEnd - data) + 1 : size;
+        }
+    });
+
+    // A record longer than a slice can carry one boundary past the next
+    for (size_t c = 1; c <= chunkCount; ++c) {
+        boundaries[c] = max(boundaries[c], boundaries[c - 1]);
+    }
+    return boundaries;
+}
+
+// An employee record parsed by a worker thread, not yet stored
+struct ParsedEmployee {
+    EmployeeFields fields;
+    uint32_t firstSkill;  // Index of the first skill in the chunk's skill list
+    uint32_t skillCount;
+};
+
+// A record a worker thread had to skip, reported once all chunks are parsed
+struct SkippedRecord {
+    size_t line;  // Line within the chunk, from 1
+    RecordStatus status;
+    StringView employeeId;
+};
+
+// Everything parsed from one chunk of the input file
+struct ParsedChunk {
+    vector<ParsedEmployee> employees;  // In file order until the chunk is sorted
+    vector<StringView> skills;
+    vector<SkippedRecord> skipped;
+    StringArena text;                  // Fields that had to be unescaped
+    size_t lineCount;
+
+    ParsedChunk() : lineCount(0) {}
+};
+
+/**
+ * Parse the records of one chunk. Fields stay views into the file, except
+ * the few the tokenizer had to unescape, which are copied into the chunk.
+ *
+ * @param begin Start of the chunk, on a record boundary
+ * @param end End of the chunk, on a record boundary
+ * @param skipHeader True for the chunk that starts with the header row
+ * @param chunk Receives the parsed records
+ */
+void parseChunk(const char* begin, const char* end, bool skipHeader, ParsedChunk& chunk) {
+    CsvTokenizer tokenizer;
+    EmployeeFields fields;
+
+    // Views into the file can be kept as they are; unescaped text is copied
+    auto keep = [&](const StringView& value) {
+        bool inFile = value.data() >= begin && value.data() + value.size() <= end;
+        return inFile ? value : chunk.text.store(value.data(), value.size());
+    };
+
+    const char* cursor = begin;
+    while (cursor < end) {
+        bool inQuotes = false;
+        size_t lineBreaks = 0;
+        const char* recordEnd = findRecordEnd(cursor, end, inQuotes, lineBreaks);
+        const char* lineEnd = recordEnd != nullptr ? recordEnd : end;
+        StringView line(cursor, lineEnd - cursor);
+        size_t lineNumber = chunk.lineCount + 1;
+        chunk.lineCount += 1 + lineBreaks;
+        cursor = lineEnd + 1;
+
+        // Skip the header row and empty lines
+        if (skipHeader) {
+            skipHeader = false;
+            continue;
+        }
+        if (line.empty()) {
+            continue;
+        }
+
+        RecordStatus status = readEmployeeFields(line, tokenizer, fields);
+        if (status != RecordStatus::VALID) {
+            StringView employeeId = status == RecordStatus::INVALID ? keep(fields.employeeId) : StringView();
+            SkippedRecord skipped = { lineNumber, status, employeeId };
+            chunk.skipped.push_back(skipped);
+            continue;
+        }
+
+        ParsedEmployee parsed;
+        parsed.fields.employeeId = keep(fields.employeeId);
+        parsed.fields.fullName = keep(fields.fullName);
+        parsed.fields.department = keep(fields.department);
+        parsed.fields.title = keep(fields.title);
+        parsed.fields.managerId = keep(fields.managerId);
+        parsed.firstSkill = static_cast<uint32_t>(chunk.skills.size());
+        vector<StringView> skills = parseSkills(keep(fields.skills));
+        chunk.skills.insert(chunk.skills.end(), skills.begin(), skills.end());
+        parsed.skillCount = static_cast<uint32_t>(skills.size());
+        chunk.employees.push_back(parsed);
+    }
+}
+
+/**
+ * Parse a mapped file on several threads: it is cut into one chunk per
+ * thread on record boundaries, and each thread tokenizes, validates and
+ * sorts its chunk by ID. Warnings for skipped records are printed
+ * afterwards in file order, as they would be from a single thread.
+ *
+ * @param data The file's text
+ * @param size Number of bytes
+ * @param threadCount Number of parser threads
+ * @param chunks Receives the sorted chunks, in file order
+ * @param lineCount Receives the number of lines read
+ * @param errorCount Receives the number of records skipped
+ */
+void parseSortedChunks(const char* data, size_t size, unsigned threadCount, vector<ParsedChunk>& chunks,
+                       size_t& lineCount, size_t& errorCount) {
+    vector<size_t> boundaries = findChunkBoundaries(data, size, threadCount, threadCount);
+    vector<ParsedChunk>(threadCount).swap(chunks);
+    runInParallel(chunks.size(), threadCount, [&](size_t first, size_t last, unsigned) {
+        for (size_t c = first; c < last; ++c) {
+            parseChunk(data + boundaries[c], data + boundaries[c + 1], c == 0, chunks[c]);
+
+            // Sorting here, in parallel, leaves only a merge for the single-threaded stage
+            stable_sort(chunks[c].employees.begin(), chunks[c].employees.end(),
+                        [](const ParsedEmployee& a, const ParsedEmployee& b) {
+                            return a.fields.employeeId < b.fields.employeeId;
+                        });
+        }
+    });
+
+    lineCount = 0;
+    errorCount = 0;
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        for (size_t i = 0; i < chunks[c].skipped.size(); ++i) {
+            const SkippedRecord& skipped = chunks[c].skipped[i];
+            reportSkippedRecord(skipped.status, lineCount + skipped.line, skipped.employeeId);
+        }
+        lineCount += chunks[c].lineCount;
+        errorCount += chunks[c].skipped.size();
+    }
+}
+
+/**
+ * Merge sorted chunks, visiting each distinct ID once in ascending order.
+ * On equal IDs the earlier chunk wins, so the first record of a duplicated
+ * ID is kept, as with single inserts.
+ *
+ * @param chunks Chunks sorted by parseSortedChunks, in file order
+ * @param visit Called with (chunk, record) for each distinct ID
+ * @param duplicateIds Receives the ID of every later record left out
+ */
+template <typename Visitor>
+void mergeSortedChunks(const vector<ParsedChunk>& chunks, Visitor visit, vector<string>& duplicateIds) {
+    vector<size_t> next(chunks.size(), 0);
+    auto comesAfter = [&](size_t a, size_t b) {
+        const StringView& idA = chunks[a].employees[next[a]].fields.employeeId;
+        const StringView& idB = chunks[b].employees[next[b]].fields.employeeId;
+        return idB < idA || (idA == idB && b < a);
+    };
+    priority_queue<size_t, vector<size_t>, decltype(comesAfter)> heads(comesAfter);
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        if (!chunks[c].employees.empty()) {
+            heads.push(c);
+        }
+    }
+
+    const ParsedEmployee* previous = nullptr;
+    while (!heads.empty()) {
+        size_t c = heads.top();
+        heads.pop();
+        const ParsedEmployee& parsed = chunks[c].employees[next[c]];
+        if (previous == nullptr || previous->fields.employeeId != parsed.fields.employeeId) {
+            visit(chunks[c], parsed);
+            previous = &parsed;
+        }
+        else {
+            duplicateIds.push_back(parsed.fields.employeeId.str());
+        }
+        if (++next[c] < chunks[c].employees.size()) {
+            heads.push(c);
+        }
+    }
+}
+
+/*
+ * Categories of one parsed chunk, interned into tables of the chunk's own
+ * so worker threads never share a dictionary. Once every chunk is done,
+ * each distinct value is interned into the store once and the per-record
+ * ids are remapped through the tables below while the chunks are merged.
+ */
+struct ChunkValues {
+    StringDictionary departments;
+    StringDictionary titles;
+    StringDictionary managers;     // Upper case, like the store's
+    StringDictionary skills;
+    vector<uint32_t> departmentIds;  // Per record, in the chunk's order
+    vector<uint32_t> titleIds;
+    vector<uint32_t> managerKeys;
+    vector<uint32_t> skillIds;       // Parallel to the chunk's skill list
+    vector<uint32_t> departmentMap;  // Chunk id -> store id
+    vector<uint32_t> titleMap;
+    vector<uint32_t> managerMap;
+    vector<uint32_t> skillMap;       // Chunk id -> store id, or NO_SKILL once the store ran out of ids
+
+    static const uint32_t NO_SKILL = 0xFFFFFFFFu;
+
+    ChunkValues() : departments(ValueMatch::EXACT), titles(ValueMatch::EXACT), managers(ValueMatch::EXACT),
+                    skills(ValueMatch::EXACT) {}
+};
+
+/**
+ * Intern a chunk's categories into the chunk's own tables. Safe to run on
+ * several chunks at once.
+ *
+ * @param chunk A parsed chunk
+ * @param values Receives the chunk's tables and per-record ids
+ */
+void internChunkValues(const ParsedChunk& chunk, ChunkValues& values) {
+    size_t recordCount = chunk.employees.size();
+    values.departmentIds.resize(recordCount);
+    values.titleIds.resize(recordCount);
+    values.managerKeys.resize(recordCount);
+    for (size_t i = 0; i < recordCount; ++i) {
+        const EmployeeFields& fields = chunk.employees[i].fields;
+        values.departmentIds[i] = values.departments.intern(fields.department);
+        values.titleIds[i] = values.titles.intern(fields.title);
+        values.managerKeys[i] = values.managers.intern(normalizeManagerId(fields.managerId));
+    }
+
+    values.skillIds.resize(chunk.skills.size());
+    for (size_t i = 0; i < chunk.skills.size(); ++i) {
+        values.skillIds[i] = values.skills.intern(chunk.skills[i]);
+    }
+}
+
+/**
+ * Intern each distinct value of a chunk into the store, recording where
+ * every chunk id went
+ *
+ * @param values A chunk's tables, filled by internChunkValues
+ * @param store The store the employees are built in
+ */
+void mapChunkValues(ChunkValues& values, EmployeeStore& store) {
+    values.departmentMap.resize(values.departments.size());
+    for (size_t id = 0; id < values.departments.size(); ++id) {
+        values.departmentMap[id] = store.departments.intern(values.departments.value(static_cast<uint32_t>(id)));
+    }
+    values.titleMap.resize(values.titles.size());
+    for (size_t id = 0; id < values.titles.size(); ++id) {
+        values.titleMap[id] = store.titles.intern(values.titles.value(static_cast<uint32_t>(id)));
+    }
+    values.managerMap.resize(values.managers.size());
+    for (size_t id = 0; id < values.managers.size(); ++id) {
+        values.managerMap[id] = store.managers.intern(values.managers.value(static_cast<uint32_t>(id)));
+    }
+
+    // Skill ids are 16 bits, as in Employee::addSkill: once they run out only known skills are accepted
+    values.skillMap.resize(values.skills.size());
+    for (size_t id = 0; id < values.skills.size(); ++id) {
+        const string& skill = values.skills.value(static_cast<uint32_t>(id));
+        uint32_t storeId;
+        if (store.skills.size() <= 0xFFFF) {
+            storeId = store.skills.intern(skill);
+        }
+        else if (!store.skills.find(skill, storeId)) {
+            cout << "Warning: Too many distinct skills, ignoring " << skill << endl;
+            storeId = ChunkValues::NO_SKILL;
+        }
+        values.skillMap[id] = storeId;
+    }
+}
+
+/**
+ * Load the input file on several threads. The chunks are parsed and sorted
+ * in parallel, and each chunk's categories are interned into tables of its
+ * own, also in parallel. One thread then interns each chunk's distinct
+ * values into the store and merges the chunks, storing each employee's
+ * text and remapping its ids, and the tree is built balanced from the
+ * merged list in one pass.
+ *
+ * @param fileName The name of the file to be read
+ * @param tree The tree to fill; it is cleared once the file has data
+ * @param threadCount Number of parser threads
+ * @return True if the file was read
+ */
+bool loadEmployeesInParallel(const string& fileName, BinarySearchTree& tree, unsigned threadCount) {
+    MappedFile file;
+    try {
+        string error;
+        if (!file.open(fileName, error)) {
+            throw runtime_error(error);
+        }
+        if (file.size() == 0) {
+            throw runtime_error("File is empty: " + fileName);
+        }
+    }
+    catch (const exception& e) {
+        cout << "File reading error: " << e.what() << endl;
+        return false;
+    }
+
+    tree.clear();
+    cout << "Parsing employee data..." << endl;
+
+    vector<ParsedChunk> chunks;
+    size_t lineCount = 0;
+    size_t errorCount = 0;
+    parseSortedChunks(file.data(), file.size(), threadCount, chunks, lineCount, errorCount);
+    size_t parsedCount = 0;
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        parsedCount += chunks[c].employees.size();
+    }
+
+    vector<ChunkValues> values(chunks.size());
+    runInParallel(chunks.size(), threadCount, [&](size_t first, size_t last, unsigned) {
+        for (size_t c = first; c < last; ++c) {
+            internChunkValues(chunks[c], values[c]);
+        }
+    });
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        mapChunkValues(values[c], *tree.employeeStore());
+    }
+
+    vector<Employee> employees;
+    vector<string> duplicateIds;
+    employees.reserve(parsedCount);
+    mergeSortedChunks(chunks, [&](const ParsedChunk& chunk, const ParsedEmployee& parsed) {
+        const ChunkValues& chunkValues = values[&chunk - chunks.data()];
+        size_t record = &parsed - chunk.employees.data();
+        employees.push_back(Employee(tree.employeeStore()));
+        Employee& employee = employees.back();
+        employee.setEmployeeId(parsed.fields.employeeId);
+        employee.setFullName(parsed.fields.fullName);
+        employee.departmentId = chunkValues.departmentMap[chunkValues.departmentIds[record]];
+        employee.titleId = chunkValues.titleMap[chunkValues.titleIds[record]];
+        employee.managerKey = chunkValues.managerMap[chunkValues.managerKeys[record]];
+        for (size_t i = 0; i < parsed.skillCount; ++i) {
+            uint32_t skill = chunkValues.skillMap[chunkValues.skillIds[parsed.firstSkill + i]];
+            if (skill != ChunkValues::NO_SKILL) {
+                employee.skills.add(static_cast<uint16_t>(skill));
+            }
+        }
+    }, duplicateIds);
+
+    // Every field now lives in the employee text arena or the dictionaries
+    values.clear();
+    chunks.clear();
+    file.close();
+    size_t successCount = employees.size();
+    tree.bulkLoad(employees);
+    tree.setSkippedDuplicates(duplicateIds);
+
+    cout << "Successfully read " << lineCount << " lines from " << fileName << endl;
+    cout << "Data loading complete: " << successCount << " employees loaded";
+    if (errorCount > 0) {
+        cout << " (" << errorCount << " errors)";
+    }
+    cout << endl;
+
+    return true;
+}
+
+/*
+ * Bounded single-producer, single-consumer queue. Only the producer writes
+ * tail and only the consumer writes head, so each call is one acquire load
+ * of the other side's index and one release store of its own, with no
+ * locks. Capacity is a power of two so positions wrap with a mask. A full
+ * queue makes tryPush fail, which is how a fast producer is held back.
+ */
+template <typename T>
+class SpscRing {
+
+private:
+    vector<T> slots;
+    size_t mask;
+    atomic<size_t> head;   // Next position to pop, written by the consumer
+    char padding[64];      // Keeps head and tail on separate cache lines
+    atomic<size_t> tail;   // Next position to push, written by the producer
+
+public:
+    explicit SpscRing(size_t capacity) : head(0), tail(0) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        slots.resize(size);
+        mask = size - 1;
+    }
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    /**
+     * Add an item; called by the producer only
+     *
+     * @param item The item to add
+     * @return False if the queue is full
+     */
+    bool tryPush(const T& item) {
+        size_t position = tail.load(memory_order_relaxed);
+        if (position - head.load(memory_order_acquire) == slots.size()) {
+            return false;
+        }
+        slots[position & mask] = item;
+        tail.store(position + 1, memory_order_release);
+        return true;
+    }
+
+    /**
+     * Take the oldest item; called by the consumer only
+     *
+     * @param item Receives the item
+     * @return False if the queue is empty
+     */
+    bool tryPop(T& item) {
+        size_t position = head.load(memory_order_relaxed);
+        if (position == tail.load(memory_order_acquire)) {
+            return false;
+        }
+        item = slots[position & mask];
+        head.store(position + 1, memory_order_release);
+        return true;
+    }
+};
+
+// Counters from one pipelined load, to show which stage limits it
+struct PipelineStats {
+    unsigned parserCount;
+    size_t batchCount;
+    size_t recordCount;        // Records parsed, valid or not
+    size_t byteCount;
+    double parseSeconds;       // Parser time spent parsing, summed over parsers
+    double parserStallSeconds; // Parser time spent waiting on a full queue, summed
+    double buildSeconds;       // Builder time spent storing and inserting employees
+    double builderIdleSeconds; // Builder time spent waiting on an empty queue
+    double totalSeconds;
+
+    PipelineStats()
+        : parserCount(0), batchCount(0), recordCount(0), byteCount(0), parseSeconds(0), parserStallSeconds(0),
+          buildSeconds(0), builderIdleSeconds(0), totalSeconds(0) {}
+};
+
+/**
+ * Print the throughput of each stage of a pipelined load. The stage that
+ * never waits is the bottleneck: parsers stalled on full queues mean the
+ * builder cannot keep up, a builder idle on empty queues means the parsers
+ * cannot.
+ *
+ * @param stats Counters from the load
+ */
+void printPipelineStats(const PipelineStats& stats) {
+    double parseWall = stats.parseSeconds / max(1u, stats.parserCount);
+    double parserTime = stats.parseSeconds + stats.parserStallSeconds;
+    double builderTime = stats.buildSeconds + stats.builderIdleSeconds;
+    cout << fixed << setprecision(1);
+    cout << "Load pipeline: " << stats.batchCount << " batches, " << stats.totalSeconds << " s" << endl;
+    cout << "  Parsers (" << stats.parserCount << "): "
+         << (parseWall > 0 ? stats.recordCount / parseWall / 1e6 : 0) << "M records/s, "
+         << (parseWall > 0 ? stats.byteCount / parseWall / 1e6 : 0) << " MB/s; stalled on full queues "
+         << (parserTime > 0 ? 100 * stats.parserStallSeconds / parserTime : 0) << "% of the time" << endl;
+    cout << "  Builder:     "
+         << (stats.buildSeconds > 0 ? stats.recordCount / stats.buildSeconds / 1e6 : 0) << "M records/s; idle on empty queues "
+         << (builderTime > 0 ? 100 * stats.builderIdleSeconds / builderTime : 0) << "% of the time" << endl;
+    cout.unsetf(ios::floatfield);
+}
+
+/**
+ * Load the input file through a pipeline: parser threads turn batches of
+ * records into fields while this thread stores them and inserts them into
+ * the tree one by one. The mapped file is cut into small batches on record
+ * boundaries and batch i goes to parser i % parserCount, which hands it
+ * over through its own bounded queue. The builder takes batches from the
+ * queues in turn, so records are inserted in file order, duplicated IDs
+ * keep their first record and warnings come out in order, as with a
+ * single thread.
+ *
+ * @param fileName The name of the file to be read
+ * @param tree The tree to fill; it is cleared once the file has data
+ * @param parserCount Number of parser threads, besides the builder
+ * @param stats Receives the stage counters
+ * @return True if the file was read
+ */
+bool loadEmployeesPipelined(const string& fileName, BinarySearchTree& tree, unsigned parserCount, PipelineStats& stats) {
+    static const size_t BATCH_BYTES = 256 << 10;
+    static const size_t BATCHES_IN_FLIGHT = 8;  // Queue capacity per parser
+
+    MappedFile file;
+    try {
+        string error;
+        if (!file.open(fileName, error)) {
+            throw runtime_error(error);
+        }
+        if (file.size() == 0) {
+            throw runtime_error("File is empty: " + fileName);
+        }
+    }
+    catch (const exception& e) {
+        cout << "File reading error: " << e.what() << endl;
+        return false;
+    }
+
+    tree.clear();
+    cout << "Parsing employee data..." << endl;
+
+    auto loadStart = chrono::steady_clock::now();
+    parserCount = max(1u, parserCount);
+    const char* data = file.data();
+    size_t batchCount = (file.size() + BATCH_BYTES - 1) / BATCH_BYTES;
+    vector<size_t> boundaries = findChunkBoundaries(data, file.size(), batchCount, parserCount);
+
+    stats = PipelineStats();
+    stats.parserCount = parserCount;
+    stats.batchCount = batchCount;
+    stats.byteCount = file.size();
+
+    // Each parser owns one queue and times its own work; the builder reads the totals after join
+    deque<SpscRing<ParsedChunk*> > queues;
+    for (unsigned p = 0; p < parserCount; ++p) {
+        queues.emplace_back(BATCHES_IN_FLIGHT);
+    }
+    vector<double> parseSeconds(parserCount, 0.0);
+    vector<double> stallSeconds(parserCount, 0.0);
+
+    vector<thread> parsers;
+    for (unsigned p = 0; p < parserCount; ++p) {
+        parsers.push_back(thread([&, p]() {
+            for (size_t b = p; b < batchCount; b += parserCount) {
+                auto start = chrono::steady_clock::now();
+                ParsedChunk* batch = new ParsedChunk();
+                parseChunk(data + boundaries[b], data + boundaries[b + 1], b == 0, *batch);
+                auto parsed = chrono::steady_clock::now();
+                parseSeconds[p] += chrono::duration<double>(parsed - start).count();
+
+                // Backpressure: wait while the builder still has a full queue of our batches
+                if (!queues[p].tryPush(batch)) {
+                    while (!queues[p].tryPush(batch)) {
+                        this_thread::yield();
+                    }
+                    stallSeconds[p] += chrono::duration<double>(chrono::steady_clock::now() - parsed).count();
+                }
+            }
+        }));
+    }
+
+    size_t lineCount = 0;
+    size_t successCount = 0;
+    size_t errorCount = 0;
+    vector<string> duplicateIds;
+    for (size_t b = 0; b < batchCount; ++b) {
+        SpscRing<ParsedChunk*>& queue = queues[b % parserCount];
+        ParsedChunk* batch = nullptr;
+        if (!queue.tryPop(batch)) {
+            auto waitStart = chrono::steady_clock::now();
+            while (!queue.tryPop(batch)) {
+                this_thread::yield();
+            }
+            stats.builderIdleSeconds += chrono::duration<double>(chrono::steady_clock::now() - waitStart).count();
+        }
+
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < batch->skipped.size(); ++i) {
+            const SkippedRecord& skipped = batch->skipped[i];
+            reportSkippedRecord(skipped.status, lineCount + skipped.line, skipped.employeeId);
+        }
+        for (size_t i = 0; i < batch->employees.size(); ++i) {
+            const ParsedEmployee& parsed = batch->employees[i];
+            Employee employee(tree.employeeStore());
+            buildEmployee(parsed.fields, batch->skills.data() + parsed.firstSkill, parsed.skillCount, employee);
+            if (tree.addEmployee(employee)) {
+                successCount++;
+            }
+            else {
+                duplicateIds.push_back(employee.employeeId.str());
+            }
+        }
+        lineCount += batch->lineCount;
+        errorCount += batch->skipped.size();
+        delete batch;
+        stats.buildSeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+
+    for (size_t p = 0; p < parsers.size(); ++p) {
+        parsers[p].join();
+        stats.parseSeconds += parseSeconds[p];
+        stats.parserStallSeconds += stallSeconds[p];
+    }
+    stats.recordCount = successCount + duplicateIds.size() + errorCount;
+    tree.setSkippedDuplicates(duplicateIds);
+    stats.totalSeconds = chrono::duration<double>(chrono::steady_clock::now() - loadStart).count();
+
+    cout << "Successfully read " << lineCount << " lines from " << fileName << endl;
+    cout << "Data loading complete: " << successCount << " employees loaded";
+    if (errorCount > 0) {
+        cout << " (" << errorCount << " errors)";
+    }
+    cout << endl;
+
+    return true;
+}
+
+/**
+ * Read the input file into the tree
+ *
+ * @param fileName The name of the file to be read
+ * @param tree The tree to fill; it is cleared once the file has data
+ * @param strategy How to read it; AUTO streams on one core and splits the
+ *                 file into chunks on more
+ * @param threadCount Number of threads to use
+ * @return True if the file was read
+ */
+bool createEmployee(const string& fileName, BinarySearchTree& tree, LoadStrategy strategy, unsigned threadCount) {
+    if (strategy == LoadStrategy::AUTO) {
+        strategy = threadCount <= 1 ? LoadStrategy::STREAM : LoadStrategy::CHUNKED;
+    }
+
+    switch (strategy) {
+    case LoadStrategy::CHUNKED:
+        return loadEmployeesInParallel(fileName, tree, max(1u, threadCount));
+    case LoadStrategy::PIPELINE: {
+        // One core builds the tree; the others parse for it
+        PipelineStats stats;
+        if (!loadEmployeesPipelined(fileName, tree, max(1u, threadCount - 1), stats)) {
+            return false;
+        }
+        printPipelineStats(stats);
+        return true;
+    }
+    default:
+        return streamEmployees(fileName, tree);
+    }
+}
+
+// What a delta reload changes: the new records, and the IDs that go away
+struct ReloadSummary {
+    vector<Employee> added;
+    vector<Employee> updated;
+    vector<string> removed;
+    vector<string> duplicates;  // IDs of records left out because an earlier record had them
+    size_t unchanged;
+    double compareSeconds;  // Parsing the file and diffing it against the tree
+    double applySeconds;    // Changing the tree
+    size_t reclaimedBytes;  // Unused text freed by compacting the store afterwards, or 0
+
+    ReloadSummary() : unchanged(0), compareSeconds(0), applySeconds(0), reclaimedBytes(0) {}
+};
+
+/**
+ * Check whether a parsed record holds the same details as a stored
+ * employee. Skills are compared in order after dropping repeats and the
+ * manager ID in upper case, the way buildEmployee would store them.
+ *
+ * @param employee The stored employee
+ * @param fields The record's fields
+ * @param skills The record's skills, already split
+ * @param skillCount Number of skills
+ * @return True if storing the record would change nothing
+ */
+bool matchesEmployee(const Employee& employee, const EmployeeFields& fields, const StringView* skills, size_t skillCount) {
+    if (employee.fullName != fields.fullName || fields.department != employee.department() ||
+        fields.title != employee.title() || normalizeManagerId(fields.managerId) != employee.managerId()) {
+        return false;
+    }
+    size_t matched = 0;
+    for (size_t i = 0; i < skillCount; ++i) {
+        if (find(skills, skills + i, skills[i]) != skills + i) {
+            continue;
+        }
+        if (matched == employee.skillCount() || skills[i] != employee.skill(matched)) {
+            return false;
+        }
+        matched++;
+    }
+    return matched == employee.skillCount();
+}
+
+/**
+ * Find what it takes to bring a loaded tree up to date with a new version
+ * of the input file. The file is parsed in sorted chunks and merged into
+ * one stream in ID order, which is walked alongside the tree's in-order
+ * list: an ID only in the file is added, one only in the tree is removed,
+ * and one in both is updated if any field changed. Unchanged records are
+ * only compared, never stored, so applying the result does work for the
+ * changes alone.
+ *
+ * @param fileName The name of the file to be read
+ * @param tree The loaded tree; it is not changed, but the added and updated
+ *             records are built in its store
+ * @param threadCount Number of parser threads
+ * @param summary Receives the changes
+ * @return True if the file was read
+ */
+bool diffEmployeeFile(const string& fileName, BinarySearchTree& tree, unsigned threadCount, ReloadSummary& summary) {
+    MappedFile file;
+    try {
+        string error;
+        if (!file.open(fileName, error)) {
+            throw runtime_error(error);
+        }
+        if (file.size() == 0) {
+            throw runtime_error("File is empty: " + fileName);
+        }
+    }
+    catch (const exception& e) {
+        cout << "File reading error: " << e.what() << endl;
+        return false;
+    }
+
+    cout << "Parsing employee data..." << endl;
+    summary = ReloadSummary();
+    auto start = chrono::steady_clock::now();
+
+    vector<ParsedChunk> chunks;
+    size_t lineCount = 0;
+    size_t errorCount = 0;
+    parseSortedChunks(file.data(), file.size(), max(1u, threadCount), chunks, lineCount, errorCount);
+
+    // Merge the file's records with the tree's, both in ID order
+    vector<const Employee*> current = tree.getEmployeesInOrder();
+    size_t position = 0;
+    mergeSortedChunks(chunks, [&](const ParsedChunk& chunk, const ParsedEmployee& parsed) {
+        const StringView* skills = chunk.skills.data() + parsed.firstSkill;
+        while (position < current.size() && current[position]->employeeId < parsed.fields.employeeId) {
+            summary.removed.push_back(current[position++]->employeeId.str());
+        }
+        if (position < current.size() && current[position]->employeeId == parsed.fields.employeeId) {
+            if (matchesEmployee(*current[position++], parsed.fields, skills, parsed.skillCount)) {
+                summary.unchanged++;
+                return;
+            }
+            summary.updated.push_back(Employee(tree.employeeStore()));
+            buildEmployee(parsed.fields, skills, parsed.skillCount, summary.updated.back());
+        }
+        else {
+            summary.added.push_back(Employee(tree.employeeStore()));
+            buildEmployee(parsed.fields, skills, parsed.skillCount, summary.added.back());
+        }
+    }, summary.duplicates);
+    while (position < current.size()) {
+        summary.removed.push_back(current[position++]->employeeId.str());
+    }
+    current.clear();
+    chunks.clear();
+    file.close();
+
+    summary.compareSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "Successfully read " << lineCount << " lines from " << fileName << endl;
+    if (errorCount > 0) {
+        cout << errorCount << " records skipped" << endl;
+    }
+    return true;
+}
+
+/**
+ * Apply the changes found by diffEmployeeFile: removals, then updates,
+ * then additions. Each reload leaves the text of the records it replaced
+ * in the store, so once half of the text is unused the store is compacted,
+ * which costs about as much as a full load.
+ *
+ * @param tree The tree the changes were found against
+ * @param summary The changes; receives the time taken and the bytes reclaimed
+ */
+void applyEmployeeChanges(BinarySearchTree& tree, ReloadSummary& summary) {
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < summary.removed.size(); ++i) {
+        tree.removeEmployee(summary.removed[i]);
+    }
+    for (size_t i = 0; i < summary.updated.size(); ++i) {
+        tree.updateEmployee(summary.updated[i]);
+    }
+    for (size_t i = 0; i < summary.added.size(); ++i) {
+        tree.addEmployee(summary.added[i]);
+    }
+    tree.setSkippedDuplicates(summary.duplicates);
+
+    size_t deadBytes = tree.getDeadTextBytes();
+    if (deadBytes * 2 >= tree.employeeStore()->text.bytesUsed() && deadBytes > 0) {
+        tree.compactStore();
+        summary.reclaimedBytes = deadBytes;
+    }
+    summary.applySeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+//============================================================================
+// Binary snapshots
+//============================================================================
+
+/*
+ * A snapshot stores a loaded tree so a restart can skip the CSV file. All
+ * integers are in the writer's byte order, which loading checks:
+ *
+ *   SnapshotHeader
+ *   dictionary table  one SnapshotText per value: departments, titles,
+ *                     manager IDs, then skills, each in dictionary id order
+ *   record table      one fixed-width SnapshotRecord per employee
+ *   key array         one SnapshotKey per employee in Eytzinger order,
+ *                     starting on a 64-byte boundary
+ *   skill table       16-bit skill ids; each record owns a run of them
+ *   string heap       every ID, name and dictionary value, back to back
+ *
+ * Records are written in ascending ID order, so the tree is built from
+ * them in one pass without sorting. Text is stored as offset/length pairs
+ * into the heap; loading maps the file, copies the heap into a fresh
+ * employee store in one piece and turns each pair into a view of that copy.
+ *
+ * The key array lets a MappedEmployeeIndex answer lookups from the mapped
+ * file itself, with nothing parsed or copied. Entry k's children are
+ * entries 2k and 2k + 1 (entry 0 is unused), so a search reads the array
+ * from the front, where the top levels share a few cache lines, and the
+ * four entries two levels down always share one line and can be
+ * prefetched together.
+ */
+
+const char SNAPSHOT_MAGIC[8] = { 'E', 'M', 'P', 'S', 'N', 'A', 'P', '\0' };
+const uint32_t SNAPSHOT_VERSION = 3;
+const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+const size_t SNAPSHOT_DICTIONARIES = 4;
+const size_t SNAPSHOT_KEY_PREFIX = 12;
+
+// Text in the string heap
+struct SnapshotText {
+    uint32_t offset;
+    uint32_t length;
+};
+
+// One employee; categories are indexes into the snapshot's dictionary tables
+struct SnapshotRecord {
+    SnapshotText employeeId;
+    SnapshotText fullName;
+    uint32_t departmentId;
+    uint32_t titleId;
+    uint32_t managerKey;
+    uint32_t firstSkill;  // Index of the employee's first entry in the skill table
+    uint32_t skillCount;
+    uint32_t reserved;    // Zero; keeps records a multiple of 8 bytes
+};
+
+// One search key: the start of an employee ID, zero-padded, and its record
+struct SnapshotKey {
+    char prefix[SNAPSHOT_KEY_PREFIX];
+    uint32_t record;
+};
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t recordCount;
+    uint64_t skillEntryCount;
+    uint32_t dictionarySizes[SNAPSHOT_DICTIONARIES];  // Departments, titles, manager IDs, skills
+    uint64_t dictionaryOffset;                        // File offset of each section
+    uint64_t recordOffset;
+    uint64_t keyOffset;
+    uint64_t skillOffset;
+    uint64_t heapOffset;
+    uint64_t heapSize;
+    uint64_t generation;  // Checkpoint number; a change log replays only onto the same one
+};
+
+/**
+ * Build the search key for an employee ID
+ *
+ * @param employeeId The ID
+ * @param record The ID's record number
+ * @return Key holding the first SNAPSHOT_KEY_PREFIX bytes of the ID
+ */
+SnapshotKey makeSnapshotKey(const StringView& employeeId, uint32_t record) {
+    SnapshotKey key;
+    memset(key.prefix, 0, sizeof(key.prefix));
+    memcpy(key.prefix, employeeId.data(), min(employeeId.size(), SNAPSHOT_KEY_PREFIX));
+    key.record = record;
+    return key;
+}
+
+/**
+ * Helper function that lays sorted IDs out in Eytzinger order by visiting
+ * the implicit tree in order
+ *
+ * @param employees Employees in ascending ID order
+ * @param keys Receives the keys; entry 0 is unused
+ * @param next Next employee to place
+ * @param k Array position of the subtree root
+ */
+void fillEytzingerKeys(const vector<const Employee*>& employees, vector<SnapshotKey>& keys, size_t& next, size_t k) {
+    if (k < keys.size()) {
+        fillEytzingerKeys(employees, keys, next, 2 * k);
+        keys[k] = makeSnapshotKey(employees[next]->employeeId, static_cast<uint32_t>(next));
+        next++;
+        fillEytzingerKeys(employees, keys, next, 2 * k + 1);
+    }
+}
+
+/**
+ * Read and check a snapshot's header: its format, and that every section
+ * lies inside the file
+ *
+ * @param file The mapped snapshot
+ * @param fileName The snapshot's name, for messages
+ * @param header Receives the header
+ * @param error Receives the reason on failure
+ * @return True if the header is usable
+ */
+bool readSnapshotHeader(const MappedFile& file, const string& fileName, SnapshotHeader& header, string& error) {
+    uint64_t size = file.size();
+    if (size < sizeof(header)) {
+        error = "Not a snapshot file: " + fileName;
+        return false;
+    }
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+        error = "Not a snapshot file: " + fileName;
+        return false;
+    }
+    if (header.byteOrder != SNAPSHOT_BYTE_ORDER) {
+        error = "Snapshot was written on a machine with a different byte order: " + fileName;
+        return false;
+    }
+    if (header.version != SNAPSHOT_VERSION) {
+        error = "Unsupported snapshot version " + to_string(header.version) + ": " + fileName;
+        return false;
+    }
+
+    auto fits = [size](uint64_t offset, uint64_t count, uint64_t width) {
+        return offset <= size && count <= (size - offset) / width;
+    };
+    uint64_t dictionaryEntries = 0;
+    for (size_t d = 0; d < SNAPSHOT_DICTIONARIES; ++d) {
+        dictionaryEntries += header.dictionarySizes[d];
+    }
+    if (!fits(header.dictionaryOffset, dictionaryEntries, sizeof(SnapshotText)) ||
+        !fits(header.recordOffset, header.recordCount, sizeof(SnapshotRecord)) ||
+        header.recordCount > 0xFFFFFFFFu || !fits(header.keyOffset, header.recordCount + 1, sizeof(SnapshotKey)) ||
+        !fits(header.skillOffset, header.skillEntryCount, sizeof(uint16_t)) ||
+        !fits(header.heapOffset, header.heapSize, 1) || header.heapSize > 0xFFFFFFFFu) {
+        error = "Snapshot file is damaged: " + fileName;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Read the generation of a snapshot without loading it
+ *
+ * @param fileName The snapshot file
+ * @param generation Receives the snapshot's generation
+ * @param error Receives the reason on failure
+ * @return True if the file is a usable snapshot
+ */
+bool readSnapshotGeneration(const string& fileName, uint64_t& generation, string& error) {
+    MappedFile file;
+    SnapshotHeader header;
+    if (!file.open(fileName, error) || !readSnapshotHeader(file, fileName, header, error)) {
+        return false;
+    }
+    generation = header.generation;
+    return true;
+}
+
+/**
+ * The dictionaries a snapshot stores, in file order
+ *
+ * @param store The store holding the dictionaries
+ * @param index 0 to SNAPSHOT_DICTIONARIES - 1
+ * @return The dictionary
+ */
+StringDictionary& snapshotDictionary(EmployeeStore& store, size_t index) {
+    switch (index) {
+    case 0:
+        return store.departments;
+    case 1:
+        return store.titles;
+    case 2:
+        return store.managers;
+    default:
+        return store.skills;
+    }
+}
+
+/**
+ * Helper function that lists a subtree's employees in ID order
+ *
+ * @param node The root of the subtree to list
+ * @param employees Receives a pointer to each employee
+ */
+void BinarySearchTree::collectEmployees(Node* node, vector<const Employee*>& employees) const {
+    if (node != nullptr) {
+        collectEmployees(node->left, employees);
+        employees.push_back(&node->employee);
+        collectEmployees(node->right, employees);
+    }
+}
+
+/**
+ * List every employee in ID order. The pointers stay valid until the
+ * employee is removed or the tree is cleared.
+ *
+ * @return Pointers to the stored employees
+ */
+vector<const Employee*> BinarySearchTree::getEmployeesInOrder() const {
+    vector<const Employee*> employees;
+    employees.reserve(employeeCount);
+    collectEmployees(root, employees);
+    return employees;
+}
+
+/**
+ * Write every employee to a snapshot file. The file is written under a
+ * temporary name and renamed over the old one, so a crash part-way
+ * through leaves the previous snapshot intact.
+ *
+ * @param fileName The snapshot file to write
+ * @param generation Checkpoint number to record in the header
+ * @param error Receives the reason on failure
+ * @return True if the snapshot was written
+ */
+bool BinarySearchTree::saveSnapshot(const string& fileName, uint64_t generation, string& error) const {
+    vector<const Employee*> employees;
+    employees.reserve(employeeCount);
+    collectEmployees(root, employees);
+
+    // Size every section first so the header can hold their offsets
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.byteOrder = SNAPSHOT_BYTE_ORDER;
+    header.recordCount = employees.size();
+    header.generation = generation;
+
+    uint64_t dictionaryEntries = 0;
+    for (size_t d = 0; d < SNAPSHOT_DICTIONARIES; ++d) {
+        const StringDictionary& dictionary = snapshotDictionary(*store, d);
+        header.dictionarySizes[d] = static_cast<uint32_t>(dictionary.size());
+        dictionaryEntries += dictionary.size();
+        for (size_t i = 0; i < dictionary.size(); ++i) {
+            header.heapSize += dictionary.value(static_cast<uint32_t>(i)).size();
+        }
+    }
+    for (size_t i = 0; i < employees.size(); ++i) {
+        header.heapSize += employees[i]->employeeId.size() + employees[i]->fullName.size();
+        header.skillEntryCount += employees[i]->skillCount();
+    }
+    if (header.heapSize > 0xFFFFFFFFu || header.skillEntryCount > 0xFFFFFFFFu || header.recordCount > 0xFFFFFFFFu) {
+        error = "Too much data for the snapshot format";
+        return false;
+    }
+
+    header.dictionaryOffset = sizeof(SnapshotHeader);
+    header.recordOffset = header.dictionaryOffset + dictionaryEntries * sizeof(SnapshotText);
+    header.keyOffset = (header.recordOffset + header.recordCount * sizeof(SnapshotRecord) + 63) / 64 * 64;
+    header.skillOffset = header.keyOffset + (header.recordCount + 1) * sizeof(SnapshotKey);
+    header.heapOffset = header.skillOffset + header.skillEntryCount * sizeof(uint16_t);
+
+    string temporaryName = fileName + ".tmp";
+    ofstream file(temporaryName, ios::binary | ios::trunc);
+    if (!file.is_open()) {
+        error = "Could not create file: " + temporaryName;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    // Heap offsets are handed out in the same order the heap is written below
+    uint32_t heapCursor = 0;
+    auto place = [&heapCursor](size_t length) {
+        SnapshotText text = { heapCursor, static_cast<uint32_t>(length) };
+        heapCursor += static_cast<uint32_t>(length);
+        return text;
+    };
+
+    for (size_t d = 0; d < SNAPSHOT_DICTIONARIES; ++d) {
+        const StringDictionary& dictionary = snapshotDictionary(*store, d);
+        for (size_t i = 0; i < dictionary.size(); ++i) {
+            SnapshotText text = place(dictionary.value(static_cast<uint32_t>(i)).size());
+            file.write(reinterpret_cast<const char*>(&text), sizeof(text));
+        }
+    }
+
+    uint32_t skillCursor = 0;
+    for (size_t i = 0; i < employees.size(); ++i) {
+        const Employee& employee = *employees[i];
+        SnapshotRecord record;
+        record.employeeId = place(employee.employeeId.size());
+        record.fullName = place(employee.fullName.size());
+        record.departmentId = employee.departmentId;
+        record.titleId = employee.titleId;
+        record.managerKey = employee.managerKey;
+        record.firstSkill = skillCursor;
+        record.skillCount = static_cast<uint32_t>(employee.skillCount());
+        record.reserved = 0;
+        skillCursor += record.skillCount;
+        file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    }
+
+    // Pad to the key array's cache-line boundary
+    uint64_t recordEnd = header.recordOffset + header.recordCount * sizeof(SnapshotRecord);
+    const char zeros[64] = {};
+    file.write(zeros, static_cast<streamsize>(header.keyOffset - recordEnd));
+
+    vector<SnapshotKey> keys(employees.size() + 1);
+    memset(&keys[0], 0, sizeof(SnapshotKey));
+    size_t placed = 0;
+    fillEytzingerKeys(employees, keys, placed, 1);
+    file.write(reinterpret_cast<const char*>(keys.data()), static_cast<streamsize>(keys.size() * sizeof(SnapshotKey)));
+
+    for (size_t i = 0; i < employees.size(); ++i) {
+        for (size_t k = 0; k < employees[i]->skillCount(); ++k) {
+            uint16_t skillId = employees[i]->skills[k];
+            file.write(reinterpret_cast<const char*>(&skillId), sizeof(skillId));
+        }
+    }
+
+    for (size_t d = 0; d < SNAPSHOT_DICTIONARIES; ++d) {
+        const StringDictionary& dictionary = snapshotDictionary(*store, d);
+        for (size_t i = 0; i < dictionary.size(); ++i) {
+            const string& value = dictionary.value(static_cast<uint32_t>(i));
+            file.write(value.data(), static_cast<streamsize>(value.size()));
+        }
+    }
+    for (size_t i = 0; i < employees.size(); ++i) {
+        file.write(employees[i]->employeeId.data(), static_cast<streamsize>(employees[i]->employeeId.size()));
+        file.write(employees[i]->fullName.data(), static_cast<streamsize>(employees[i]->fullName.size()));
+    }
+
+    file.close();
+    if (file.fail() || !syncFile(temporaryName)) {
+        error = "Could not write file: " + temporaryName;
+        remove(temporaryName.c_str());
+        return false;
+    }
+    if (rename(temporaryName.c_str(), fileName.c_str()) != 0) {
+        // Windows will not rename over an existing file
+        remove(fileName.c_str());
+        if (rename(temporaryName.c_str(), fileName.c_str()) != 0) {
+            error = "Could not replace file: " + fileName;
+            return false;
+        }
+    }
+
+    // The data reached the disk before the rename, so the new name never points at a partial file
+    syncParentDirectory(fileName);
+    return true;
+}
+
+/**
+ * Replace every employee with the contents of a snapshot file. The whole
+ * file is checked before anything changes, so a damaged or foreign file
+ * leaves the tree as it was.
+ *
+ * @param fileName The snapshot file to read
+ * @param generation Receives the checkpoint number recorded in the header
+ * @param error Receives the reason on failure
+ * @return True if the snapshot was loaded
+ */
+bool BinarySearchTree::loadSnapshot(const string& fileName, uint64_t& generation, string& error) {
+    MappedFile file;
+    if (!file.open(fileName, error)) {
+        return false;
+    }
+    SnapshotHeader header;
+    if (!readSnapshotHeader(file, fileName, header, error)) {
+        return false;
+    }
+    const char* data = file.data();
+    const char* heap = data + header.heapOffset;
+    auto inHeap = [&header](const SnapshotText& text) {
+        return text.offset <= header.heapSize && text.length <= header.heapSize - text.offset;
+    };
+
+    // Read the dictionary tables
+    vector<SnapshotText> dictionaryTexts[SNAPSHOT_DICTIONARIES];
+    const char* entry = data + header.dictionaryOffset;
+    for (size_t d = 0; d < SNAPSHOT_DICTIONARIES; ++d) {
+        dictionaryTexts[d].resize(header.dictionarySizes[d]);
+        for (size_t i = 0; i < dictionaryTexts[d].size(); ++i, entry += sizeof(SnapshotText)) {
+            memcpy(&dictionaryTexts[d][i], entry, sizeof(SnapshotText));
+            if (!inHeap(dictionaryTexts[d][i])) {
+                error = "Snapshot file is damaged: " + fileName;
+                return false;
+            }
+        }
+    }
+
+    // Check every record and build the employees with views into the mapped
+    // heap and the snapshot's own category ids; both are fixed up below
+    shared_ptr<EmployeeStore> loaded = make_shared<EmployeeStore>();
+    vector<Employee> employees(header.recordCount, Employee(loaded));
+    vector<pair<uint32_t, uint32_t> > skillRuns(header.recordCount);
+    const char* records = data + header.recordOffset;
+    for (size_t i = 0; i < employees.size(); ++i) {
+        SnapshotRecord record;
+        memcpy(&record, records + i * sizeof(SnapshotRecord), sizeof(record));
+        bool valid = inHeap(record.employeeId) && inHeap(record.fullName) &&
+                     record.departmentId < header.dictionarySizes[0] && record.titleId < header.dictionarySizes[1] &&
+                     record.managerKey < header.dictionarySizes[2] && record.firstSkill <= header.skillEntryCount &&
+                     record.skillCount <= header.skillEntryCount - record.firstSkill;
+        Employee& employee = employees[i];
+        employee.employeeId = StringView(heap + record.employeeId.offset, record.employeeId.length);
+        employee.fullName = StringView(heap + record.fullName.offset, record.fullName.length);
+        employee.departmentId = record.departmentId;
+        employee.titleId = record.titleId;
+        employee.managerKey = record.managerKey;
+        skillRuns[i] = make_pair(record.firstSkill, record.skillCount);
+
+        // The tree is built straight from the records, so they must be in strictly ascending ID order
+        if (!valid || (i > 0 && !(employees[i - 1].employeeId < employee.employeeId))) {
+            error = "Snapshot file is damaged: " + fileName;
+            return false;
+        }
+    }
+    const char* skillTable = data + header.skillOffset;
+    for (uint64_t k = 0; k < header.skillEntryCount; ++k) {
+        uint16_t skillId;
+        memcpy(&skillId, skillTable + k * sizeof(uint16_t), sizeof(skillId));
+        if (skillId >= header.dictionarySizes[SNAPSHOT_DICTIONARIES - 1]) {
+            error = "Snapshot file is damaged: " + fileName;
+            return false;
+        }
+    }
+
+    // Map the snapshot's category ids to the new store's dictionary ids
+    vector<uint32_t> idMap[SNAPSHOT_DICTIONARIES];
+    for (size_t d = 0; d < SNAPSHOT_DICTIONARIES; ++d) {
+        StringDictionary& dictionary = snapshotDictionary(*loaded, d);
+        idMap[d].resize(dictionaryTexts[d].size());
+        for (size_t i = 0; i < idMap[d].size(); ++i) {
+            StringView value(heap + dictionaryTexts[d][i].offset, dictionaryTexts[d][i].length);
+            idMap[d][i] = d == 2 ? dictionary.intern(normalizeManagerId(value)) : dictionary.intern(value);
+        }
+    }
+    for (size_t i = 0; i < idMap[SNAPSHOT_DICTIONARIES - 1].size(); ++i) {
+        if (idMap[SNAPSHOT_DICTIONARIES - 1][i] > 0xFFFF) {
+            error = "Too many distinct skills to load snapshot: " + fileName;
+            return false;
+        }
+    }
+
+    // One copy of the heap, then every view is moved from the mapping onto the copy
+    const char* text = loaded->text.store(heap, header.heapSize).data();
+    auto rebase = [heap, text](const StringView& view) {
+        return view.empty() ? StringView() : StringView(text + (view.data() - heap), view.size());
+    };
+    for (size_t i = 0; i < employees.size(); ++i) {
+        Employee& employee = employees[i];
+        employee.employeeId = rebase(employee.employeeId);
+        employee.fullName = rebase(employee.fullName);
+        employee.departmentId = idMap[0][employee.departmentId];
+        employee.titleId = idMap[1][employee.titleId];
+        employee.managerKey = idMap[2][employee.managerKey];
+        for (uint32_t k = 0; k < skillRuns[i].second; ++k) {
+            uint16_t skillId;
+            memcpy(&skillId, skillTable + (skillRuns[i].first + k) * sizeof(uint16_t), sizeof(skillId));
+            employee.skills.add(static_cast<uint16_t>(idMap[SNAPSHOT_DICTIONARIES - 1][skillId]));
+        }
+    }
+
+    file.close();
+    store = loaded;
+    bulkLoad(employees);
+    generation = header.generation;
+    return true;
+}
+
+/*
+ * An employee read in place from a snapshot file: every field is a view
+ * into the mapping, valid while the index that returned it stays open
+ */
+struct MappedEmployee {
+    StringView employeeId;
+    StringView fullName;
+    StringView department;
+    StringView title;
+    StringView managerId;
+    const char* skillIds;    // skillCount 16-bit ids into the skill dictionary
+    uint32_t skillCount;
+
+    MappedEmployee() : skillIds(nullptr), skillCount(0) {}
+};
+
+/*
+ * Read-only employee lookups served straight from a snapshot file. Opening
+ * maps the file and checks its header, so it costs the same for ten
+ * employees as for ten million; nothing is parsed, interned or copied.
+ * Lookups walk the Eytzinger key array and read one record, and only the
+ * pages they touch are faulted in. The mapping is shared, so processes
+ * that open the same snapshot share one copy of it in the page cache.
+ *
+ * Each record and string a lookup reads is bounds-checked on the way, so
+ * a damaged file makes lookups fail rather than read outside the mapping.
+ */
+class MappedEmployeeIndex {
+
+private:
+    MappedFile file;
+    SnapshotHeader header;
+    const char* heap;
+    const char* dictionaryTables[SNAPSHOT_DICTIONARIES];
+
+    bool readText(const SnapshotText& text, StringView& view) const;
+    bool readDictionaryValue(size_t dictionary, uint32_t id, StringView& value) const;
+
+public:
+    MappedEmployeeIndex() : heap(nullptr) {}
+    MappedEmployeeIndex(const MappedEmployeeIndex&) = delete;
+    MappedEmployeeIndex& operator=(const MappedEmployeeIndex&) = delete;
+
+    bool open(const string& fileName, string& error);
+    uint64_t size() const { return header.recordCount; }
+    bool find(const StringView& employeeId, MappedEmployee& employee) const;
+    StringView skill(const MappedEmployee& employee, uint32_t i) const;
+};
+
+/**
+ * Map a snapshot file for lookups
+ *
+ * @param fileName The snapshot file to open
+ * @param error Receives the reason on failure
+ * @return True if the file is a usable snapshot
+ */
+bool MappedEmployeeIndex::open(const string& fileName, string& error) {
+    file.close();
+    heap = nullptr;
+    if (!file.open(fileName, error)) {
+        return false;
+    }
+    if (!readSnapshotHeader(file, fileName, header, error)) {
+        file.close();
+        return false;
+    }
+    if (header.keyOffset % alignof(SnapshotKey) != 0) {
+        error = "Snapshot file is damaged: " + fileName;
+        file.close();
+        return false;
+    }
+    file.adviseRandomAccess();
+
+    heap = file.data() + header.heapOffset;
+    const char* table = file.data() + header.dictionaryOffset;
+    for (size_t d = 0; d < SNAPSHOT_DICTIONARIES; ++d) {
+        dictionaryTables[d] = table;
+        table += header.dictionarySizes[d] * sizeof(SnapshotText);
+    }
+    return true;
+}
+
+/**
+ * Helper function that turns a heap offset/length pair into a view
+ *
+ * @param text The pair
+ * @param view Receives the view
+ * @return False if the pair points outside the heap
+ */
+bool MappedEmployeeIndex::readText(const SnapshotText& text, StringView& view) const {
+    if (text.offset > header.heapSize || text.length > header.heapSize - text.offset) {
+        return false;
+    }
+    view = StringView(heap + text.offset, text.length);
+    return true;
+}
+
+/**
+ * Helper function that reads one value from a snapshot dictionary
+ *
+ * @param dictionary Which dictionary (department, title, manager, skill)
+ * @param id The value's id in the snapshot
+ * @param value Receives the value
+ * @return False if the id or its text is out of range
+ */
+bool MappedEmployeeIndex::readDictionaryValue(size_t dictionary, uint32_t id, StringView& value) const {
+    if (id >= header.dictionarySizes[dictionary]) {
+        return false;
+    }
+    SnapshotText text;
+    memcpy(&text, dictionaryTables[dictionary] + id * sizeof(SnapshotText), sizeof(text));
+    return readText(text, value);
+}
+
+/**
+ * Find an employee by ID. The key array is searched by ID prefix with a
+ * branch-free descent: at entry k go to 2k, or 2k + 1 if the key is
+ * smaller than the target. A key whose prefix ties with the target's is
+ * ordered by its record's full ID instead, so IDs sharing a long prefix
+ * cost one record read per tie rather than a walk over all of them. Past
+ * the bottom, the trailing one bits of k count the final right turns;
+ * dropping them and one more bit lands on the first key not smaller than
+ * the target, the only record that can match.
+ *
+ * @param employeeId The ID to look for
+ * @param employee Receives views of the employee's fields
+ * @return True if the employee was found and its record is intact
+ */
+bool MappedEmployeeIndex::find(const StringView& employeeId, MappedEmployee& employee) const {
+    if (heap == nullptr || header.recordCount == 0) {
+        return false;
+    }
+    const SnapshotKey* keys = reinterpret_cast<const SnapshotKey*>(file.data() + header.keyOffset);
+    const char* records = file.data() + header.recordOffset;
+    auto readRecord = [&](uint32_t r, SnapshotRecord& record, StringView& id) {
+        if (r >= header.recordCount) {
+            return false;
+        }
+        memcpy(&record, records + static_cast<uint64_t>(r) * sizeof(SnapshotRecord), sizeof(record));
+        return readText(record.employeeId, id);
+    };
+
+    SnapshotKey target = makeSnapshotKey(employeeId, 0);
+    SnapshotRecord record;
+    StringView id;
+    uint64_t k = 1;
+    while (k <= header.recordCount) {
+#if defined(__GNUC__)
+        // The keys two levels down are 4k..4k+3: one cache line
+        __builtin_prefetch(keys + 4 * k);
+#endif
+        int order = memcmp(keys[k].prefix, target.prefix, SNAPSHOT_KEY_PREFIX);
+        if (order == 0) {
+            if (!readRecord(keys[k].record, record, id)) {
+                return false;
+            }
+            order = id.compare(employeeId.data(), employeeId.size());
+        }
+        k = 2 * k + (order < 0);
+    }
+    k >>= countTrailingZeros64(~k) + 1;
+    if (k == 0) {
+        return false;  // Every ID is smaller
+    }
+
+    if (!readRecord(keys[k].record, record, id) || id != employeeId) {
+        return false;
+    }
+    if (!readText(record.fullName, employee.fullName) ||
+        !readDictionaryValue(0, record.departmentId, employee.department) ||
+        !readDictionaryValue(1, record.titleId, employee.title) ||
+        !readDictionaryValue(2, record.managerKey, employee.managerId) ||
+        record.firstSkill > header.skillEntryCount || record.skillCount > header.skillEntryCount - record.firstSkill) {
+        return false;
+    }
+    employee.employeeId = id;
+    employee.skillIds = file.data() + header.skillOffset + record.firstSkill * sizeof(uint16_t);
+    employee.skillCount = record.skillCount;
+    return true;
+}
+
+/**
+ * Get one of a mapped employee's skills
+ *
+ * @param employee An employee returned by find()
+ * @param i Index of the skill, below employee.skillCount
+ * @return The skill, or an empty view if its id is out of range
+ */
+StringView MappedEmployeeIndex::skill(const MappedEmployee& employee, uint32_t i) const {
+    uint16_t skillId;
+    memcpy(&skillId, employee.skillIds + i * sizeof(uint16_t), sizeof(skillId));
+    StringView value;
+    readDictionaryValue(SNAPSHOT_DICTIONARIES - 1, skillId, value);
+    return value;
+}
+
+//============================================================================
+// Write-ahead log
+//============================================================================
+
+/*
+ * Every change made after a load is appended to a log file before it is
+ * applied, so a restart rebuilds the same tree from the last snapshot plus
+ * the log. A checkpoint saves a new snapshot and empties the log, which
+ * keeps replay short. The log starts with a WalHeader; each record is a
+ * WalRecordHeader (payload length and CRC-32 of the length and payload)
+ * followed by the payload: a WalRecordType byte, then the fields as
+ * 32-bit lengths and bytes. A put carries the whole employee and a removal
+ * only the ID, so replaying a record that is already in the snapshot
+ * leaves the same result.
+ *
+ * Each checkpoint gets the next generation number, written into the
+ * snapshot header and then into the emptied log's header. A crash between
+ * the two leaves a log from the previous generation next to the new
+ * snapshot; its records were made against older data, possibly a
+ * different file, so it is not replayed.
+ *
+ * A crash can leave the last record half written. Replay stops at the
+ * first record that is cut short or fails its checksum, and opening the
+ * log for writing cuts that tail off.
+ */
+const char WAL_MAGIC[8] = { 'E', 'M', 'P', 'W', 'A', 'L', '\0', '\0' };
+const uint32_t WAL_VERSION = 2;
+
+struct WalHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;   // SNAPSHOT_BYTE_ORDER as written by the writer
+    uint64_t generation;  // Generation of the snapshot the records apply to
+};
+
+struct WalRecordHeader {
+    uint32_t length;      // Payload bytes
+    uint32_t checksum;    // CRC-32 of the length field and the payload
+};
+
+enum class WalRecordType : uint8_t {
+    PUT = 1,     // Add the employee, or replace the one with the same ID
+    REMOVE = 2
+};
+
+/**
+ * CRC-32 with the polynomial used by zlib and PNG
+ *
+ * @param data The bytes to check
+ * @param size Number of bytes
+ * @param crc The CRC of the bytes before these, to continue a running check
+ * @return The CRC of everything so far
+ */
+uint32_t computeCrc32(const char* data, size_t size, uint32_t crc = 0) {
+    static const vector<uint32_t> table = []() {
+        vector<uint32_t> entries(256);
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = (value & 1) != 0 ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            }
+            entries[i] = value;
+        }
+        return entries;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/**
+ * Check that a file starts with a log header written on this kind of machine
+ *
+ * @param data The file's bytes
+ * @param size Number of bytes
+ * @param fileName The file's name, for messages
+ * @param header Receives the header
+ * @param error Receives the reason on failure
+ * @return True if the header is usable
+ */
+bool readWalHeader(const char* data, size_t size, const string& fileName, WalHeader& header, string& error) {
+    if (size < sizeof(header)) {
+        error = "Not a change log file: " + fileName;
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, WAL_MAGIC, sizeof(header.magic)) != 0) {
+        error = "Not a change log file: " + fileName;
+        return false;
+    }
+    if (header.byteOrder != SNAPSHOT_BYTE_ORDER) {
+        error = "Change log was written on a machine with a different byte order: " + fileName;
+        return false;
+    }
+    if (header.version != WAL_VERSION) {
+        error = "Unsupported change log version " + to_string(header.version) + ": " + fileName;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Visit the intact records of a log in order, stopping at the first one
+ * that is cut short or fails its checksum
+ *
+ * @param data The file's bytes, starting with a valid header
+ * @param size Number of bytes
+ * @param visit Called with (payload, length) for each record
+ * @return Bytes from the start of the file to the end of the last intact record
+ */
+template <typename Visitor>
+size_t scanWalRecords(const char* data, size_t size, Visitor visit) {
+    size_t offset = sizeof(WalHeader);
+    while (size - offset >= sizeof(WalRecordHeader)) {
+        WalRecordHeader record;
+        memcpy(&record, data + offset, sizeof(record));
+        const char* payload = data + offset + sizeof(record);
+        if (record.length == 0 || record.length > size - offset - sizeof(record) ||
+            computeCrc32(payload, record.length, computeCrc32(data + offset, sizeof(record.length))) != record.checksum) {
+            break;
+        }
+        visit(payload, record.length);
+        offset += sizeof(record) + record.length;
+    }
+    return offset;
+}
+
+/**
+ * Helper function that appends a length-prefixed string to a log payload
+ *
+ * @param payload The payload being built
+ * @param text The string
+ */
+void appendWalText(string& payload, const StringView& text) {
+    uint32_t length = static_cast<uint32_t>(text.size());
+    payload.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    payload.append(text.data(), text.size());
+}
+
+/**
+ * Helper function that reads a length-prefixed string from a log payload
+ *
+ * @param cursor Read position; moved past the string
+ * @param end End of the payload
+ * @param text Receives a view of the string
+ * @return False if the payload ends first
+ */
+bool readWalText(const char*& cursor, const char* end, StringView& text) {
+    uint32_t length;
+    if (static_cast<size_t>(end - cursor) < sizeof(length)) {
+        return false;
+    }
+    memcpy(&length, cursor, sizeof(length));
+    cursor += sizeof(length);
+    if (length > static_cast<size_t>(end - cursor)) {
+        return false;
+    }
+    text = StringView(cursor, length);
+    cursor += length;
+    return true;
+}
+
+/**
+ * Apply one log record to the tree
+ *
+ * @param payload The record's payload
+ * @param length Payload bytes
+ * @param tree The tree to change
+ * @return False if the payload is not a known record
+ */
+bool applyWalRecord(const char* payload, uint32_t length, BinarySearchTree& tree) {
+    const char* cursor = payload + 1;
+    const char* end = payload + length;
+    StringView employeeId;
+    if (!readWalText(cursor, end, employeeId)) {
+        return false;
+    }
+
+    switch (static_cast<WalRecordType>(payload[0])) {
+    case WalRecordType::REMOVE:
+        tree.removeEmployee(employeeId.str());
+        return true;
+    case WalRecordType::PUT: {
+        StringView fullName, department, title, managerId;
+        uint32_t skillCount;
+        if (!readWalText(cursor, end, fullName) || !readWalText(cursor, end, department) ||
+            !readWalText(cursor, end, title) || !readWalText(cursor, end, managerId) ||
+            static_cast<size_t>(end - cursor) < sizeof(skillCount)) {
+            return false;
+        }
+        memcpy(&skillCount, cursor, sizeof(skillCount));
+        cursor += sizeof(skillCount);
+
+        Employee employee(tree.employeeStore());
+        employee.setEmployeeId(employeeId);
+        employee.setFullName(fullName);
+        employee.setDepartment(department);
+        employee.setTitle(title);
+        employee.setManagerId(managerId);
+        for (uint32_t i = 0; i < skillCount; ++i) {
+            StringView skill;
+            if (!readWalText(cursor, end, skill)) {
+                return false;
+            }
+            employee.addSkill(skill);
+        }
+        if (!tree.updateEmployee(employee)) {
+            tree.addEmployee(employee);
+        }
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+// Outcome of replaying a change log
+enum class ReplayResult {
+    REPLAYED,    // Every intact record was applied; a missing log holds none
+    STALE,       // The log belongs to another checkpoint and was not replayed
+    UNREADABLE   // The file is not a usable log
+};
+
+/**
+ * Replay a log file on top of the tree
+ *
+ * @param fileName The log file; a missing file holds no records
+ * @param generation Generation of the snapshot the tree was loaded from
+ * @param tree The tree to change, normally just loaded from a snapshot
+ * @param applied Receives the number of records replayed
+ * @param error Receives the reason when the log is unreadable
+ * @return Whether the records were replayed, skipped or unreadable
+ */
+ReplayResult replayWriteAheadLog(const string& fileName, uint64_t generation, BinarySearchTree& tree, size_t& applied,
+                                 string& error) {
+    applied = 0;
+    MappedFile file;
+    string ignored;
+    if (!file.open(fileName, ignored) || file.size() == 0) {
+        return ReplayResult::REPLAYED;
+    }
+    WalHeader header;
+    if (!readWalHeader(file.data(), file.size(), fileName, header, error)) {
+        return ReplayResult::UNREADABLE;
+    }
+    if (header.generation != generation) {
+        return ReplayResult::STALE;
+    }
+    scanWalRecords(file.data(), file.size(), [&](const char* payload, uint32_t length) {
+        if (applyWalRecord(payload, length, tree)) {
+            applied++;
+        }
+    });
+    return ReplayResult::REPLAYED;
+}
+
+/**
+ * Count the changes a log holds for a snapshot, without applying them
+ *
+ * @param fileName The log file
+ * @param generation Generation of the snapshot
+ * @return Number of intact records; 0 if the log is missing, unreadable
+ *         or belongs to another checkpoint
+ */
+size_t countWalRecords(const string& fileName, uint64_t generation) {
+    MappedFile file;
+    string error;
+    WalHeader header;
+    if (!file.open(fileName, error) || !readWalHeader(file.data(), file.size(), fileName, header, error) ||
+        header.generation != generation) {
+        return 0;
+    }
+    size_t count = 0;
+    scanWalRecords(file.data(), file.size(), [&count](const char*, uint32_t) { count++; });
+    return count;
+}
+
+// Counters since a log was opened
+struct WalStats {
+    uint64_t records;         // Records written to disk
+    uint64_t syncs;           // Flushes to disk, each covering a batch of records
+    uint64_t discardedBytes;  // Torn or damaged tail cut off when the log was opened
+
+    WalStats() : records(0), syncs(0), discardedBytes(0) {}
+};
+
+/*
+ * Append-only change log with group commit. Appending encodes a record
+ * into a shared buffer and returns its sequence number; a flusher thread
+ * writes whatever has accumulated and flushes it to disk in one go. While
+ * one flush is in progress, records from other callers pile up behind it
+ * and share the next one, so many concurrent commits cost a few flushes
+ * instead of one each. waitDurable() blocks until a record is on disk; a
+ * caller making many changes appends them all and waits once.
+ */
+class WriteAheadLog {
+
+private:
+    FILE* file;
+    mutex lock;
+    condition_variable workReady;     // Records are pending, or the flusher should stop
+    condition_variable batchFlushed;  // A batch reached the disk
+    string pending;                   // Records appended but not yet written
+    uint64_t appendedCount;           // Records appended since opening
+    uint64_t durableCount;            // Of those, records on disk
+    size_t fileRecords;               // Records in the file since the last reset
+    uint64_t generation;              // Snapshot generation in the file's header
+    bool stopping;
+    bool failed;                      // A write or flush failed; nothing more is durable
+    WalStats stats;
+    thread flusher;
+
+    uint64_t append(const string& payload);
+    void flushBatches();
+    bool writeHeader();
+
+public:
+    WriteAheadLog();
+    ~WriteAheadLog() { close(); }
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    bool open(const string& fileName, uint64_t snapshotGeneration, string& error);
+    void close();
+    bool isOpen() const { return file != nullptr; }
+    uint64_t appendPut(const Employee& employee);
+    uint64_t appendRemove(const string& employeeId);
+    bool waitDurable(uint64_t sequence);
+    bool reset(uint64_t snapshotGeneration, string& error);
+    size_t recordCount();
+    WalStats getStats();
+};
+
+/**
+ * Default constructor; the log starts closed
+ */
+WriteAheadLog::WriteAheadLog()
+    : file(nullptr), appendedCount(0), durableCount(0), fileRecords(0), generation(0), stopping(false), failed(false) {}
+
+/**
+ * Open a log for appending, creating it if needed. A torn or damaged tail
+ * left by a crash is cut off first, so new records follow the last intact
+ * one. A log from another snapshot generation is emptied.
+ *
+ * @param fileName The log file
+ * @param snapshotGeneration Generation of the snapshot new records apply to
+ * @param error Receives the reason on failure
+ * @return True if the log is ready for records
+ */
+bool WriteAheadLog::open(const string& fileName, uint64_t snapshotGeneration, string& error) {
+    close();
+    stats = WalStats();
+    fileRecords = 0;
+    generation = snapshotGeneration;
+
+    size_t validBytes = 0;
+    size_t fileBytes = 0;
+    {
+        MappedFile existing;
+        string ignored;
+        if (existing.open(fileName, ignored) && existing.size() > 0) {
+            WalHeader header;
+            if (!readWalHeader(existing.data(), existing.size(), fileName, header, error)) {
+                return false;
+            }
+            fileBytes = existing.size();
+            if (header.generation == snapshotGeneration) {
+                validBytes = scanWalRecords(existing.data(), existing.size(), [this](const char*, uint32_t) {
+                    fileRecords++;
+                });
+            }
+        }
+    }
+
+    file = fopen(fileName.c_str(), "ab");
+    if (file == nullptr) {
+        error = "Could not open file: " + fileName;
+        return false;
+    }
+    bool ready = true;
+    if (validBytes == 0) {
+        // New, or left over from another generation: start over with this generation's header
+        ready = writeHeader();
+        syncParentDirectory(fileName);
+    }
+    else if (validBytes < fileBytes) {
+        stats.discardedBytes = fileBytes - validBytes;
+        ready = truncateOpenFile(file, validBytes) && flushFileToDisk(file);
+    }
+    if (!ready) {
+        error = "Could not write file: " + fileName;
+        fclose(file);
+        file = nullptr;
+        return false;
+    }
+
+    appendedCount = 0;
+    durableCount = 0;
+    stopping = false;
+    failed = false;
+    flusher = thread([this]() { flushBatches(); });
+    return true;
+}
+
+/**
+ * Write every pending record, stop the flusher and close the file
+ */
+void WriteAheadLog::close() {
+    if (file == nullptr) {
+        return;
+    }
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    workReady.notify_one();
+    flusher.join();
+    fclose(file);
+    file = nullptr;
+}
+
+/**
+ * Helper function that empties the file and writes a header for the
+ * current generation, flushed to disk
+ *
+ * @return True if the header is on disk
+ */
+bool WriteAheadLog::writeHeader() {
+    WalHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, WAL_MAGIC, sizeof(header.magic));
+    header.version = WAL_VERSION;
+    header.byteOrder = SNAPSHOT_BYTE_ORDER;
+    header.generation = generation;
+    return truncateOpenFile(file, 0) && fwrite(&header, sizeof(header), 1, file) == 1 && flushFileToDisk(file);
+}
+
+/**
+ * Body of the flusher thread: take everything appended so far, write it
+ * and flush it to disk as one batch, then wake the callers waiting on it
+ */
+void WriteAheadLog::flushBatches() {
+    unique_lock<mutex> guard(lock);
+    while (true) {
+        workReady.wait(guard, [this]() { return stopping || !pending.empty(); });
+        if (pending.empty()) {
+            return;  // Stopping, and everything is written
+        }
+
+        string batch;
+        batch.swap(pending);
+        uint64_t batchEnd = appendedCount;
+        guard.unlock();
+        bool written = fwrite(batch.data(), 1, batch.size(), file) == batch.size() && flushFileToDisk(file);
+        guard.lock();
+
+        failed = failed || !written;
+        if (!failed) {
+            stats.records += batchEnd - durableCount;
+            stats.syncs++;
+        }
+        durableCount = batchEnd;
+        batchFlushed.notify_all();
+    }
+}
+
+/**
+ * Helper function that frames a payload as a record and queues it for the flusher
+ *
+ * @param payload The encoded change
+ * @return Sequence number of the record, for waitDurable()
+ */
+uint64_t WriteAheadLog::append(const string& payload) {
+    WalRecordHeader record;
+    record.length = static_cast<uint32_t>(payload.size());
+    record.checksum = computeCrc32(payload.data(), payload.size(),
+                                   computeCrc32(reinterpret_cast<const char*>(&record.length), sizeof(record.length)));
+
+    uint64_t sequence;
+    {
+        lock_guard<mutex> guard(lock);
+        pending.append(reinterpret_cast<const char*>(&record), sizeof(record));
+        pending.append(payload);
+        sequence = ++appendedCount;
+        fileRecords++;
+    }
+    workReady.notify_one();
+    return sequence;
+}
+
+/**
+ * Log that an employee was added or changed
+ *
+ * @param employee The employee as it now is
+ * @return Sequence number of the record, for waitDurable()
+ */
+uint64_t WriteAheadLog::appendPut(const Employee& employee) {
+    string payload(1, static_cast<char>(WalRecordType::PUT));
+    appendWalText(payload, employee.employeeId);
+    appendWalText(payload, employee.fullName);
+    appendWalText(payload, StringView(employee.department()));
+    appendWalText(payload, StringView(employee.title()));
+    appendWalText(payload, StringView(employee.managerId()));
+    uint32_t skillCount = static_cast<uint32_t>(employee.skillCount());
+    payload.append(reinterpret_cast<const char*>(&skillCount), sizeof(skillCount));
+    for (size_t i = 0; i < employee.skillCount(); ++i) {
+        appendWalText(payload, StringView(employee.skill(i)));
+    }
+    return append(payload);
+}
+
+/**
+ * Log that an employee was removed
+ *
+ * @param employeeId The removed employee's ID
+ * @return Sequence number of the record, for waitDurable()
+ */
+uint64_t WriteAheadLog::appendRemove(const string& employeeId) {
+    string payload(1, static_cast<char>(WalRecordType::REMOVE));
+    appendWalText(payload, StringView(employeeId));
+    return append(payload);
+}
+
+/**
+ * Wait until a record, and every record before it, is on disk
+ *
+ * @param sequence The record's sequence number
+ * @return False if writing the log failed
+ */
+bool WriteAheadLog::waitDurable(uint64_t sequence) {
+    unique_lock<mutex> guard(lock);
+    batchFlushed.wait(guard, [this, sequence]() { return durableCount >= sequence; });
+    return !failed;
+}
+
+/**
+ * Empty the log once its records are in a snapshot
+ *
+ * @param snapshotGeneration Generation of that snapshot, which new records apply to
+ * @param error Receives the reason on failure
+ * @return True if the log is empty on disk
+ */
+bool WriteAheadLog::reset(uint64_t snapshotGeneration, string& error) {
+    unique_lock<mutex> guard(lock);
+    batchFlushed.wait(guard, [this]() { return durableCount >= appendedCount; });
+    generation = snapshotGeneration;
+    if (failed || !writeHeader()) {
+        failed = true;
+        error = "Could not empty the change log";
+        return false;
+    }
+    fileRecords = 0;
+    return true;
+}
+
+/**
+ * Number of records in the log since it was last emptied
+ */
+size_t WriteAheadLog::recordCount() {
+    lock_guard<mutex> guard(lock);
+    return fileRecords;
+}
+
+/**
+ * Get the write and flush counters
+ */
+WalStats WriteAheadLog::getStats() {
+    lock_guard<mutex> guard(lock);
+    return stats;
+}
+
+// The change log of a session and how often it is checkpointed
+struct Persistence {
+    bool enabled;              // Whether changes are logged at all
+    WriteAheadLog log;         // Open once the loaded data has a checkpoint to replay onto
+    size_t checkpointRecords;  // Checkpoint once the log holds this many records (0 for only when saving)
+    uint64_t generation;       // Generation of the last snapshot saved or loaded
+
+    Persistence() : enabled(false), checkpointRecords(0), generation(0) {}
+};
+
+//============================================================================
+// Main program functions
+//============================================================================
+
+/**
+ * Display the main menu options to the user
+ */
+void displayMenu() {
+    cout << "Welcome to the Employee Management System.\n" << endl;
+    cout << "1. Load Employee Data (also saves the .snap snapshot and starts the .wal change log)." << endl;
+    cout << "2. Print Employee Directory." << endl;
+    cout << "3. Search for Employee." << endl;
+    cout << "4. Show Lookup Statistics." << endl;
+    cout << "5. List Employees by Department." << endl;
+    cout << "6. Show Headcount by Department." << endl;
+    cout << "7. List Direct Reports." << endl;
+    cout << "8. List Full Organization Under a Manager." << endl;
+    cout << "10. Search by Skills." << endl;
+    cout << "11. Search by Name." << endl;
+    cout << "12. Search by Misspelled Name." << endl;
+    cout << "13. Filter Employees." << endl;
+    cout << "14. Check Reporting Chain." << endl;
+    cout << "15. Show Organization Summary." << endl;
+    cout << "16. Validate Reporting Structure." << endl;
+    cout << "17. Save Snapshot (.snap file; empties the .wal change log)." << endl;
+    cout << "18. Load Snapshot (.snap file, then replays the .wal change log)." << endl;
+    cout << "19. Reload Changed Employee Data." << endl;
+    cout << "20. Add Employee." << endl;
+    cout << "21. Update Employee." << endl;
+    cout << "22. Remove Employee." << endl;
+    cout << "    (Changes from 19-22 are written to the .wal change log before they are applied.)" << endl;
+    cout << "9. Exit.\n" << endl;
+    cout << "What would you like to do?" << endl;
+}
+
+/**
+ * Enhanced user choice input with better validation
+ *
+ * @return Valid menu choice (1, 2, 3, or 9)
+ */
+int getUserChoice() {
+    int choice;
+    string input;
+
+    while (true) {
+        try {
+            getline(cin, input);
+
+            // Check for empty input
+            if (input.empty()) {
+                cout << "Please enter a choice: ";
+                continue;
+            }
+
+            // Try to convert to integer
+            choice = stoi(input);
+
+            // Validate range (accept any integer, let processMenuChoice handle invalid options)
+            cout << endl;
+            return choice;
+
+        }
+        catch (const invalid_argument&) {
+            cout << "Invalid input. Please enter a number: ";
+        }
+        catch (const out_of_range&) {
+            cout << "Number too large. Please enter a valid choice: ";
+        }
+    }
+}
+
+/**
+ * Load employee data from CSV file
+ *
+ * @param tree Reference to the tree to populate
+ * @param fileName Name of the CSV file to load
+ * @param strategy How to read the file into the tree
+ * @return True if loading was successful, false otherwise
+ */
+bool loadEmployeeData(BinarySearchTree& tree, const string& fileName, LoadStrategy strategy) {
+    cout << "Attempting to load file: " << fileName << endl;
+
+    if (!createEmployee(fileName, tree, strategy, max(1u, thread::hardware_concurrency()))) {
+        cout << "Unable to open file." << endl;
+        return false;
+    }
+
+    cout << "Employee data successfully loaded!" << endl;
+
+    // The file's fields are checked line by line; the reporting structure only makes sense as a whole
+    const size_t shownPerKind = 10;
+    ValidationIssues issues = tree.validateReportingStructure(max(1u, thread::hardware_concurrency()));
+    printValidationIssues(issues, shownPerKind);
+    return true;
+}
+
+/**
+ * Print one kind of change from a delta reload
+ *
+ * @param label What happened to the employees
+ * @param employeeIds Their IDs, in ID order
+ * @param limit Maximum number of IDs to print
+ */
+void printReloadChanges(const string& label, const vector<string>& employeeIds, size_t limit) {
+    if (employeeIds.empty()) {
+        return;
+    }
+    cout << label << " (" << employeeIds.size() << "): ";
+    for (size_t i = 0; i < employeeIds.size() && i < limit; ++i) {
+        cout << (i > 0 ? ", " : "") << employeeIds[i];
+    }
+    if (employeeIds.size() > limit) {
+        cout << " ... and " << employeeIds.size() - limit << " more";
+    }
+    cout << endl;
+}
+
+/**
+ * Helper function that lists the IDs of changed employees
+ *
+ * @param employees The employees
+ * @return Their IDs, in the same order
+ */
+vector<string> employeeIdsOf(const vector<Employee>& employees) {
+    vector<string> employeeIds;
+    employeeIds.reserve(employees.size());
+    for (size_t i = 0; i < employees.size(); ++i) {
+        employeeIds.push_back(employees[i].employeeId.str());
+    }
+    return employeeIds;
+}
+
+/**
+ * Re-read the CSV file and apply only what changed since the last load.
+ * The changes are logged and on disk before any of them is applied.
+ *
+ * @param tree The tree containing employee data
+ * @param dataLoaded Whether data has been loaded
+ * @param fileName Name of the CSV file to reload
+ * @param persistence The session's change log
+ */
+void reloadEmployeeData(BinarySearchTree& tree, bool dataLoaded, const string& fileName, Persistence& persistence) {
+    if (!dataLoaded) {
+        cout << "Please load the employee data first." << endl;
+        return;
+    }
+
+    cout << "Attempting to reload file: " << fileName << endl;
+    ReloadSummary summary;
+    if (!diffEmployeeFile(fileName, tree, max(1u, thread::hardware_concurrency()), summary)) {
+        cout << "Unable to open file. Employee data was not changed." << endl;
+        return;
+    }
+
+    // One wait covers the whole batch of records
+    if (persistence.log.isOpen()) {
+        uint64_t sequence = 0;
+        for (size_t i = 0; i < summary.removed.size(); ++i) {
+            sequence = persistence.log.appendRemove(summary.removed[i]);
+        }
+        for (size_t i = 0; i < summary.updated.size(); ++i) {
+            sequence = persistence.log.appendPut(summary.updated[i]);
+        }
+        for (size_t i = 0; i < summary.added.size(); ++i) {
+            sequence = persistence.log.appendPut(summary.added[i]);
+        }
+        if (!commitLogRecord(persistence, sequence)) {
+            return;
+        }
+    }
+    applyEmployeeChanges(tree, summary);
+
+    const size_t shownPerKind = 10;
+    cout << "Reload complete: " << summary.added.size() << " added, " << summary.updated.size() << " updated, "
+         << summary.removed.size() << " removed, " << summary.unchanged << " unchanged" << endl;
+    printReloadChanges("Added", employeeIdsOf(summary.added), shownPerKind);
+    printReloadChanges("Updated", employeeIdsOf(summary.updated), shownPerKind);
+    printReloadChanges("Removed", summary.removed, shownPerKind);
+    cout << fixed << setprecision(3);
+    cout << "Compared in " << summary.compareSeconds << " s, applied in " << summary.applySeconds << " s" << endl;
+    cout.unsetf(ios::floatfield);
+    if (summary.reclaimedBytes > 0) {
+        cout << "Compacted employee text, reclaiming " << summary.reclaimedBytes << " bytes" << endl;
+    }
+    checkpointIfDue(tree, fileName, persistence);
+}
+
+/**
+ * Print the complete employee directory
+ *
+ * @param tree The tree containing employee data
+ * @param dataLoaded Whether data has been loaded
+ */
+void printEmployeeDirectory(BinarySearchTree& tree, bool dataLoaded) {
+    if (!dataLoaded) {
+        cout << "Please load the employee data first." << endl;
+        return;
+    }
+
+    cout << "Here is the employee directory:\n" << endl;
+    tree.printEmployeeList();
+}
+
+/**
+ * Search for and display a specific employee
+ *
+ * @param tree The tree containing employee data
+ * @param dataLoaded Whether data has been loaded
+ */
+void searchForEmployee(BinarySearchTree& tree, bool dataLoaded) {
+    if (!dataLoaded) {
+        cout << "Please load the employee data first." << endl;
+        return;
+    }
+
+    string employeeId;
+    cout << "Please enter the Employee ID you're looking for:" << endl;
+    cin >> employeeId;
+    cout << endl;
+
+    // Transform input to accept both upper and lowercase letters
+    transform(employeeId.begin(), employeeId.end(), employeeId.begin(), ::toupper);
+
+    Employee employee = tree.findEmployeeById(employeeId);
+
+    // Validate the employee was found
+    if (!employee.employeeId.empty()) {
+        cout << employeeId << " Information:" << endl;
+        tree.displayEmployee(employee);
+    }
+    else {
+        cout << "We're sorry. No employee matching the ID " << employeeId << " was found." << endl;
+    }
+}
+
+/**
+ * Print lookup cache counters for the current session
+ *
+ * @param tree The tree containing employee data
+ * @param dataLoaded Whether data has been loaded
+ */
+void printLookupStatistics(BinarySearchTree& tree, bool dataLoaded) {
+    if (!dataLoaded) {
+        cout << "Please load the employee data first." << endl;
+        return;
+    }
+
+    CacheStats stats = tree.getCacheStats();
+
+    cout << "Employees: " << tree.size() << endl;
+    cout << "Index: " << (tree.getIndexBackend() == IndexBackend::RADIX ? "Adaptive radix tree" : "AVL tree") << endl;
+    cout << "Lookup cache: " << stats.entries << " of " << stats.capacity << " records cached" << endl;
+    cout << "Cache hits: " << stats.hits << ", misses: " << stats.misses
+         << ", invalidations: " << stats.invalidations << endl;
+    cout << "Cache hit rate: " << fixed << setprecision(1) << stats.hitRate() * 100.0 << "%" << endl;
+
+    FilterStats filter = tree.getFilterStats();
+    if (filter.memoryBytes == 0) {
+        cout << "ID filter: disabled" << endl;
+    }
+    else {
+        cout << "ID filter: " << filter.memoryBytes << " bytes, " << filter.hashCount << " probes per ID" << endl;
+        cout << "Filter false-positive rate: " << setprecision(2) << filter.configuredRate * 100.0 << "% configured, "
+             << filter.estimatedRate * 100.0 << "% estimated, " << filter.observedRate() * 100.0 << "% observed" << endl;
+        cout << "Unknown IDs rejected by filter: " << filter.rejected
+             << ", passed to tree: " << filter.falsePositives << endl;
+    }
+
+    const EmployeeStore& store = *tree.employeeStore();
+    cout << "ID and name text: " << store.text.bytesUsed() << " bytes in " << store.text.blockCount()
+         << " arena block(s), " << tree.getDeadTextBytes() << " unused" << endl;
+    cout << "Distinct values: " << store.departments.size() - 1 << " departments, "
+         << store.titles.size() - 1 << " titles, " << store.managers.size() - 1 << " managers, "
+         << store.skills.size() - 1 << " skills" << endl;
+    cout.unsetf(ios::floatfield);
+}
+
+/**
+ * List every employee in a department chosen by the user
+ *
+ * @param tree The tree containing employee data
+ * @param dataLoaded Whether data has been loaded
+ */
+void listDepartment(BinarySearchTree& tree, bool dataLoaded) {
+    if (!dataLoaded) {
+        cout << "Please load the employee data first." << endl;
+        return;
+    }
+
+    string department;
+    cout << "Please enter the department name:" << endl;
+    getline(cin >> ws, department);
+    cout << endl;
+
+    if (!tree.printDepartmentList(department)) {
+        cout << "We're sorry. No employees were found in the department " << department << "." << endl;
+    }
+}
+
+/**
+ * Print the number of employees in each department
+ *
+ * @param tree The tree containing employee data
+ * @param dataLoaded Whether data has been loaded
+ */
+void printDepartmentHeadcounts(BinarySearchTree& tree, bool dataLoaded) {
+    if (!dataLoaded) {
+        cout << "Please load the employee data first." << endl;
+        return;
+    }
+
+    vector<pair<string, size_t> > headcounts = tree.getDepartmentHeadcounts();
+    cout << "Headcount by department:\n" << endl;
+    for (size_t i = 0; i < headcounts.size(); ++i) {
+        cout << headcounts[i].first << ": " << headcounts[i].second << endl;
+    }
+}
+
+/**
+ * Prompt for an employee ID and normalize it to upper case
+ *
+ * @param prompt The question shown to the user
+ * @return The entered ID in upper case
+ */
+string readEmployeeId(const string& prompt) {
+    string employeeId;
+    cout << prompt << endl;
+    cin >> employeeId;
+    cout << endl;
+
+    // Transform input to accept both upper and lowercase letters
+    transform(employeeId.begin(), employeeId.end(), employeeId.begin(), ::toupper);
+    return employeeId;
+}
+
+/**
+ * List the employees reporting directly to a manager chosen by the user
+ *
+ * @param tree The tree containing employee data
+ * @param dataLoaded Whether data has been loaded
+ */
+void listDirectReports(BinarySearchTree& tree, bool dataLoaded) {
+    if (!dataLoaded) {
+        cout << "Please load the employee data first." << endl;
+        return;
+    }
+
+    string managerId = readEmployeeId("Please enter the manager's Employee ID:");
+    cout << "Direct reports of " << managerId << ":" << endl;
+    size_t count = tree.printDirectReports(managerId);
+    if (count == 0) {
+        cout << "None." << endl;
+    }
+    else {
+        cout << "\n" << count << " direct report(s)." << endl;
+    }
+}
+
+/**
+ * List everyone under a manager chosen by the user, indented by level
+ *
+ * @param tree The tree containing employee data
+ * @param dataLoaded Whether data has been loaded
+ */
+void listOrganization(BinarySearchTree& tree, bool dataLoaded) {
+    if (!dataLoaded) {
+        cout << "Please load the employee data first." << endl;
+        return;
+    }
+
+    string managerId = readEmployeeId("Please enter the manager's Employee ID:");
+    if (tree.findEmployeeById(managerId).employeeId.empty()) {
+        cout << "We're sorry. No employee matching the ID " << managerId << " was found." << endl;
+        return;
+    }
+
+    cout << "Organization under " << managerId << ":" << endl;
+    size_t count = tree.printOrgSubtree(managerId);
+    if (count == 0) {
+        cout << "None." << endl;
+    }
+    else {
+        cout << "\n" << count << " employee(s) in total." << endl;
+    }
+}
+
+/**
+ * Find employees by a boolean combination of skills entered by the user
+ *
+ * @param tree The tree containing employee data
+ * @param dataLoaded Whether data has been loaded
+ */
+void searchBySkills(BinarySearchTree& tree, bool dataLoaded) {
+    if (!dataLoaded) {
+        cout << "Please load the employee data first." << endl;
+        return;
+    }
+
+    string text;
+    cout << "Please enter a skill query (e.g. C++ AND Python AND NOT Agile):" << endl;
+    getline(cin >> ws, text);
+    cout << endl;
+
+    SkillQuery query;
+    string error;
+    if (!parseSkillQuery(text, query, error)) {
+        cout << "Invalid skill query: " << error << endl;
+        return;
+    }
+
+    size_t count = tree.printSkillMatches(query);
+    if (count == 0) {
+        cout << "We're sorry. No employees match " << text << "." << endl;
+    }
+    else {
+        cout << "\n" << count << " matching employee(s)." << endl;
+    }
+}
+
+/**
+ * Print name search suggestions, one summary line each
+ *
+ * @param matches The employees to list
+ */
+void printNameMatches(const vector<Employee>& matches) {
+    for (size_t i = 0; i < matches.size(); ++i) {
+        cout << "  " << matches[i].employeeId << " - " << matches[i].fullName;
+        if (!matches[i].title().empty()) {
+            cout << ", " << matches[i].title();
+        }
+        cout << endl;
+    }
+}
+
+/**
+ * Search for employees by name, refreshing suggestions as the user types
+ *
+ * On a POSIX terminal the suggestions are redrawn after every keystroke and
+ * Enter shows the top match in full. Otherwise each entered line is taken as
+ * the new prefix and a blank line ends the search.
+ *
+ * @param tree The tree containing employee data
+ * @param dataLoaded Whether data has been loaded
+ */
+void searchByName(BinarySearchTree& tree, bool dataLoaded) {
+    const size_t suggestionCount = 10;
+
+    if (!dataLoaded) {
+        cout << "Please load the employee data first." << endl;
+        return;
+    }
+
+#if !defined(_WIN32)
+    termios original;
+    if (isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &original) == 0) {
+        termios raw = original;
+        raw.c_lflag &= ~(ICANON | ECHO);
+        raw.c_cc[VMIN] = 1;
+        raw.c_cc[VTIME] = 0;
+        tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+
+        cout << "Type a name (Enter to show the top match, Esc to cancel):" << endl;
+        string prefix;
+        vector<Employee> matches;
+        size_t drawnLines = 0;
+
+        while (true) {
+            // Redraw the prompt and suggestions in place
+            if (drawnLines > 0) {
+                cout << "\033[" << drawnLines << "A";
+            }
+            cout << "\r\033[J> " << prefix << endl;
+            matches = tree.findEmployeesByNamePrefix(prefix, suggestionCount);
+            printNameMatches(matches);
+            drawnLines = matches.size() + 1;
+            cout << flush;
+
+            char c;
+            if (read(STDIN_FILENO, &c, 1) != 1 || c == 27) {
+                matches.clear();
+                break;
+            }
+            if (c == '\n' || c == '\r') {
+                break;
+            }
+            if (c == 127 || c == 8) {
+                if (!prefix.empty()) {
+                    prefix.erase(prefix.size() - 1);
+                }
+            }
+            else if (isprint(static_cast<unsigned char>(c))) {
+                prefix += c;
+            }
+        }
+
+        tcsetattr(STDIN_FILENO, TCSANOW, &original);
+        cout << endl;
+        if (!matches.empty()) {
+            tree.displayEmployee(matches[0]);
+        }
+        return;
+    }
+#endif
+
+    cout << "Type the start of a first or last name (blank line to finish):" << endl;
+    string prefix;
+    while (getline(cin, prefix) && !prefix.empty()) {
+        vector<Employee> matches = tree.findEmployeesByNamePrefix(prefix, suggestionCount);
+        if (matches.empty()) {
+            cout << "  No employees match " << prefix << "." << endl;
+        }
+        else {
+            printNameMatches(matches);
+        }
+    }
+}
+
+/**
+ * Find the employees whose name best matches a possibly misspelled name
+ *
+ * @param tree The tree containing employee data
+ * @param dataLoaded Whether data has been loaded
+ */
+void fuzzySearchByName(BinarySearchTree& tree, bool dataLoaded) {
+    const unsigned maxDistance = 2;
+    const size_t matchCount = 10;
+
+    if (!dataLoaded) {
+        cout << "Please load the employee data first." << endl;
+        return;
+    }
+
+    string name;
+    cout << "Please enter the name, spelled as best you can:" << endl;
+    getline(cin >> ws, name);
+    cout << endl;
+
+    vector<pair<unsigned, Employee> > matches = tree.findEmployeesByFuzzyName(name, maxDistance, matchCount);
+    if (matches.empty()) {
+        cout << "We're sorry. No employees have a name close to " << name << "." << endl;
+        return;
+    }
+
+    cout << "Closest matches:" << endl;
+    for (size_t i = 0; i < matches.size(); ++i) {
+        const Employee& employee = matches[i].second;
+        cout << "  " << employee.employeeId << " - " << employee.fullName;
+        if (!employee.title().empty()) {
+            cout << ", " << employee.title();
+        }
+        cout << " (" << matches[i].first << (matches[i].first == 1 ? " edit)" : " edits)") << endl;
+    }
+}
+
+/**
+ * Count and list the employees matching a department/title/skill filter
+ *
+ * @param tree The tree containing employee data
+ * @param dataLoaded Whether data has been loaded
+ */
+void filterEmployees(BinarySearchTree& tree, bool dataLoaded) {
+    if (!dataLoaded) {
+        cout << "Please load the employee data first." << endl;
+        return;
+    }
+
+    string text;
+    cout << "Please enter a filter (e.g. department=Engineering AND title~Senior AND skill=Kubernetes):" << endl;
+    getline(cin >> ws, text);
+    cout << endl;
+
+    RecordFilter filter;
+    string error;
+    if (!parseRecordFilter(text, filter, error)) {
+        cout << "Invalid filter: " << error << endl;
+        return;
+    }
+
+    if (tree.countFilterMatches(filter) == 0) {
+        cout << "We're sorry. No employees match " << text << "." << endl;
+        return;
+    }
+    size_t count = tree.printFilterMatches(filter);
+    cout << "\n" << count << " matching employee(s)." << endl;
+}
+
+/**
+ * Report how two employees chosen by the user are related in the reporting
+ * structure: whether one is in the other's org, and their lowest common manager
+ *
+ * @param tree The tree containing employee data
+ * @param dataLoaded Whether data has been loaded
+ */
+void checkReportingChain(BinarySearchTree& tree, bool dataLoaded) {
+    if (!dataLoaded) {
+        cout << "Please load the employee data first." << endl;
+        return;
+    }
+
+    string firstId = readEmployeeId("Please enter the first Employee ID:");
+    if (tree.findEmployeeById(firstId).employeeId.empty()) {
+        cout << "We're sorry. No employee matching the ID " << firstId << " was found." << endl;
+        return;
+    }
+    string secondId = readEmployeeId("Please enter the second Employee ID:");
+    if (tree.findEmployeeById(secondId).employeeId.empty()) {
+        cout << "We're sorry. No employee matching the ID " << secondId << " was found." << endl;
+        return;
+    }
+
+    if (tree.isInOrganization(firstId, secondId)) {
+        cout << firstId << " is in " << secondId << "'s organization." << endl;
+    }
+    else if (tree.isInOrganization(secondId, firstId)) {
+        cout << secondId << " is in " << firstId << "'s organization." << endl;
+    }
+    else {
+        cout << "Neither employee is in the other's organization." << endl;
+    }
+
+    Employee manager = tree.findLowestCommonManager(firstId, secondId);
+    if (manager.employeeId.empty()) {
+        cout << "They have no manager in common." << endl;
+    }
+    else {
+        cout << "Lowest common manager: " << manager.employeeId << " - " << manager.fullName;
+        if (!manager.title().empty()) {
+            cout << ", " << manager.title();
+        }
+        cout << endl;
+    }
+}
+
+/**
+ * Print the total headcount and department mix under a manager chosen by the user
+ *
+ * @param tree The tree containing employee data
+ * @param dataLoaded Whether data has been loaded
+ */
+void printOrganizationSummary(BinarySearchTree& tree, bool dataLoaded) {
+    if (!dataLoaded) {
+        cout << "Please load the employee data first." << endl;
+        return;
+    }
+
+    string managerId = readEmployeeId("Please enter the manager's Employee ID:");
+    if (tree.findEmployeeById(managerId).employeeId.empty()) {
+        cout << "We're sorry. No employee matching the ID " << managerId << " was found." << endl;
+        return;
+    }
+
+    size_t headcount = tree.getOrgHeadcount(managerId);
+    cout << "Organization under " << managerId << ": " << headcount << " employee(s)" << endl;
+    vector<pair<string, size_t> > mix = tree.getOrgDepartmentMix(managerId);
+    for (size_t i = 0; i < mix.size(); ++i) {
+        cout << "  " << mix[i].first << ": " << mix[i].second << endl;
+    }
+    size_t unassigned = headcount;
+    for (size_t i = 0; i < mix.size(); ++i) {
+        unassigned -= mix[i].second;
+    }
+    if (unassigned > 0) {
+        cout << "  (no department): " << unassigned << endl;
+    }
+}
+
+/**
+ * Print reporting structure problems
+ *
+ * @param issues The problems found by validation
+ * @param limit Maximum number of problems of each kind to list
+ * @return Total number of problems
+ */
+size_t printValidationIssues(const ValidationIssues& issues, size_t limit) {
+    size_t total = issues.duplicateIds.size() + issues.danglingManagers.size() + issues.cycles.size();
+    if (total == 0) {
+        cout << "Reporting structure check: no problems found." << endl;
+        return 0;
+    }
+
+    cout << "Reporting structure check found " << issues.danglingManagers.size() << " unknown manager reference(s), "
+         << issues.cycles.size() << " reporting cycle(s) and " << issues.duplicateIds.size() << " duplicate ID(s)." << endl;
+    for (size_t i = 0; i < issues.danglingManagers.size() && i < limit; ++i) {
+        cout << "  " << issues.danglingManagers[i].first << " reports to unknown manager "
+             << issues.danglingManagers[i].second << endl;
+    }
+    for (size_t i = 0; i < issues.cycles.size() && i < limit; ++i) {
+        cout << "  Cycle: ";
+        for (size_t j = 0; j < issues.cycles[i].size(); ++j) {
+            cout << issues.cycles[i][j] << " -> ";
+        }
+        cout << issues.cycles[i][0] << endl;
+    }
+    for (size_t i = 0; i < issues.duplicateIds.size() && i < limit; ++i) {
+        cout << "  Duplicate ID " << issues.duplicateIds[i] << endl;
+    }
+
+    size_t shown = min(issues.danglingManagers.size(), limit) + min(issues.cycles.size(), limit) +
+                   min(issues.duplicateIds.size(), limit);
+    if (shown < total) {
+        cout << "  ... and " << total - shown << " more (option 16 lists them all)." << endl;
+    }
+    return total;
+}
+
+/**
+ * Check the loaded reporting structure and list every problem
+ *
+ * @param tree The tree containing employee data
+ * @param dataLoaded Whether data has been loaded
+ */
+void validateOrganization(BinarySearchTree& tree, bool dataLoaded) {
+    if (!dataLoaded) {
+        cout << "Please load the employee data first." << endl;
+        return;
+    }
+
+    ValidationIssues issues = tree.validateReportingStructure(max(1u, thread::hardware_concurrency()));
+    size_t total = issues.duplicateIds.size() + issues.danglingManagers.size() + issues.cycles.size();
+    printValidationIssues(issues, total);
+}
+
+/**
+ * Helper function that replaces the extension of a file name
+ *
+ * @param fileName The file name
+ * @param extension The new extension, including the dot
+ * @return The file name with its extension replaced, or added if it had none
+ */
+string replaceExtension(const string& fileName, const string& extension) {
+    size_t dot = fileName.find_last_of('.');
+    size_t separator = fileName.find_last_of("/\\");
+    if (dot == string::npos || (separator != string::npos && dot < separator)) {
+        return fileName + extension;
+    }
+    return fileName.substr(0, dot) + extension;
+}
+
+/**
+ * Name of the snapshot kept next to a CSV file
+ *
+ * @param fileName The CSV file name
+ * @return The file name with its extension replaced by ".snap"
+ */
+string snapshotFileName(const string& fileName) {
+    return replaceExtension(fileName, ".snap");
+}
+
+/**
+ * Name of the change log kept next to a CSV file
+ *
+ * @param fileName The CSV file name
+ * @return The file name with its extension replaced by ".wal"
+ */
+string logFileName(const string& fileName) {
+    return replaceExtension(fileName, ".wal");
+}
+
+/**
+ * Check whether a file was modified after another
+ *
+ * @param fileName The file that may be newer
+ * @param otherName The file to compare with
+ * @return True if both files exist and the first was modified later
+ */
+bool isNewerFile(const string& fileName, const string& otherName) {
+    struct stat info;
+    struct stat other;
+    if (stat(fileName.c_str(), &info) != 0 || stat(otherName.c_str(), &other) != 0) {
+        return false;
+    }
+    return info.st_mtime > other.st_mtime;
+}
+
+/**
+ * Pick the generation of a new snapshot: past the last one this session
+ * saved or loaded and past the one the change log on disk belongs to, so
+ * a log left behind by a crash never matches the new snapshot
+ *
+ * @param fileName CSV file name; the log is kept next to it
+ * @param persistence The session's change log
+ * @return The new generation
+ */
+uint64_t nextSnapshotGeneration(const string& fileName, const Persistence& persistence) {
+    uint64_t generation = persistence.generation;
+    string logName = logFileName(fileName);
+    MappedFile file;
+    WalHeader header;
+    string error;
+    if (file.open(logName, error) && readWalHeader(file.data(), file.size(), logName, header, error)) {
+        generation = max(generation, header.generation);
+    }
+    return generation + 1;
+}
+
+/**
+ * Save the loaded employees to a snapshot file for a fast restart
+ *
+ * @param tree The tree containing employee data
+ * @param dataLoaded Whether data has been loaded
+ * @param fileName CSV file name; the snapshot is saved next to it
+ * @param persistence The session's change log; takes the snapshot's generation
+ * @return True if the snapshot was saved
+ */
+bool saveEmployeeSnapshot(BinarySearchTree& tree, bool dataLoaded, const string& fileName, Persistence& persistence) {
+    if (!dataLoaded) {
+        cout << "Please load the employee data first." << endl;
+        return false;
+    }
+
+    string snapshotName = snapshotFileName(fileName);
+    uint64_t generation = nextSnapshotGeneration(fileName, persistence);
+    string error;
+    if (!tree.saveSnapshot(snapshotName, generation, error)) {
+        cout << "Unable to save snapshot: " << error << endl;
+        return false;
+    }
+    persistence.generation = generation;
+    cout << "Saved " << tree.size() << " employees to " << snapshotName << endl;
+    return true;
+}
+
+/**
+ * Load employees from the snapshot saved next to the CSV file
+ *
+ * @param tree Reference to the tree to populate
+ * @param fileName CSV file name; the snapshot is read from next to it
+ * @param generation Receives the snapshot's generation
+ * @return True if the snapshot was loaded; otherwise the tree is unchanged
+ */
+bool loadEmployeeSnapshot(BinarySearchTree& tree, const string& fileName, uint64_t& generation) {
+    string snapshotName = snapshotFileName(fileName);
+    cout << "Attempting to load snapshot: " << snapshotName << endl;
+
+    string error;
+    if (!tree.loadSnapshot(snapshotName, generation, error)) {
+        cout << "Unable to load snapshot: " << error << endl;
+        return false;
+    }
+    cout << "Loaded " << tree.size() << " employees from " << snapshotName << endl;
+    return true;
+}
+
+/**
+ * Look employees up in the snapshot saved next to the CSV file without
+ * loading it: the file is searched where it is mapped
+ *
+ * @param employeeIds The IDs to look up
+ * @param fileName CSV file name; the snapshot is read from next to it
+ * @return True if the snapshot could be opened
+ */
+bool lookupEmployeesInSnapshot(const vector<string>& employeeIds, const string& fileName) {
+    string snapshotName = snapshotFileName(fileName);
+    MappedEmployeeIndex index;
+    string error;
+    if (!index.open(snapshotName, error)) {
+        cout << "Unable to open snapshot: " << error << endl;
+        return false;
+    }
+
+    for (size_t i = 0; i < employeeIds.size(); ++i) {
+        string employeeId = employeeIds[i];
+        transform(employeeId.begin(), employeeId.end(), employeeId.begin(), ::toupper);
+
+        MappedEmployee employee;
+        if (!index.find(StringView(employeeId), employee)) {
+            cout << "We're sorry. No employee matching the ID " << employeeId << " was found." << endl;
+            continue;
+        }
+        cout << employeeId << " Information:" << endl;
+        cout << "Employee ID: " << employee.employeeId << endl;
+        cout << "Full Name: " << employee.fullName << endl;
+        cout << "Department: " << employee.department << endl;
+        cout << "Title: " << employee.title << endl;
+        cout << "Manager ID: ";
+        if (employee.managerId.empty()) {
+            cout << "None (Executive Level)";
+        }
+        else {
+            cout << employee.managerId;
+        }
+        cout << endl;
+
+        cout << "Skills: ";
+        if (employee.skillCount == 0) {
+            cout << "None";
+        }
+        for (uint32_t k = 0; k < employee.skillCount; ++k) {
+            cout << (k > 0 ? ", " : "") << index.skill(employee, k);
+        }
+        cout << endl;
+    }
+    return true;
+}
+
+/**
+ * Empty the change log, opening it first if needed, and mark it with the
+ * generation of the snapshot just saved. Called once a snapshot holds
+ * every change, so the records in the log are no longer needed.
+ *
+ * @param fileName CSV file name; the log is kept next to it
+ * @param persistence The session's change log
+ * @return True if the log is open and empty
+ */
+bool startChangeLog(const string& fileName, Persistence& persistence) {
+    string logName = logFileName(fileName);
+    string error;
+    if (!persistence.log.isOpen() && !persistence.log.open(logName, persistence.generation, error)) {
+        // The snapshot just saved holds everything, so an unreadable log can be replaced
+        remove(logName.c_str());
+        if (!persistence.log.open(logName, persistence.generation, error)) {
+            cout << "Unable to open change log: " << error << endl;
+            return false;
+        }
+    }
+    if (!persistence.log.reset(persistence.generation, error)) {
+        cout << "Unable to empty change log: " << error << endl;
+        persistence.log.close();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Save a snapshot and empty the change log, so a restart replays nothing.
+ * A crash in between leaves the old log behind, but its generation no
+ * longer matches the snapshot's, so it is not replayed. The checkpoint
+ * already costs time in proportion to the data, so the store is compacted
+ * first if any of its text is unused.
+ *
+ * @param tree The tree containing employee data
+ * @param fileName CSV file name; the snapshot and log are kept next to it
+ * @param persistence The session's change log
+ * @return True if the checkpoint is complete
+ */
+bool checkpointEmployeeData(BinarySearchTree& tree, const string& fileName, Persistence& persistence) {
+    if (tree.getDeadTextBytes() > 0) {
+        tree.compactStore();
+    }
+    return saveEmployeeSnapshot(tree, true, fileName, persistence) && startChangeLog(fileName, persistence);
+}
+
+/**
+ * Checkpoint once the log holds enough records to make replay slow
+ *
+ * @param tree The tree containing employee data
+ * @param fileName CSV file name; the snapshot and log are kept next to it
+ * @param persistence The session's change log
+ */
+void checkpointIfDue(BinarySearchTree& tree, const string& fileName, Persistence& persistence) {
+    if (!persistence.log.isOpen() || persistence.checkpointRecords == 0) {
+        return;
+    }
+    size_t recordCount = persistence.log.recordCount();
+    if (recordCount >= persistence.checkpointRecords) {
+        cout << "Checkpointing " << recordCount << " logged changes..." << endl;
+        checkpointEmployeeData(tree, fileName, persistence);
+    }
+}
+
+/**
+ * Load the snapshot saved next to the CSV file and replay the changes
+ * logged since, then keep logging to the same file
+ *
+ * @param tree Reference to the tree to populate
+ * @param fileName CSV file name; the snapshot and log are read from next to it
+ * @param persistence The session's change log
+ * @return True if the snapshot was loaded; otherwise the tree is unchanged
+ */
+bool restoreEmployeeData(BinarySearchTree& tree, const string& fileName, Persistence& persistence) {
+    uint64_t generation = 0;
+    if (!loadEmployeeSnapshot(tree, fileName, generation)) {
+        return false;
+    }
+    persistence.generation = generation;
+    persistence.log.close();
+    if (!persistence.enabled) {
+        return true;
+    }
+
+    string logName = logFileName(fileName);
+    size_t applied = 0;
+    string error;
+    ReplayResult result = replayWriteAheadLog(logName, generation, tree, applied, error);
+    if (result == ReplayResult::UNREADABLE) {
+        cout << "Unable to replay change log: " << error << endl;
+        cout << "Changes will not be logged until the next snapshot is saved." << endl;
+        return true;
+    }
+    if (result == ReplayResult::STALE) {
+        cout << "Skipped " << logName << ": its changes were logged before the snapshot was saved" << endl;
+    }
+    if (applied > 0) {
+        cout << "Replayed " << applied << " logged changes from " << logName << endl;
+    }
+
+    // A stale log is emptied here, so new changes follow this snapshot
+    if (!persistence.log.open(logName, generation, error)) {
+        cout << "Unable to open change log: " << error << endl;
+        return true;
+    }
+    WalStats stats = persistence.log.getStats();
+    if (stats.discardedBytes > 0) {
+        cout << "Discarded " << stats.discardedBytes << " bytes of an incomplete change at the end of " << logName << endl;
+    }
+    return true;
+}
+
+/**
+ * Restore the data of the last session at startup if it left a change log.
+ * The snapshot is restored when the log holds changes made on top of it,
+ * or when the CSV file has not been edited since the snapshot was saved;
+ * an edited CSV file with nothing logged is left for option 1 to load.
+ *
+ * @param tree Reference to the tree to populate
+ * @param fileName CSV file name; the snapshot and log are read from next to it
+ * @param persistence The session's change log
+ * @return True if data was restored
+ */
+bool recoverEmployeeData(BinarySearchTree& tree, const string& fileName, Persistence& persistence) {
+    string logName = logFileName(fileName);
+    string snapshotName = snapshotFileName(fileName);
+    if (!persistence.enabled || !ifstream(logName.c_str()).good()) {
+        return false;
+    }
+    uint64_t generation = 0;
+    string error;
+    if (!readSnapshotGeneration(snapshotName, generation, error)) {
+        cout << "Unable to recover the last session: " << error << endl << endl;
+        return false;
+    }
+    if (countWalRecords(logName, generation) == 0 && isNewerFile(fileName, snapshotName)) {
+        cout << fileName << " has changed since " << snapshotName << " was saved and " << logName
+             << " holds no changes; choose 1 to load it." << endl << endl;
+        return false;
+    }
+    cout << "Recovering employee data from the last session..." << endl;
+    bool recovered = restoreEmployeeData(tree, fileName, persistence);
+    cout << endl;
+    return recovered;
+}
+
+/**
+ * Wait until a logged change is on disk before it is applied
+ *
+ * @param persistence The session's change log
+ * @param sequence Sequence number of the change's record
+ * @return True if the change may be applied
+ */
+bool commitLogRecord(Persistence& persistence, uint64_t sequence) {
+    if (!persistence.log.waitDurable(sequence)) {
+        cout << "Unable to write the change log. Employee data was not changed." << endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Read a whole line typed by the user
+ *
+ * @param prompt The question shown to the user
+ * @return The line without surrounding spaces
+ */
+string readLine(const string& prompt) {
+    string line;
+    cout << prompt << endl;
+    getline(cin, line);
+    return trimView(StringView(line)).str();
+}
+
+/**
+ * Helper function that checks entered details and builds an employee from them
+ *
+ * @param employeeId The employee's ID
+ * @param fullName The employee's name
+ * @param department The employee's department
+ * @param title The employee's title
+ * @param managerId The manager's ID, or empty for none
+ * @param skills The skills, separated by commas
+ * @param employee Receives the employee
+ * @return False if the details are not valid; a message is printed
+ */
+bool buildEnteredEmployee(const string& employeeId, const string& fullName, const string& department,
+                          const string& title, const string& managerId, const string& skills, Employee& employee) {
+    EmployeeFields fields;
+    fields.employeeId = StringView(employeeId);
+    fields.fullName = StringView(fullName);
+    fields.department = StringView(department);
+    fields.title = StringView(title);
+    fields.managerId = StringView(managerId);
+    fields.skills = StringView(skills);
+    if (!validateEmployeeData(fields)) {
+        cout << "Invalid employee details. The ID must start with EMP and a name is required." << endl;
+        return false;
+    }
+
+    vector<StringView> skillList = parseSkills(fields.skills);
+    buildEmployee(fields, skillList.data(), skillList.size(), employee);
+    return true;
+}
+
+/**
+ * Add an employee entered by the user. The change is logged and on disk
+ * before it is applied.
+ *
+ * @param tree The tree containing employee data
+ * @param dataLoaded Whether data has been loaded
+ * @param fileName CSV file name; the snapshot and log are kept next to it
+ * @param persistence The session's change log
+ */
+void addEmployeeRecord(BinarySearchTree& tree, bool dataLoaded, const string& fileName, Persistence& persistence) {
+    if (!dataLoaded) {
+        cout << "Please load the employee data first." << endl;
+        return;
+    }
+
+    string employeeId = readEmployeeId("Please enter the new Employee ID:");
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    if (!tree.findEmployeeById(employeeId).employeeId.empty()) {
+        cout << "An employee with the ID " << employeeId << " already exists." << endl;
+        return;
+    }
+
+    string fullName = readLine("Full name:");
+    string department = readLine("Department:");
+    string title = readLine("Title:");
+    string managerId = readLine("Manager ID (blank for none):");
+    string skills = readLine("Skills, separated by commas:");
+    cout << endl;
+
+    Employee employee(tree.employeeStore());
+    if (!buildEnteredEmployee(employeeId, fullName, department, title, managerId, skills, employee)) {
+        return;
+    }
+    if (persistence.log.isOpen() && !commitLogRecord(persistence, persistence.log.appendPut(employee))) {
+        return;
+    }
+    tree.addEmployee(employee);
+    cout << "Added " << employeeId << "." << endl;
+    checkpointIfDue(tree, fileName, persistence);
+}
+
+/**
+ * Change the details of an employee chosen by the user. The change is
+ * logged and on disk before it is applied.
+ *
+ * @param tree The tree containing employee data
+ * @param dataLoaded Whether data has been loaded
+ * @param fileName CSV file name; the snapshot and log are kept next to it
+ * @param persistence The session's change log
+ */
+void updateEmployeeRecord(BinarySearchTree& tree, bool dataLoaded, const string& fileName, Persistence& persistence) {
+    if (!dataLoaded) {
+        cout << "Please load the employee data first." << endl;
+        return;
+    }
+
+    string employeeId = readEmployeeId("Please enter the ID of the employee to update:");
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    Employee current = tree.findEmployeeById(employeeId);
+    if (current.employeeId.empty()) {
+        cout << "We're sorry. No employee matching the ID " << employeeId << " was found." << endl;
+        return;
+    }
+    tree.displayEmployee(current);
+
+    string currentSkills;
+    for (size_t i = 0; i < current.skillCount(); ++i) {
+        currentSkills += (i > 0 ? ", " : "") + current.skill(i);
+    }
+
+    cout << "\nEnter the new details, or leave a field blank to keep it." << endl;
+    string fullName = readLine("Full name [" + current.fullName.str() + "]:");
+    string department = readLine("Department [" + current.department() + "]:");
+    string title = readLine("Title [" + current.title() + "]:");
+    string managerId = readLine("Manager ID [" + current.managerId() + "] (- for none):");
+    string skills = readLine("Skills [" + currentSkills + "] (- for none):");
+    cout << endl;
+
+    Employee employee(tree.employeeStore());
+    if (!buildEnteredEmployee(employeeId,
+                              fullName.empty() ? current.fullName.str() : fullName,
+                              department.empty() ? current.department() : department,
+                              title.empty() ? current.title() : title,
+                              managerId.empty() ? current.managerId() : (managerId == "-" ? "" : managerId),
+                              skills.empty() ? currentSkills : (skills == "-" ? "" : skills),
+                              employee)) {
+        return;
+    }
+    if (persistence.log.isOpen() && !commitLogRecord(persistence, persistence.log.appendPut(employee))) {
+        return;
+    }
+    tree.updateEmployee(employee);
+    cout << "Updated " << employeeId << "." << endl;
+    checkpointIfDue(tree, fileName, persistence);
+}
+
+/**
+ * Remove an employee chosen by the user. The change is logged and on disk
+ * before it is applied.
+ *
+ * @param tree The tree containing employee data
+ * @param dataLoaded Whether data has been loaded
+ * @param fileName CSV file name; the snapshot and log are kept next to it
+ * @param persistence The session's change log
+ */
+void removeEmployeeRecord(BinarySearchTree& tree, bool dataLoaded, const string& fileName, Persistence& persistence) {
+    if (!dataLoaded) {
+        cout << "Please load the employee data first." << endl;
+        return;
+    }
+
+    string employeeId = readEmployeeId("Please enter the ID of the employee to remove:");
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    if (tree.findEmployeeById(employeeId).employeeId.empty()) {
+        cout << "We're sorry. No employee matching the ID " << employeeId << " was found." << endl;
+        return;
+    }
+
+    if (persistence.log.isOpen() && !commitLogRecord(persistence, persistence.log.appendRemove(employeeId))) {
+        return;
+    }
+    tree.removeEmployee(employeeId);
+    cout << "Removed " << employeeId << "." << endl;
+    checkpointIfDue(tree, fileName, persistence);
+}
+
+/**
+ * Process user menu choice and execute appropriate action
+ *
+ * @param choice User's menu selection
+ * @param tree Reference to the employee tree
+ * @param dataLoaded Reference to data loaded flag
+ * @param fileName CSV file name
+ * @param loadStrategy How option 1 reads the file into the tree
+ * @param persistence The session's change log
+ * @return True to continue program, false to exit
+ */
+bool processMenuChoice(int choice, BinarySearchTree& tree, bool& dataLoaded, const string& fileName,
+                       LoadStrategy loadStrategy, Persistence& persistence) {
+    switch (choice) {
+    case 1: {
+        dataLoaded = loadEmployeeData(tree, fileName, loadStrategy);
+        // Later changes are logged against a snapshot of the freshly loaded data
+        if (dataLoaded && persistence.enabled) {
+            checkpointEmployeeData(tree, fileName, persistence);
+        }
+        break;
+    }
+    case 2: {
+        printEmployeeDirectory(tree, dataLoaded);
+        break;
+    }
+    case 3: {
+        searchForEmployee(tree, dataLoaded);
+        break;
+    }
+    case 4: {
+        printLookupStatistics(tree, dataLoaded);
+        break;
+    }
+    case 5: {
+        listDepartment(tree, dataLoaded);
+        break;
+    }
+    case 6: {
+        printDepartmentHeadcounts(tree, dataLoaded);
+        break;
+    }
+    case 7: {
+        listDirectReports(tree, dataLoaded);
+        break;
+    }
+    case 8: {
+        listOrganization(tree, dataLoaded);
+        break;
+    }
+    case 10: {
+        searchBySkills(tree, dataLoaded);
+        break;
+    }
+    case 11: {
+        searchByName(tree, dataLoaded);
+        break;
+    }
+    case 12: {
+        fuzzySearchByName(tree, dataLoaded);
+        break;
+    }
+    case 13: {
+        filterEmployees(tree, dataLoaded);
+        break;
+    }
+    case 14: {
+        checkReportingChain(tree, dataLoaded);
+        break;
+    }
+    case 15: {
+        printOrganizationSummary(tree, dataLoaded);
+        break;
+    }
+    case 16: {
+        validateOrganization(tree, dataLoaded);
+        break;
+    }
+    case 17: {
+        if (saveEmployeeSnapshot(tree, dataLoaded, fileName, persistence) && persistence.enabled) {
+            startChangeLog(fileName, persistence);
+        }
+        break;
+    }
+    case 18: {
+        if (restoreEmployeeData(tree, fileName, persistence)) {
+            dataLoaded = true;
+        }
+        break;
+    }
+    case 19: {
+        reloadEmployeeData(tree, dataLoaded, fileName, persistence);
+        break;
+    }
+    case 20: {
+        addEmployeeRecord(tree, dataLoaded, fileName, persistence);
+        break;
+    }
+    case 21: {
+        updateEmployeeRecord(tree, dataLoaded, fileName, persistence);
+        break;
+    }
+    case 22: {
+        removeEmployeeRecord(tree, dataLoaded, fileName, persistence);
+        break;
+    }
+    case 9: {
+        cout << "Goodbye!" << endl;
+        return false; // Signal to exit
+    }
+    default: {
+        cout << choice << " is not a valid option." << endl;
+        break;
+    }
+    }
+    return true; // Continue program
+}
+
+//============================================================================
+// Benchmarks
+//============================================================================
+
+/**
+ * Build the ID of a synthetic employee
+ *
+ * @param index Sequence number of the employee
+ * @return "EMP" followed by the number zero-padded to seven digits
+ */
+string makeSyntheticEmployeeId(size_t index) {
+    ostringstream id;
+    id << "EMP" << setw(7) << setfill('0') << index;
+    return id.str();
+}
+
+/**
+ * Build a synthetic employee record for benchmarks
+ *
+ * @param index Sequence number of the employee
+ * @param store The store to build the record in
+ * @return Employee with ID "EMP" followed by a zero-padded number
+ */
+Employee makeSyntheticEmployee(size_t index, const shared_ptr<EmployeeStore>& store) {
+    static const char* departments[] = { "Engineering", "Sales", "Marketing", "HR", "Finance", "Operations", "Customer Service" };
+    static const char* titles[] = { "Software Engineer", "Senior Software Engineer", "Account Manager", "Analyst", "Manager", "Specialist" };
+    static const char* skillNames[] = { "C++", "Python", "Agile", "Java", "SQL", "Kubernetes", "Leadership", "Negotiation", "Excel", "Communication" };
+    static const char* firstNames[] = {
+        "Alice", "Brian", "Catherine", "David", "Emily", "Frank", "Grace", "Henry", "Isabella", "Jack",
+        "Karen", "Lucas", "Maria", "Nathan", "Olivia", "Paul", "Quinn", "Rachel", "Samuel", "Tina",
+        "Ursula", "Victor", "Wendy", "Xavier", "Yolanda", "Zachary", "Amanda", "Blake", "Chloe", "Daniel",
+        "Elena", "Felix", "Gabriella", "Harrison", "Iris", "James", "Kylie", "Logan", "Megan", "Noah" };
+    static const char* surnameStarts[] = {
+        "And", "Bal", "Car", "Dav", "Ell", "Fos", "Gar", "Har", "Ing", "John",
+        "Kel", "Lop", "Mar", "Nor", "Oak", "Par", "Quin", "Ros", "Sand", "Thom" };
+    static const char* surnameMiddles[] = { "", "a", "en", "er", "ing", "ol", "ow", "ram", "st", "ver" };
+    static const char* surnameEnds[] = {
+        "erson", "is", "ter", "ley", "ford", "wood", "ton", "ins", "man", "sen",
+        "ridge", "ell", "ows", "by", "croft", "ham", "ner", "ez", "stein", "more" };
+
+    Employee employee(store);
+    employee.setEmployeeId(makeSyntheticEmployeeId(index));
+    employee.setFullName(string(firstNames[index % 40]) + " " + surnameStarts[(index / 40) % 20] +
+                           surnameMiddles[(index / 800) % 10] + surnameEnds[(index / 8000) % 20]);
+    employee.setDepartment(departments[index % 7]);
+    employee.setTitle(titles[(index / 7) % 6]);
+    if (index >= 10) {
+        employee.setManagerId(makeSyntheticEmployeeId(index / 10));
+    }
+    for (size_t i = 0; i < 4; ++i) {
+        employee.addSkill(skillNames[(index + i * 3) % 10]);
+    }
+    return employee;
+}
+
+/**
+ * Draws ranks 0..n-1 with probability proportional to 1 / (rank + 1)^theta
+ */
+class ZipfianGenerator {
+
+private:
+    vector<double> cumulative;
+    mt19937_64 engine;
+    uniform_real_distribution<double> uniform;
+
+public:
+    ZipfianGenerator(size_t n, double theta, uint64_t seed) : cumulative(n), engine(seed), uniform(0.0, 1.0) {
+        double sum = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            sum += 1.0 / pow(static_cast<double>(i + 1), theta);
+            cumulative[i] = sum;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            cumulative[i] /= sum;
+        }
+    }
+
+    size_t next() {
+        double u = uniform(engine);
+        size_t rank = lower_bound(cumulative.begin(), cumulative.end(), u) - cumulative.begin();
+        return rank < cumulative.size() ? rank : cumulative.size() - 1;
+    }
+};
+
+/**
+ * Compare findEmployeeById latency without the lookup cache, with the
+ * configured cache and with caches 4 and 16 times larger under Zipfian
+ * (skewed) lookup traffic
+ *
+ * @param options Index backend, cache capacity and data set size
+ */
+void benchmarkLookupCache(const ProgramOptions& options) {
+    const size_t lookups = 2000000;
+    const double theta = 0.99;
+
+    cout << "Building tree with " << options.benchmarkSize << " synthetic employees..." << endl;
+    BinarySearchTree tree(options.backend);
+    tree.setFilterFalsePositiveRate(options.filterRate);
+    vector<string> ids;
+    ids.reserve(options.benchmarkSize);
+    for (size_t i = 0; i < options.benchmarkSize; ++i) {
+        Employee employee = makeSyntheticEmployee(i, tree.employeeStore());
+        ids.push_back(employee.employeeId.str());
+        tree.addEmployee(employee);
+    }
+
+    // Scatter the popular ranks over the key space so hot keys are not neighbours in the tree
+    vector<size_t> order(options.benchmarkSize);
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    shuffle(order.begin(), order.end(), mt19937_64(7));
+
+    ZipfianGenerator zipf(options.benchmarkSize, theta, 42);
+    vector<const string*> trace(lookups);
+    for (size_t i = 0; i < lookups; ++i) {
+        trace[i] = &ids[order[zipf.next()]];
+    }
+
+    // Also try larger caches, since the hit rate under Zipfian traffic grows with the log of the capacity
+    size_t capacities[] = { 0, options.cacheCapacity, options.cacheCapacity * 4, options.cacheCapacity * 16 };
+    size_t runs = options.cacheCapacity == 0 ? 1 : 4;
+    for (size_t c = 0; c < runs; ++c) {
+        tree.setCacheCapacity(capacities[c]);
+        tree.resetCacheStats();
+        size_t found = 0;
+
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < lookups; ++i) {
+            found += !tree.findEmployeeById(*trace[i]).employeeId.empty();
+        }
+        auto elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+
+        CacheStats stats = tree.getCacheStats();
+        cout << "Cache capacity " << setw(8) << capacities[c] << ": "
+             << fixed << setprecision(1) << elapsed / lookups << " ns/lookup, hit rate "
+             << stats.hitRate() * 100.0 << "% (" << found << " found)" << endl;
+        cout.unsetf(ios::floatfield);
+    }
+}
+
+/**
+ * Time multi-skill AND/NOT queries on a synthetic skill index, comparing the
+ * galloping/SIMD evaluator with plain std::set_intersection chains
+ *
+ * @param options Data set size
+ */
+void benchmarkSkillQueries(const ProgramOptions& options) {
+    const size_t skillCount = 200;
+    const size_t queryCount = 200;
+    size_t rowCount = options.benchmarkSize;
+
+    // Skill popularity is skewed: a few skills are common, most are rare
+    cout << "Building skill index for " << rowCount << " synthetic employees..." << endl;
+    StringDictionary skillNames;
+    PostingIndex skills;
+    vector<uint32_t> skillIds;
+    for (size_t i = 0; i < skillCount; ++i) {
+        skillIds.push_back(skillNames.intern("Skill" + to_string(i)));
+    }
+    ZipfianGenerator popularity(skillCount, 1.0, 11);
+    mt19937_64 engine(13);
+    size_t postings = 0;
+    for (uint32_t row = 0; row < rowCount; ++row) {
+        size_t perRow = 4 + engine() % 5;
+        for (size_t i = 0; i < perRow; ++i) {
+            skills.add(skillIds[popularity.next()], row);
+        }
+    }
+    for (size_t i = 0; i < skillCount; ++i) {
+        postings += skills.rows(skillIds[i]).size();
+    }
+    cout << "Index holds " << postings << " postings over " << skillCount << " skills" << endl;
+
+    // Queries of 2 to 4 required skills, every fourth with an excluded skill
+    vector<SkillQuery> queries(queryCount);
+    for (size_t q = 0; q < queryCount; ++q) {
+        queries[q].clauses.assign(1, vector<SkillTerm>());
+        size_t terms = 2 + q % 3;
+        for (size_t t = 0; t < terms; ++t) {
+            SkillTerm term;
+            term.skill = "Skill" + to_string(t == 0 ? engine() % 10 : engine() % skillCount);
+            term.negated = false;
+            queries[q].clauses[0].push_back(term);
+        }
+        if (q % 4 == 0) {
+            SkillTerm term;
+            term.skill = "Skill" + to_string(engine() % skillCount);
+            term.negated = true;
+            queries[q].clauses[0].push_back(term);
+        }
+    }
+
+    vector<uint32_t> universe;
+    size_t optimizedMatches = 0;
+    auto start = chrono::steady_clock::now();
+    for (size_t q = 0; q < queryCount; ++q) {
+        optimizedMatches += evaluateSkillQuery(queries[q], skills, skillNames, universe).size();
+    }
+    double optimized = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    // Baseline: intersect in query order with the standard algorithm
+    size_t baselineMatches = 0;
+    start = chrono::steady_clock::now();
+    for (size_t q = 0; q < queryCount; ++q) {
+        const vector<SkillTerm>& terms = queries[q].clauses[0];
+        vector<uint32_t> result;
+        vector<uint32_t> scratch;
+        bool first = true;
+        for (size_t t = 0; t < terms.size(); ++t) {
+            uint32_t skillId = 0;
+            skillNames.findGroup(terms[t].skill, skillId);
+            const vector<uint32_t>& list = skills.rows(skillId);
+            scratch.clear();
+            if (terms[t].negated) {
+                set_difference(result.begin(), result.end(), list.begin(), list.end(), back_inserter(scratch));
+            }
+            else if (first) {
+                scratch = list;
+                first = false;
+            }
+            else {
+                set_intersection(result.begin(), result.end(), list.begin(), list.end(), back_inserter(scratch));
+            }
+            result.swap(scratch);
+        }
+        baselineMatches += result.size();
+    }
+    double baseline = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    cout << fixed << setprecision(3);
+    cout << "std::set_intersection: " << baseline / queryCount << " ms/query (" << baselineMatches << " matches)" << endl;
+    cout << "Galloping + SIMD:      " << optimized / queryCount << " ms/query (" << optimizedMatches << " matches)" << endl;
+    cout.unsetf(ios::floatfield);
+}
+
+/**
+ * Measure fuzzy name search latency against a scan of every name
+ *
+ * Queries are real names with one or two random typos (substitution,
+ * insertion or deletion) and are searched within edit distance 2.
+ *
+ * @param options Index backend and data set size
+ */
+void benchmarkFuzzyNames(const ProgramOptions& options) {
+    const size_t queryCount = 1000;
+    const size_t baselineCount = 20;
+    const unsigned maxDistance = 2;
+
+    cout << "Building tree with " << options.benchmarkSize << " synthetic employees..." << endl;
+    BinarySearchTree tree(options.backend);
+    vector<string> names;
+    names.reserve(options.benchmarkSize);
+    for (size_t i = 0; i < options.benchmarkSize; ++i) {
+        Employee employee = makeSyntheticEmployee(i, tree.employeeStore());
+        names.push_back(employee.fullName.str());
+        tree.addEmployee(employee);
+    }
+    if (names.empty()) {
+        return;
+    }
+
+    mt19937_64 engine(17);
+    vector<string> queries(queryCount);
+    for (size_t q = 0; q < queryCount; ++q) {
+        string query = names[engine() % names.size()];
+        size_t edits = 1 + q % 2;
+        for (size_t e = 0; e < edits && !query.empty(); ++e) {
+            size_t position = engine() % query.size();
+            char letter = static_cast<char>('a' + engine() % 26);
+            switch (engine() % 3) {
+            case 0: query[position] = letter; break;
+            case 1: query.insert(query.begin() + position, letter); break;
+            default: query.erase(position, 1); break;
+            }
+        }
+        queries[q] = query;
+    }
+
+    size_t matches = 0;
+    vector<double> latencies;
+    for (size_t q = 0; q < queryCount; ++q) {
+        auto start = chrono::steady_clock::now();
+        matches += tree.findEmployeesByFuzzyName(queries[q], maxDistance, 10).size();
+        latencies.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+    }
+    double indexed = 0;
+    for (size_t q = 0; q < queryCount; ++q) {
+        indexed += latencies[q];
+    }
+    sort(latencies.begin(), latencies.end());
+
+    // Baseline: bit-parallel distance to every name, no trigram filter
+    size_t scanMatches = 0;
+    auto start = chrono::steady_clock::now();
+    for (size_t q = 0; q < baselineCount; ++q) {
+        EditDistanceMatcher matcher(queries[q]);
+        for (size_t i = 0; i < names.size(); ++i) {
+            if (matcher.distance(names[i].data(), names[i].size()) <= maxDistance) {
+                scanMatches++;
+            }
+        }
+    }
+    double scan = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    cout << fixed << setprecision(3);
+    cout << "Full scan:      " << scan / baselineCount << " ms/query (" << scanMatches << " matches in " << baselineCount << " queries)" << endl;
+    cout << "Trigram filter: " << indexed / queryCount << " ms/query, p99 " << latencies[queryCount * 99 / 100]
+         << " ms, slowest " << latencies.back() << " ms (" << matches << " results in " << queryCount << " queries)" << endl;
+    cout.unsetf(ios::floatfield);
 }
 
 /**
- * Helper function to recursively delete all nodes in the tree
+ * Resolve each filter term to the dictionary ids whose values it matches, so
+ * the record-scan baseline of benchmarkFilterCounts can test records with
+ * integer compares instead of string folding. Resolve after the records
+ * being tested have been interned.
  *
- * @param node The current node to delete (and its subtrees)
+ * @param filter The parsed filter; its terms' valueIds are filled in
+ * @param store The store holding the records to be tested
  */
-void BinarySearchTree::destroyTree(Node* node) {
-    if (node != nullptr) {
-        destroyTree(node->left);   // Delete left subtree
-        destroyTree(node->right);  // Delete right subtree
-        delete node;               // Delete current node
+void resolveFilterIds(RecordFilter& filter, const EmployeeStore& store) {
+    for (size_t c = 0; c < filter.clauses.size(); ++c) {
+        for (size_t t = 0; t < filter.clauses[c].size(); ++t) {
+            FilterTerm& term = filter.clauses[c][t];
+            const StringDictionary& dictionary =
+                term.field == FilterField::DEPARTMENT ? store.departments :
+                term.field == FilterField::TITLE ? store.titles : store.skills;
+            string needle = foldCase(term.value);
+            term.valueIds.clear();
+            term.skills = SkillSet();
+            for (uint32_t id = 1; id < dictionary.size(); ++id) {
+                string value = foldCase(dictionary.value(id));
+                if (term.contains ? value.find(needle) != string::npos : value == needle) {
+                    term.valueIds.push_back(id);
+                    if (term.field == FilterField::SKILL && id <= 0xFFFF) {
+                        term.skills.add(static_cast<uint16_t>(id));
+                    }
+                }
+            }
+        }
     }
 }
 
 /**
- * Copy constructor - creates a deep copy of another tree
+ * Check a single employee record against a filter term by reading its fields
  *
- * @param other The tree to copy from
+ * @param employee The employee to test
+ * @param term The filter term, resolved by resolveFilterIds (its negation is ignored)
+ * @return True if the field matches
  */
-BinarySearchTree::BinarySearchTree(const BinarySearchTree& other) {
-    root = copyTree(other.root);
+bool recordMatchesTerm(const Employee& employee, const FilterTerm& term) {
+    if (term.field == FilterField::DEPARTMENT) {
+        return binary_search(term.valueIds.begin(), term.valueIds.end(), employee.departmentId);
+    }
+    if (term.field == FilterField::TITLE) {
+        return binary_search(term.valueIds.begin(), term.valueIds.end(), employee.titleId);
+    }
+    return employee.skills.intersects(term.skills);
 }
 
 /**
- * Assignment operator - assigns one tree to another with deep copy
+ * Check a single employee record against a filter by reading its fields
  *
- * @param other The tree to copy from
- * @return Reference to this tree
+ * @param employee The employee to test
+ * @param filter The parsed filter
+ * @return True if any clause matches
  */
-BinarySearchTree& BinarySearchTree::operator=(const BinarySearchTree& other) {
-    if (this != &other) {  // Avoid self-assignment
-        // Clean up existing tree
-        destroyTree(root);
-        // Copy the other tree
-        root = copyTree(other.root);
+bool recordMatchesFilter(const Employee& employee, const RecordFilter& filter) {
+    for (size_t c = 0; c < filter.clauses.size(); ++c) {
+        bool matches = true;
+        for (size_t t = 0; t < filter.clauses[c].size() && matches; ++t) {
+            const FilterTerm& term = filter.clauses[c][t];
+            matches = recordMatchesTerm(employee, term) != term.negated;
+        }
+        if (matches) {
+            return true;
+        }
     }
-    return *this;
+    return false;
 }
 
 /**
- * Helper function to recursively copy a tree
+ * Compare bitmap filter counts with checking every employee record
  *
- * @param node The root of the subtree to copy
- * @return Pointer to the root of the new copied subtree
+ * @param options Data set size
  */
-Node* BinarySearchTree::copyTree(Node* node) {
-    if (node == nullptr) {
-        return nullptr;
+void benchmarkFilterCounts(const ProgramOptions& options) {
+    const size_t repeats = 20;
+    const char* filters[] = {
+        "department=Engineering AND title~Senior AND skill=Kubernetes",
+        "skill=C++ AND skill=Python AND NOT skill=Agile",
+        "department=Sales OR department=Marketing",
+        "title~Manager AND NOT department=HR",
+        "department=Finance AND skill=Excel"
+    };
+
+    cout << "Building tree with " << options.benchmarkSize << " synthetic employees..." << endl;
+    BinarySearchTree tree(options.backend);
+    vector<Employee> employees;
+    employees.reserve(options.benchmarkSize);
+    for (size_t i = 0; i < options.benchmarkSize; ++i) {
+        employees.push_back(makeSyntheticEmployee(i, tree.employeeStore()));
+        tree.addEmployee(employees.back());
     }
 
-    // Create new node with same employee data
-    Node* newNode = new Node(node->employee);
-    newNode->height = node->height;  // Copy height for AVL
+    cout << fixed << setprecision(3);
+    for (size_t f = 0; f < sizeof(filters) / sizeof(filters[0]); ++f) {
+        RecordFilter filter;
+        string error;
+        parseRecordFilter(filters[f], filter, error);
+        resolveFilterIds(filter, *tree.employeeStore());
 
-    // Recursively copy left and right subtrees
-    newNode->left = copyTree(node->left);
-    newNode->right = copyTree(node->right);
+        uint64_t bitmapCount = 0;
+        auto start = chrono::steady_clock::now();
+        for (size_t r = 0; r < repeats; ++r) {
+            bitmapCount = tree.countFilterMatches(filter);
+        }
+        double bitmap = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / repeats;
 
-    return newNode;
-}
+        size_t scanCount = 0;
+        start = chrono::steady_clock::now();
+        for (size_t i = 0; i < employees.size(); ++i) {
+            scanCount += recordMatchesFilter(employees[i], filter) ? 1 : 0;
+        }
+        double scan = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
 
-/**
- * Get height of a node (0 for null nodes)
- *
- * @param node The node to get height of
- * @return Height of the node
- */
-int BinarySearchTree::getHeight(Node* node) {
-    return node ? node->height : 0;
+        cout << filters[f] << endl;
+        cout << "  record scan: " << scan << " ms (" << scanCount << ")   bitmaps: " << bitmap << " ms ("
+             << bitmapCount << ")" << endl;
+    }
+    cout.unsetf(ios::floatfield);
 }
 
 /**
- * Get balance factor of a node (right height - left height)
+ * Compare lowest-common-manager queries on the Euler tour with walking both
+ * reporting chains one findEmployeeById at a time
  *
- * @param node The node to get balance factor of
- * @return Balance factor (-1, 0, 1 for balanced; -2, +2 for unbalanced)
+ * @param options Index backend and data set size
  */
-int BinarySearchTree::getBalance(Node* node) {
-    return node ? getHeight(node->right) - getHeight(node->left) : 0;
-}
+void benchmarkReportingChains(const ProgramOptions& options) {
+    const size_t queryCount = 100000;
 
-/**
- * Update height of a node based on its children's heights
- *
- * @param node The node to update height for
- */
-void BinarySearchTree::updateHeight(Node* node) {
-    if (node) {
-        node->height = 1 + max(getHeight(node->left), getHeight(node->right));
+    cout << "Building tree with " << options.benchmarkSize << " synthetic employees..." << endl;
+    BinarySearchTree tree(options.backend);
+    vector<string> ids;
+    ids.reserve(options.benchmarkSize);
+    for (size_t i = 0; i < options.benchmarkSize; ++i) {
+        Employee employee = makeSyntheticEmployee(i, tree.employeeStore());
+        ids.push_back(employee.employeeId.str());
+        tree.addEmployee(employee);
+    }
+    if (ids.empty()) {
+        return;
     }
-}
 
-/**
- * Right rotation (for left-heavy trees)
- *
- *     y                    x
- *    / \                  / \
- *   x   T3      -->      T1  y
- *  / \                      / \
- * T1  T2                   T2  T3
- *
- * @param y The unbalanced node
- * @return New root of the subtree
- */
-Node* BinarySearchTree::rotateRight(Node* y) {
-    Node* x = y->left;
-    Node* T2 = x->right;
+    auto start = chrono::steady_clock::now();
+    tree.isInOrganization(ids[0], ids[ids.size() - 1]);
+    double build = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
 
-    // Perform rotation
-    x->right = y;
-    y->left = T2;
+    mt19937_64 engine(23);
+    vector<pair<string, string> > pairs(queryCount);
+    for (size_t q = 0; q < queryCount; ++q) {
+        pairs[q] = make_pair(ids[engine() % ids.size()], ids[engine() % ids.size()]);
+    }
 
-    // Update heights (order matters: y first, then x)
-    updateHeight(y);
-    updateHeight(x);
+    size_t found = 0;
+    start = chrono::steady_clock::now();
+    for (size_t q = 0; q < queryCount; ++q) {
+        found += tree.findLowestCommonManager(pairs[q].first, pairs[q].second).employeeId.empty() ? 0 : 1;
+    }
+    double tour = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
 
-    // Return new root
-    return x;
+    // Baseline: collect the first chain, then climb the second until they meet
+    size_t walkedFound = 0;
+    start = chrono::steady_clock::now();
+    for (size_t q = 0; q < queryCount; ++q) {
+        vector<string> chain;
+        for (Employee e = tree.findEmployeeById(pairs[q].first); !e.employeeId.empty(); e = tree.findEmployeeById(e.managerId())) {
+            chain.push_back(e.employeeId.str());
+            if (e.managerId().empty()) {
+                break;
+            }
+        }
+        for (Employee e = tree.findEmployeeById(pairs[q].second); !e.employeeId.empty(); e = tree.findEmployeeById(e.managerId())) {
+            if (find(chain.begin(), chain.end(), e.employeeId) != chain.end()) {
+                walkedFound++;
+                break;
+            }
+            if (e.managerId().empty()) {
+                break;
+            }
+        }
+    }
+    double walked = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+
+    cout << fixed << setprecision(3);
+    cout << "Euler tour + sparse table built in " << build << " ms" << endl;
+    cout << "Chain walk:  " << walked / queryCount << " us/query (" << walkedFound << " with a common manager)" << endl;
+    cout << "Euler tour:  " << tour / queryCount << " us/query (" << found << " with a common manager)" << endl;
+    cout.unsetf(ios::floatfield);
 }
 
 /**
- * Left rotation (for right-heavy trees)
+ * Time the reporting structure check on a synthetic org with planted
+ * unknown managers and cycles
  *
- *   x                      y
- *  / \                    / \
- * T1  y        -->       x   T3
- *    / \                / \
- *   T2  T3             T1  T2
+ * Only IDs and manager IDs are generated, so large sizes fit in memory.
  *
- * @param x The unbalanced node
- * @return New root of the subtree
+ * @param options Data set size
  */
-Node* BinarySearchTree::rotateLeft(Node* x) {
-    Node* y = x->right;
-    Node* T2 = y->left;
+void benchmarkValidation(const ProgramOptions& options) {
+    size_t count = options.benchmarkSize;
+    cout << "Generating " << count << " synthetic IDs..." << endl;
+    vector<string> ids(count);
+    vector<string> managerIds(count);
+    for (size_t i = 0; i < count; ++i) {
+        ids[i] = makeSyntheticEmployeeId(i);
+        if (i >= 10) {
+            managerIds[i] = makeSyntheticEmployeeId(i / 10);
+        }
+    }
 
-    // Perform rotation
-    y->left = x;
-    x->right = T2;
+    // One bad reference and one three-person cycle per 100000 employees
+    size_t planted = 0;
+    for (size_t i = 100000; i + 2 < count; i += 100000) {
+        managerIds[i - 1] = "MISSING" + to_string(i);
+        managerIds[i] = ids[i + 2];
+        managerIds[i + 1] = ids[i];
+        managerIds[i + 2] = ids[i + 1];
+        planted++;
+    }
 
-    // Update heights (order matters: x first, then y)
-    updateHeight(x);
-    updateHeight(y);
+    vector<StringView> idViews(count);
+    vector<StringView> managerViews(count);
+    for (size_t i = 0; i < count; ++i) {
+        idViews[i] = StringView(ids[i]);
+        managerViews[i] = StringView(managerIds[i]);
+    }
 
-    // Return new root
-    return y;
+    unsigned threads = max(1u, thread::hardware_concurrency());
+    auto start = chrono::steady_clock::now();
+    ValidationIssues issues = ReportingGraphValidator(idViews, managerViews, threads).run();
+    double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    cout << fixed << setprecision(1);
+    cout << "Checked " << count << " employees on " << threads << " thread(s) in " << elapsed << " ms: "
+         << issues.danglingManagers.size() << " unknown managers, " << issues.cycles.size() << " cycles (planted "
+         << planted << " of each)" << endl;
+    cout.unsetf(ios::floatfield);
 }
 
 /**
- * AVL insertion - maintains tree balance automatically
+ * Compare skills stored as vector<string> with SkillSet on a skills-heavy
+ * synthetic data set: memory per employee, and the time for pairwise
+ * overlap and single-skill checks
  *
- * @param node Current node (subtree root)
- * @param employee Employee to insert
- * @return New root of the subtree after insertion and balancing
+ * @param options Data set size
  */
-Node* BinarySearchTree::insertNodeAVL(Node* node, Employee employee) {
-    // 1. Normal BST insertion
-    if (node == nullptr) {
-        return new Node(employee);
-    }
+void benchmarkSkillSets(const ProgramOptions& options) {
+    static const char* areas[] = {
+        "Advanced", "Applied", "Cloud", "Data", "Enterprise", "Financial", "Technical", "Strategic", "Digital", "Product" };
+    static const char* crafts[] = {
+        "Analytics", "Architecture", "Communication", "Design", "Engineering", "Forecasting", "Management",
+        "Modeling", "Operations", "Security", "Planning", "Reporting", "Testing", "Automation", "Compliance",
+        "Negotiation", "Research", "Governance", "Integration", "Leadership", "Marketing", "Optimization",
+        "Procurement", "Recruiting", "Sales", "Storytelling", "Support", "Training", "Visualization", "Writing" };
+    const size_t pairCount = 1000000;
 
-    if (employee.employeeId < node->employee.employeeId) {
-        node->left = insertNodeAVL(node->left, employee);
-    }
-    else if (employee.employeeId > node->employee.employeeId) {
-        node->right = insertNodeAVL(node->right, employee);
-    }
-    else {
-        // Duplicate keys not allowed, return unchanged
-        return node;
-    }
+    cout << fixed << setprecision(1);
+    const size_t catalogSizes[] = { 48, 300 };
+    for (size_t c = 0; c < 2; ++c) {
+        size_t catalogSize = catalogSizes[c];
+        StringDictionary catalog;
+        for (size_t i = 0; i < catalogSize; ++i) {
+            catalog.intern(string(areas[i % 10]) + " " + crafts[(i / 10) % 30]);
+        }
 
-    // 2. Update height of current node
-    updateHeight(node);
+        // 6 to 14 skills per employee, popular skills more likely
+        ZipfianGenerator popularity(catalogSize, 0.8, 17 + c);
+        mt19937 engine(23);
+        vector<vector<string> > named(options.benchmarkSize);
+        vector<SkillSet> compact(options.benchmarkSize);
+        size_t namedBytes = 0;
+        size_t compactBytes = 0;
+        size_t skillCount = 0;
+        for (size_t e = 0; e < options.benchmarkSize; ++e) {
+            size_t wanted = 6 + engine() % 9;
+            for (size_t attempt = 0; attempt < 4 * wanted && compact[e].size() < wanted; ++attempt) {
+                uint16_t id = static_cast<uint16_t>(popularity.next() + 1);
+                if (!compact[e].contains(id)) {
+                    compact[e].add(id);
+                    named[e].push_back(catalog.value(id));
+                }
+            }
+            named[e].shrink_to_fit();
+            namedBytes += sizeof(vector<string>) + named[e].capacity() * sizeof(string);
+            for (size_t i = 0; i < named[e].size(); ++i) {
+                // Heap buffer of strings too long for the short-string buffer
+                namedBytes += named[e][i].capacity() > 15 ? named[e][i].capacity() + 1 : 0;
+            }
+            compactBytes += sizeof(SkillSet) + compact[e].heapBytes();
+            skillCount += compact[e].size();
+        }
 
-    // 3. Get balance factor
-    int balance = getBalance(node);
+        cout << catalogSize << "-skill catalog, " << options.benchmarkSize << " employees, "
+             << static_cast<double>(skillCount) / options.benchmarkSize << " skills each:" << endl;
+        cout << "  memory per employee: vector<string> " << static_cast<double>(namedBytes) / options.benchmarkSize
+             << " bytes, SkillSet " << static_cast<double>(compactBytes) / options.benchmarkSize << " bytes ("
+             << 100.0 * (1.0 - static_cast<double>(compactBytes) / namedBytes) << "% less)" << endl;
 
-    // 4. If unbalanced, there are 4 rotation cases:
+        vector<pair<size_t, size_t> > pairs(pairCount);
+        for (size_t i = 0; i < pairCount; ++i) {
+            pairs[i] = make_pair(engine() % options.benchmarkSize, engine() % options.benchmarkSize);
+        }
 
-    // Left-Left Case (balance < -1 and new node went to left of left child)
-    if (balance < -1 && employee.employeeId < node->left->employee.employeeId) {
-        return rotateRight(node);
-    }
+        size_t namedOverlap = 0;
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < pairCount; ++i) {
+            const vector<string>& a = named[pairs[i].first];
+            const vector<string>& b = named[pairs[i].second];
+            for (size_t x = 0; x < a.size(); ++x) {
+                namedOverlap += find(b.begin(), b.end(), a[x]) != b.end() ? 1 : 0;
+            }
+        }
+        double namedTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
 
-    // Right-Right Case (balance > 1 and new node went to right of right child)
-    if (balance > 1 && employee.employeeId > node->right->employee.employeeId) {
-        return rotateLeft(node);
-    }
+        size_t compactOverlap = 0;
+        start = chrono::steady_clock::now();
+        for (size_t i = 0; i < pairCount; ++i) {
+            compactOverlap += compact[pairs[i].first].overlapCount(compact[pairs[i].second]);
+        }
+        double compactTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
 
-    // Left-Right Case (balance < -1 and new node went to right of left child)
-    if (balance < -1 && employee.employeeId > node->left->employee.employeeId) {
-        node->left = rotateLeft(node->left);
-        return rotateRight(node);
-    }
+        cout << "  " << pairCount << " overlap checks: vector<string> " << namedTime << " ms, SkillSet "
+             << compactTime << " ms (" << namedOverlap << " / " << compactOverlap << " shared skills)" << endl;
 
-    // Right-Left Case (balance > 1 and new node went to left of right child)
-    if (balance > 1 && employee.employeeId < node->right->employee.employeeId) {
-        node->right = rotateRight(node->right);
-        return rotateLeft(node);
-    }
+        const string& probe = catalog.value(catalogSize / 2);
+        uint16_t probeId = static_cast<uint16_t>(catalogSize / 2);
+        size_t namedHits = 0;
+        start = chrono::steady_clock::now();
+        for (size_t e = 0; e < named.size(); ++e) {
+            namedHits += find(named[e].begin(), named[e].end(), probe) != named[e].end() ? 1 : 0;
+        }
+        namedTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
 
-    // Return unchanged node if balanced
-    return node;
+        size_t compactHits = 0;
+        start = chrono::steady_clock::now();
+        for (size_t e = 0; e < compact.size(); ++e) {
+            compactHits += compact[e].contains(probeId) ? 1 : 0;
+        }
+        compactTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        cout << "  has \"" << probe << "\" over all employees: vector<string> " << namedTime << " ms, SkillSet "
+             << compactTime << " ms (" << namedHits << " / " << compactHits << ")" << endl;
+    }
+    cout.unsetf(ios::floatfield);
 }
 
-//============================================================================
-// Function declarations for main() helpers
-//============================================================================
-void displayMenu();
-int getUserChoice();
-bool loadEmployeeData(BinarySearchTree& tree, const string& fileName);
-void printEmployeeDirectory(BinarySearchTree& tree, bool dataLoaded);
-void searchForEmployee(BinarySearchTree& tree, bool dataLoaded);
-bool processMenuChoice(int choice, BinarySearchTree& tree, bool& dataLoaded, const string& fileName);
+/**
+ * Write a synthetic employee CSV file. Names, departments, titles and skills
+ * repeat every 100000 rows; IDs and manager IDs are unique to each row.
+ *
+ * @param fileName The file to create
+ * @param count Number of employee rows
+ * @return True if the file was written
+ */
+bool writeSyntheticCsv(const string& fileName, size_t count) {
+    ofstream file(fileName, ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
 
-// New helper function declarations
-vector<string> parseCSVLine(const string& line);
-vector<string> parseSkills(const string& skillsString);
-bool validateEmployeeData(const Employee& employee);
+    // Text before and after the manager ID of each template row
+    const size_t templateCount = min(count, static_cast<size_t>(100000));
+    vector<string> middles(templateCount);
+    vector<string> tails(templateCount);
+    shared_ptr<EmployeeStore> templates = make_shared<EmployeeStore>();
+    for (size_t i = 0; i < templateCount; ++i) {
+        Employee employee = makeSyntheticEmployee(i, templates);
+        string skills;
+        for (size_t k = 0; k < employee.skillCount(); ++k) {
+            skills += (k > 0 ? "," : "") + employee.skill(k);
+        }
+        middles[i] = "," + employee.fullName.str() + "," + employee.department() + "," + employee.title() + ",";
+        tails[i] = ",\"" + skills + "\"\n";
+    }
 
-//============================================================================
-// Utility Functions for file reading and employee creation
-//============================================================================
+    file << "EmployeeID,FullName,Department,Title,ManagerID,Skills\n";
+    for (size_t i = 0; i < count; ++i) {
+        file << makeSyntheticEmployeeId(i) << middles[i % templateCount];
+        if (i >= 10) {
+            file << makeSyntheticEmployeeId(i / 10);
+        }
+        file << tails[i % templateCount];
+    }
+    return static_cast<bool>(file);
+}
 
 /**
- * Enhanced CSV parsing function that properly handles quoted fields
+ * Compare reading a CSV file with getline into a vector of strings against
+ * mapping it and splitting it into line views, and against streaming it in
+ * fixed-size blocks, alone and followed by field parsing; then compare the
+ * copying parseCSVLine with the zero-copy CsvTokenizer on each separator
+ * scanner, and last time whole loads into a tree, streamed on one thread
+ * and split into chunks or pipelined on more
  *
- * @param line The CSV line to parse
- * @return Vector of parsed tokens
+ * @param options CSV file to read, or the number of rows to generate
  */
-vector<string> parseCSVLine(const string& line) {
-    vector<string> tokens;
-    string currentToken = "";
-    bool inQuotes = false;
+void benchmarkCsvLoad(const ProgramOptions& options) {
+    string fileName = options.benchmarkFile;
+    bool generated = fileName.empty();
+    if (generated) {
+        fileName = "employees_bench.csv";
+        cout << "Writing " << options.benchmarkSize << " synthetic employees to " << fileName << "..." << endl;
+        if (!writeSyntheticCsv(fileName, options.benchmarkSize)) {
+            cout << "Could not write " << fileName << endl;
+            return;
+        }
+    }
 
-    for (size_t i = 0; i < line.length(); ++i) {
-        char c = line[i];
+    MappedFile warm;
+    string error;
+    if (!warm.open(fileName, error)) {
+        cout << error << endl;
+        return;
+    }
+    // Touch every page once so both readers start from the page cache
+    size_t newlines = count(warm.data(), warm.data() + warm.size(), '\n');
+    double megabytes = warm.size() / 1e6;
+    warm.close();
+    cout << fileName << ": " << fixed << setprecision(1) << megabytes << " MB, " << newlines << " lines" << endl;
 
-        if (c == '"') {
-            // Toggle quote state
-            inQuotes = !inQuotes;
+    for (int parse = 0; parse < 2; ++parse) {
+        size_t fields = 0;
+        auto start = chrono::steady_clock::now();
+        {
+            ifstream file(fileName);
+            vector<string> lines;
+            string line;
+            while (getline(file, line)) {
+                lines.push_back(line);
+            }
+            for (size_t i = 0; parse && i < lines.size(); ++i) {
+                fields += parseCSVLine(StringView(lines[i])).size();
+            }
         }
-        else if (c == ',' && !inQuotes) {
-            // End of token - trim whitespace and add to vector
-            string trimmed = currentToken;
-            // Remove leading/trailing whitespace
-            size_t start = trimmed.find_first_not_of(" \t\r\n");
-            if (start != string::npos) {
-                size_t end = trimmed.find_last_not_of(" \t\r\n");
-                trimmed = trimmed.substr(start, end - start + 1);
+        double getlineTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        size_t mappedFields = 0;
+        start = chrono::steady_clock::now();
+        {
+            MappedFile file;
+            file.open(fileName, error);
+            vector<StringView> lines = splitLines(file.data(), file.size());
+            for (size_t i = 0; parse && i < lines.size(); ++i) {
+                mappedFields += parseCSVLine(lines[i]).size();
             }
-            else {
-                trimmed = "";
+        }
+        double mappedTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        size_t streamedFields = 0;
+        start = chrono::steady_clock::now();
+        {
+            LineStream lines;
+            lines.open(fileName, error);
+            StringView line;
+            while (lines.next(line)) {
+                streamedFields += parse ? parseCSVLine(line).size() : 0;
             }
-            tokens.push_back(trimmed);
-            currentToken = "";
         }
-        else {
-            currentToken += c;
+        double streamedTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        cout << (parse ? "Read + parse fields: " : "Read lines:          ") << "getline " << megabytes / getlineTime
+             << " MB/s, mmap " << megabytes / mappedTime << " MB/s, stream " << megabytes / streamedTime << " MB/s";
+        if (parse) {
+            cout << " (" << fields << " / " << mappedFields << " / " << streamedFields << " fields)";
         }
+        cout << endl;
     }
 
-    // Don't forget the last token
-    if (!currentToken.empty() || !tokens.empty()) {
-        string trimmed = currentToken;
-        // Remove leading/trailing whitespace
-        size_t start = trimmed.find_first_not_of(" \t\r\n");
-        if (start != string::npos) {
-            size_t end = trimmed.find_last_not_of(" \t\r\n");
-            trimmed = trimmed.substr(start, end - start + 1);
+    // Record boundaries alone, with every finder this build and CPU can run
+    MappedFile file;
+    file.open(fileName, error);
+    vector<pair<string, RecordEndFinder> > finders;
+    finders.push_back(make_pair(string("scalar"), &findRecordEndScalar));
+#ifdef EMPLOYEE_HAVE_SSE2
+    finders.push_back(make_pair(string("SSE2"), &findRecordEndSSE2));
+#endif
+    const char* selectedFinder = "";
+    RecordEndFinder bestFinder = selectRecordEndFinder(selectedFinder);
+    if (bestFinder != finders.back().second) {
+        finders.push_back(make_pair(string(selectedFinder), bestFinder));
+    }
+    cout << "Find record ends:   ";
+    for (size_t k = 0; k < finders.size(); ++k) {
+        size_t records = 0;
+        auto start = chrono::steady_clock::now();
+        const char* cursor = file.data();
+        const char* end = file.data() + file.size();
+        while (cursor < end) {
+            bool inQuotes = false;
+            size_t lineBreaks = 0;
+            const char* recordEnd = finders[k].second(cursor, end, inQuotes, lineBreaks);
+            cursor = recordEnd != nullptr ? recordEnd + 1 : end;
+            records++;
         }
-        else {
-            trimmed = "";
+        double findTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << (k > 0 ? "," : "") << " " << finders[k].first << " " << megabytes / findTime << " MB/s"
+             << (finders[k].second == bestFinder ? " [selected]" : "");
+        if (k + 1 == finders.size()) {
+            cout << " (" << records << " records)";
         }
-        tokens.push_back(trimmed);
     }
+    cout << endl;
 
-    return tokens;
-}
+    // Tokenizers alone, on lines already in memory
+    vector<StringView> lines = splitLines(file.data(), file.size());
+    size_t copiedFields = 0;
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < lines.size(); ++i) {
+        copiedFields += parseCSVLine(lines[i]).size();
+    }
+    double copyingTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
 
-/**
- * Parse individual skills from a comma-separated skills string
- *
- * @param skillsString The skills string to parse
- * @return Vector of individual skills
- */
-vector<string> parseSkills(const string& skillsString) {
-    vector<string> skills;
-    if (skillsString.empty()) {
-        return skills;
+    cout << "Split fields:        parseCSVLine " << copiedFields / copyingTime / 1e6 << "M fields/s ("
+         << megabytes / copyingTime << " MB/s)" << endl;
+
+    // Every separator scanner this build and CPU can run
+    vector<pair<string, SeparatorScanner> > scanners;
+    scanners.push_back(make_pair(string("scalar"), &scanSeparatorsScalar));
+#ifdef EMPLOYEE_HAVE_SSE2
+    scanners.push_back(make_pair(string("SSE2"), &scanSeparatorsSSE2));
+#endif
+    const char* selected = "";
+    SeparatorScanner best = selectSeparatorScanner(selected);
+    if (best != scanners.back().second) {
+        scanners.push_back(make_pair(string(selected), best));
     }
 
-    stringstream ss(skillsString);
-    string skill;
+    for (size_t k = 0; k < scanners.size(); ++k) {
+        // Separators alone, then whole fields through the tokenizer
+        vector<uint32_t> separators;
+        size_t separatorCount = 0;
+        start = chrono::steady_clock::now();
+        for (size_t i = 0; i < lines.size(); ++i) {
+            separators.clear();
+            scanners[k].second(lines[i].data(), lines[i].size(), separators);
+            separatorCount += separators.size();
+        }
+        double scanTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        CsvTokenizer tokenizer(scanners[k].second);
+        size_t viewedFields = 0;
+        start = chrono::steady_clock::now();
+        for (size_t i = 0; i < lines.size(); ++i) {
+            viewedFields += tokenizer.split(lines[i]).size();
+        }
+        double viewTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
 
-    while (getline(ss, skill, ',')) {
-        // Trim whitespace from each skill
-        size_t start = skill.find_first_not_of(" \t\r\n");
-        if (start != string::npos) {
-            size_t end = skill.find_last_not_of(" \t\r\n");
-            skill = skill.substr(start, end - start + 1);
-            if (!skill.empty()) {
-                skills.push_back(skill);
+        cout << "  CsvTokenizer " << setw(6) << left << scanners[k].first << right << " "
+             << viewedFields / viewTime / 1e6 << "M fields/s (" << megabytes / viewTime << " MB/s), separators only "
+             << megabytes / scanTime << " MB/s" << (scanners[k].second == best ? "  [selected]" : "") << endl;
+    }
+    vector<StringView>().swap(lines);
+    file.close();
+
+    // Whole loads into a tree: streaming on one thread, then chunked and pipelined on more
+    unsigned maxThreads = max(2u, thread::hardware_concurrency());
+    const LoadStrategy strategies[] = { LoadStrategy::STREAM, LoadStrategy::CHUNKED, LoadStrategy::PIPELINE };
+    const char* strategyNames[] = { "stream", "chunked", "pipeline" };
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        for (int k = threads == 1 ? 0 : 1; k < (threads == 1 ? 1 : 3); ++k) {
+            BinarySearchTree tree;
+            PipelineStats stats;
+            ostringstream discarded;
+            streambuf* console = cout.rdbuf(discarded.rdbuf());
+            start = chrono::steady_clock::now();
+            if (strategies[k] == LoadStrategy::PIPELINE) {
+                loadEmployeesPipelined(fileName, tree, threads - 1, stats);
+            }
+            else {
+                createEmployee(fileName, tree, strategies[k], threads);
+            }
+            double loadTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            cout.rdbuf(console);
+            cout << "Load into tree:      " << setw(8) << left << strategyNames[k] << right << setw(2) << threads
+                 << " thread(s) " << loadTime << " s (" << megabytes / loadTime << " MB/s, " << tree.size()
+                 << " employees)" << endl;
+            if (strategies[k] == LoadStrategy::PIPELINE) {
+                printPipelineStats(stats);
+                cout << fixed;
             }
         }
     }
+    cout.unsetf(ios::floatfield);
 
-    return skills;
+    if (generated) {
+        remove(fileName.c_str());
+    }
 }
 
 /**
- * Validate employee data for basic integrity
+ * Compare loading employees from CSV text with saving and loading a
+ * binary snapshot of the same tree
  *
- * @param employee The employee object to validate
- * @return True if employee data is valid, false otherwise
+ * @param options CSV file to read, or the number of rows to generate
  */
-bool validateEmployeeData(const Employee& employee) {
-    // Check required fields
-    if (employee.employeeId.empty() || employee.fullName.empty()) {
-        return false;
+void benchmarkSnapshots(const ProgramOptions& options) {
+    string fileName = options.benchmarkFile;
+    bool generated = fileName.empty();
+    if (generated) {
+        fileName = "employees_bench.csv";
+        cout << "Writing " << options.benchmarkSize << " synthetic employees to " << fileName << "..." << endl;
+        if (!writeSyntheticCsv(fileName, options.benchmarkSize)) {
+            cout << "Could not write " << fileName << endl;
+            return;
+        }
     }
+    // Never the snapshot next to --bench-file, which may be the real employees.snap
+    string snapshotName = "employees_bench.snap";
 
-    // Check for reasonable field lengths
-    if (employee.employeeId.length() > 20 ||
-        employee.fullName.length() > 100 ||
-        employee.department.length() > 50 ||
-        employee.title.length() > 100 ||
-        employee.managerId.length() > 20) {
-        return false;
+    BinarySearchTree tree;
+    ostringstream discarded;
+    streambuf* console = cout.rdbuf(discarded.rdbuf());
+    auto start = chrono::steady_clock::now();
+    bool loaded = createEmployee(fileName, tree, LoadStrategy::AUTO, max(1u, thread::hardware_concurrency()));
+    double csvTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout.rdbuf(console);
+    if (!loaded) {
+        cout << "Could not read " << fileName << endl;
+        return;
     }
 
-    // Check employee ID format (should start with EMP)
-    if (employee.employeeId.substr(0, 3) != "EMP") {
-        return false;
+    string error;
+    start = chrono::steady_clock::now();
+    bool saved = tree.saveSnapshot(snapshotName, 0, error);
+    double saveTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (!saved) {
+        cout << error << endl;
+        return;
     }
 
-    return true;
+    BinarySearchTree restored;
+    uint64_t generation = 0;
+    start = chrono::steady_clock::now();
+    bool restoredOk = restored.loadSnapshot(snapshotName, generation, error);
+    double loadTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (!restoredOk) {
+        cout << error << endl;
+        return;
+    }
+
+    MappedFile csv;
+    MappedFile snapshot;
+    csv.open(fileName, error);
+    snapshot.open(snapshotName, error);
+    cout << fixed << setprecision(3);
+    cout << "CSV load:      " << csvTime << " s (" << csv.size() / 1e6 << " MB, " << tree.size() << " employees)" << endl;
+    cout << "Snapshot save: " << saveTime << " s (" << snapshot.size() / 1e6 << " MB)" << endl;
+    cout << "Snapshot load: " << loadTime << " s (" << restored.size() << " employees, "
+         << csvTime / loadTime << "x faster than CSV)" << endl;
+    cout.unsetf(ios::floatfield);
+    csv.close();
+    snapshot.close();
+
+    remove(snapshotName.c_str());
+    if (generated) {
+        remove(fileName.c_str());
+    }
 }
 
 /**
- * Enhanced file reading with better error handling
+ * Compare searching a snapshot in place with loading it into the tree and
+ * searching that
  *
- * @param fileName The name of the file to be read
- * @return A vector containing each line of the file as a string
+ * @param options Number of synthetic employees to save
  */
-vector<string> readFile(const string& fileName) {
-    vector<string> lines;
-
-    try {
-        ifstream file(fileName);
+void benchmarkMappedLookups(const ProgramOptions& options) {
+    static const size_t LOOKUP_COUNT = 1000000;
+    string snapshotName = "employees_bench.snap";
 
-        // Check if the file was opened successfully
-        if (!file.is_open()) {
-            throw runtime_error("Could not open file: " + fileName);
-        }
-
-        string line;
-        int lineCount = 0;
-
-        // Read each line and add it to the vector
-        while (getline(file, line)) {
-            lines.push_back(line);
-            lineCount++;
+    cout << "Building " << options.benchmarkSize << " synthetic employees..." << endl;
+    BinarySearchTree tree;
+    {
+        // Zero-padded sequence numbers, so the IDs are already in order
+        vector<Employee> employees;
+        employees.reserve(options.benchmarkSize);
+        for (size_t i = 0; i < options.benchmarkSize; ++i) {
+            employees.push_back(makeSyntheticEmployee(i, tree.employeeStore()));
         }
+        tree.bulkLoad(employees);
+    }
+    string error;
+    if (!tree.saveSnapshot(snapshotName, 0, error)) {
+        cout << error << endl;
+        return;
+    }
 
-        file.close();
-
-        if (lineCount == 0) {
-            throw runtime_error("File is empty: " + fileName);
-        }
+    // Half the probes hit, half miss
+    mt19937_64 engine(29);
+    vector<string> probes;
+    probes.reserve(LOOKUP_COUNT);
+    for (size_t i = 0; i < LOOKUP_COUNT; ++i) {
+        probes.push_back(makeSyntheticEmployeeId(engine() % options.benchmarkSize) + (i % 2 == 0 ? "" : "X"));
+    }
 
-        cout << "Successfully read " << lineCount << " lines from " << fileName << endl;
+    auto start = chrono::steady_clock::now();
+    BinarySearchTree loaded;
+    uint64_t generation = 0;
+    bool loadedOk = loaded.loadSnapshot(snapshotName, generation, error);
+    double loadTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (!loadedOk) {
+        cout << error << endl;
+        return;
+    }
+    loaded.setCacheCapacity(0);  // Measure the tree, not the lookup cache
+    size_t treeHits = 0;
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < probes.size(); ++i) {
+        treeHits += loaded.findEmployeeById(probes[i]).employeeId.empty() ? 0 : 1;
+    }
+    double treeTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
 
+    start = chrono::steady_clock::now();
+    MappedEmployeeIndex index;
+    if (!index.open(snapshotName, error)) {
+        cout << error << endl;
+        return;
     }
-    catch (const exception& e) {
-        cout << "File reading error: " << e.what() << endl;
-        return vector<string>(); // Return empty vector
+    double openTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    size_t mappedHits = 0;
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < probes.size(); ++i) {
+        MappedEmployee employee;
+        mappedHits += index.find(StringView(probes[i]), employee) ? 1 : 0;
     }
+    double mappedTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
 
-    return lines;
+    cout << fixed << setprecision(3);
+    cout << "Load snapshot into tree: " << loadTime * 1e3 << " ms, then "
+         << treeTime * 1e9 / probes.size() << " ns per lookup (" << treeHits << " hits)" << endl;
+    cout << "Open snapshot in place:  " << openTime * 1e3 << " ms, then "
+         << mappedTime * 1e9 / probes.size() << " ns per lookup (" << mappedHits << " hits)" << endl;
+    cout.unsetf(ios::floatfield);
+    if (treeHits != mappedHits) {
+        cout << "Lookup results differ between the tree and the mapped index" << endl;
+    }
+
+    remove(snapshotName.c_str());
 }
 
 /**
- * Enhanced function to parse the input file with better error handling
+ * Compare a full reload with a delta reload after one percent of the rows
+ * of a CSV file change: a third are removed, a third renamed and a third
+ * added
  *
- * @param lines The vector of strings created from the input file
- * @return The populated binary search tree with employee objects
+ * @param options Number of rows to generate
  */
-BinarySearchTree createEmployee(const vector<string> lines) {
-    BinarySearchTree tree;
-    int successCount = 0;
-    int errorCount = 0;
-
-    cout << "Parsing employee data..." << endl;
-
-    // Skip the first line (header row) by starting at index 1
-    for (size_t lineIndex = 1; lineIndex < lines.size(); ++lineIndex) {
-        const string& line = lines[lineIndex];
-
-        // Skip empty lines
-        if (line.empty()) {
-            continue;
-        }
-
-        try {
-            // Use enhanced CSV parsing
-            vector<string> tokens = parseCSVLine(line);
+void benchmarkDeltaReload(const ProgramOptions& options) {
+    string fileName = "employees_bench.csv";
+    string changedName = "employees_bench_changed.csv";
+    size_t count = options.benchmarkSize;
+    cout << "Writing " << count << " synthetic employees to " << fileName << "..." << endl;
+    if (!writeSyntheticCsv(fileName, count)) {
+        cout << "Could not write " << fileName << endl;
+        return;
+    }
 
-            // Validate minimum required fields
-            if (tokens.size() < 2) {
-                cout << "Warning: Skipping line " << lineIndex + 1 << " - insufficient data" << endl;
-                errorCount++;
+    // Every 300 rows: remove one, rename one and add one
+    {
+        ifstream in(fileName, ios::binary);
+        ofstream out(changedName, ios::binary);
+        string line;
+        getline(in, line);
+        out << line << '\n';
+        size_t added = 0;
+        for (size_t i = 0; getline(in, line); ++i) {
+            if (i % 300 == 0) {
                 continue;
             }
-
-            // Create employee object safely
-            Employee employee;
-
-            // Required fields
-            employee.employeeId = tokens[0];
-            employee.fullName = tokens[1];
-
-            // Optional fields with bounds checking
-            employee.department = (tokens.size() > 2) ? tokens[2] : "";
-            employee.title = (tokens.size() > 3) ? tokens[3] : "";
-            employee.managerId = (tokens.size() > 4) ? tokens[4] : "";
-
-            // Handle skills field (6th field) with proper parsing
-            if (tokens.size() > 5) {
-                employee.skills = parseSkills(tokens[5]);
+            if (i % 300 == 100) {
+                line.insert(line.find(',') + 1, "Renamed ");
             }
-
-            // Validate the employee data
-            if (!validateEmployeeData(employee)) {
-                cout << "Warning: Skipping invalid employee data: " << employee.employeeId << endl;
-                errorCount++;
-                continue;
+            if (i % 300 == 200) {
+                out << makeSyntheticEmployeeId(count + added++) << line.substr(line.find(',')) << '\n';
             }
-
-            // Add the employee to the tree
-            tree.addEmployee(employee);
-            successCount++;
-
+            out << line << '\n';
         }
-        catch (const exception& e) {
-            cout << "Error processing line " << lineIndex + 1 << ": " << e.what() << endl;
-            errorCount++;
-            continue;
+        if (!out) {
+            cout << "Could not write " << changedName << endl;
+            return;
         }
     }
 
-    cout << "Data loading complete: " << successCount << " employees loaded";
-    if (errorCount > 0) {
-        cout << " (" << errorCount << " errors)";
-    }
-    cout << endl;
-
-    return tree;
-}
+    unsigned threadCount = max(1u, thread::hardware_concurrency());
+    BinarySearchTree full;
+    BinarySearchTree delta;
+    ReloadSummary summary;
+    ostringstream discarded;
+    streambuf* console = cout.rdbuf(discarded.rdbuf());
+    createEmployee(fileName, full, LoadStrategy::AUTO, threadCount);
+    createEmployee(fileName, delta, LoadStrategy::AUTO, threadCount);
+    auto start = chrono::steady_clock::now();
+    createEmployee(changedName, full, LoadStrategy::AUTO, threadCount);
+    double fullTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    start = chrono::steady_clock::now();
+    diffEmployeeFile(changedName, delta, threadCount, summary);
+    applyEmployeeChanges(delta, summary);
+    double deltaTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout.rdbuf(console);
 
-//============================================================================
-// Main program functions
-//============================================================================
+    cout << fixed << setprecision(3);
+    cout << "Full reload:  " << fullTime << " s (" << full.size() << " employees)" << endl;
+    cout << "Delta reload: " << deltaTime << " s (" << summary.added.size() << " added, " << summary.updated.size()
+         << " updated, " << summary.removed.size() << " removed; compare " << summary.compareSeconds << " s, apply "
+         << summary.applySeconds << " s)" << endl;
+    cout.unsetf(ios::floatfield);
+    if (full.size() != delta.size()) {
+        cout << "Employee counts differ between the full and delta reloads" << endl;
+    }
 
-/**
- * Display the main menu options to the user
- */
-void displayMenu() {
-    cout << "Welcome to the Employee Management System.\n" << endl;
-    cout << "1. Load Employee Data." << endl;
-    cout << "2. Print Employee Directory." << endl;
-    cout << "3. Search for Employee." << endl;
-    cout << "9. Exit.\n" << endl;
-    cout << "What would you like to do?" << endl;
+    remove(fileName.c_str());
+    remove(changedName.c_str());
 }
 
 /**
- * Enhanced user choice input with better validation
+ * Measure commit latency of the change log with one committer and with
+ * several at once, where group commit lets them share flushes, and the
+ * time to replay a log on restart
  *
- * @return Valid menu choice (1, 2, 3, or 9)
+ * @param options Number of synthetic employees to log and replay
  */
-int getUserChoice() {
-    int choice;
-    string input;
+void benchmarkWriteAheadLog(const ProgramOptions& options) {
+    static const size_t COMMIT_COUNT = 2000;
+    static const unsigned COMMITTER_COUNT = 8;
+    string logName = "employees_bench.wal";
+    remove(logName.c_str());
 
-    while (true) {
-        try {
-            getline(cin, input);
+    shared_ptr<EmployeeStore> store = make_shared<EmployeeStore>();
+    vector<Employee> employees;
+    size_t count = max(options.benchmarkSize, COMMIT_COUNT);
+    employees.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        employees.push_back(makeSyntheticEmployee(i, store));
+    }
 
-            // Check for empty input
-            if (input.empty()) {
-                cout << "Please enter a choice: ";
-                continue;
-            }
+    WriteAheadLog log;
+    string error;
+    if (!log.open(logName, 0, error)) {
+        cout << error << endl;
+        return;
+    }
 
-            // Try to convert to integer
-            choice = stoi(input);
+    // One committer: every record waits for its own flush
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < COMMIT_COUNT; ++i) {
+        log.waitDurable(log.appendPut(employees[i]));
+    }
+    double sequentialTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    WalStats sequential = log.getStats();
 
-            // Validate range (accept any integer, let processMenuChoice handle invalid options)
-            cout << endl;
-            return choice;
+    // Several committers: records appended during a flush share the next one
+    start = chrono::steady_clock::now();
+    vector<thread> committers;
+    for (unsigned t = 0; t < COMMITTER_COUNT; ++t) {
+        committers.push_back(thread([&, t]() {
+            for (size_t i = t; i < COMMIT_COUNT; i += COMMITTER_COUNT) {
+                log.waitDurable(log.appendPut(employees[i]));
+            }
+        }));
+    }
+    for (size_t t = 0; t < committers.size(); ++t) {
+        committers[t].join();
+    }
+    double concurrentTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    WalStats concurrent = log.getStats();
+    uint64_t concurrentSyncs = concurrent.syncs - sequential.syncs;
 
-        }
-        catch (const invalid_argument&) {
-            cout << "Invalid input. Please enter a number: ";
-        }
-        catch (const out_of_range&) {
-            cout << "Number too large. Please enter a valid choice: ";
-        }
+    // A long log for replay: append everything and wait once
+    log.reset(0, error);
+    start = chrono::steady_clock::now();
+    uint64_t sequence = 0;
+    for (size_t i = 0; i < count; ++i) {
+        sequence = log.appendPut(employees[i]);
     }
-}
+    log.waitDurable(sequence);
+    double batchTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    log.close();
 
-/**
- * Load employee data from CSV file
- *
- * @param tree Reference to the tree to populate
- * @param fileName Name of the CSV file to load
- * @return True if loading was successful, false otherwise
- */
-bool loadEmployeeData(BinarySearchTree& tree, const string& fileName) {
-    cout << "Attempting to load file: " << fileName << endl;
+    BinarySearchTree tree;
+    size_t applied = 0;
+    start = chrono::steady_clock::now();
+    replayWriteAheadLog(logName, 0, tree, applied, error);
+    double replayTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
 
-    vector<string> lines = readFile(fileName);
-    if (lines.empty()) {
-        cout << "Unable to open file." << endl;
-        return false;
-    }
+    cout << fixed << setprecision(1);
+    cout << "1 committer:  " << COMMIT_COUNT / sequentialTime << " commits/s, "
+         << 1e6 * sequentialTime / COMMIT_COUNT << " us each, " << sequential.syncs << " flushes" << endl;
+    cout << COMMITTER_COUNT << " committers: " << COMMIT_COUNT / concurrentTime << " commits/s, " << concurrentSyncs
+         << " flushes (" << static_cast<double>(COMMIT_COUNT) / max<uint64_t>(1, concurrentSyncs)
+         << " records per flush)" << endl;
+    cout << "One batch:    " << count << " records in " << 1e3 * batchTime << " ms" << endl;
+    cout << "Replay:       " << applied << " records in " << 1e3 * replayTime << " ms ("
+         << (replayTime > 0 ? applied / replayTime / 1e6 : 0) << "M records/s)" << endl;
+    cout.unsetf(ios::floatfield);
 
-    tree = createEmployee(lines);
-    cout << "Employee data successfully loaded!" << endl;
-    return true;
+    remove(logName.c_str());
 }
 
 /**
- * Print the complete employee directory
+ * Run the benchmark named on the command line
  *
- * @param tree The tree containing employee data
- * @param dataLoaded Whether data has been loaded
+ * @param options Parsed command line options
+ * @return True if the benchmark exists and ran
  */
-void printEmployeeDirectory(BinarySearchTree& tree, bool dataLoaded) {
-    if (!dataLoaded) {
-        cout << "Please load the employee data first." << endl;
-        return;
+bool runBenchmark(const ProgramOptions& options) {
+    if (options.benchmark == "cache") {
+        benchmarkLookupCache(options);
+        return true;
+    }
+    if (options.benchmark == "skills") {
+        benchmarkSkillQueries(options);
+        return true;
+    }
+    if (options.benchmark == "fuzzy") {
+        benchmarkFuzzyNames(options);
+        return true;
+    }
+    if (options.benchmark == "filter") {
+        benchmarkFilterCounts(options);
+        return true;
+    }
+    if (options.benchmark == "org") {
+        benchmarkReportingChains(options);
+        return true;
+    }
+    if (options.benchmark == "validate") {
+        benchmarkValidation(options);
+        return true;
+    }
+    if (options.benchmark == "skillset") {
+        benchmarkSkillSets(options);
+        return true;
+    }
+    if (options.benchmark == "load") {
+        benchmarkCsvLoad(options);
+        return true;
+    }
+    if (options.benchmark == "snapshot") {
+        benchmarkSnapshots(options);
+        return true;
+    }
+    if (options.benchmark == "mapped") {
+        benchmarkMappedLookups(options);
+        return true;
+    }
+    if (options.benchmark == "reload") {
+        benchmarkDeltaReload(options);
+        return true;
+    }
+    if (options.benchmark == "wal") {
+        benchmarkWriteAheadLog(options);
+        return true;
     }
 
-    cout << "Here is the employee directory:\n" << endl;
-    tree.printEmployeeList();
+    cout << "Unknown benchmark: " << options.benchmark << endl;
+    return false;
 }
 
 /**
- * Search for and display a specific employee
+ * Parse a non-negative integer option value
  *
- * @param tree The tree containing employee data
- * @param dataLoaded Whether data has been loaded
+ * @param text The text after the '=' of the option
+ * @param value Receives the parsed value
+ * @return True if the text is a valid number
  */
-void searchForEmployee(BinarySearchTree& tree, bool dataLoaded) {
-    if (!dataLoaded) {
-        cout << "Please load the employee data first." << endl;
-        return;
+bool parseSizeOption(const string& text, size_t& value) {
+    if (text.empty() || text.find_first_not_of("0123456789") != string::npos) {
+        return false;
     }
-
-    string employeeId;
-    cout << "Please enter the Employee ID you're looking for:" << endl;
-    cin >> employeeId;
-    cout << endl;
-
-    // Transform input to accept both upper and lowercase letters
-    transform(employeeId.begin(), employeeId.end(), employeeId.begin(), ::toupper);
-
-    Employee employee = tree.findEmployeeById(employeeId);
-
-    // Validate the employee was found
-    if (!employee.employeeId.empty()) {
-        cout << employeeId << " Information:" << endl;
-        tree.displayEmployee(employee);
+    try {
+        value = static_cast<size_t>(stoull(text));
     }
-    else {
-        cout << "We're sorry. No employee matching the ID " << employeeId << " was found." << endl;
+    catch (const out_of_range&) {
+        return false;
     }
+    return true;
 }
 
 /**
- * Process user menu choice and execute appropriate action
+ * Parse a rate option value in the range [0, 1)
  *
- * @param choice User's menu selection
- * @param tree Reference to the employee tree
- * @param dataLoaded Reference to data loaded flag
- * @param fileName CSV file name
- * @return True to continue program, false to exit
+ * @param text The text after the '=' of the option
+ * @param value Receives the parsed value
+ * @return True if the text is a valid rate
  */
-bool processMenuChoice(int choice, BinarySearchTree& tree, bool& dataLoaded, const string& fileName) {
-    switch (choice) {
-    case 1: {
-        dataLoaded = loadEmployeeData(tree, fileName);
-        break;
-    }
-    case 2: {
-        printEmployeeDirectory(tree, dataLoaded);
-        break;
-    }
-    case 3: {
-        searchForEmployee(tree, dataLoaded);
-        break;
-    }
-    case 9: {
-        cout << "Goodbye!" << endl;
-        return false; // Signal to exit
+bool parseRateOption(const string& text, double& value) {
+    try {
+        size_t used = 0;
+        double parsed = stod(text, &used);
+        if (used != text.size() || parsed < 0.0 || parsed >= 1.0) {
+            return false;
+        }
+        value = parsed;
     }
-    default: {
-        cout << choice << " is not a valid option." << endl;
-        break;
+    catch (const exception&) {
+        return false;
     }
+    return true;
+}
+
+/**
+ * Parse command line options
+ *
+ * @param argc Argument count from main()
+ * @param argv Argument values from main()
+ * @param options Receives the selected options
+ * @return True if all options were recognized, false otherwise
+ */
+bool parseCommandLine(int argc, char* argv[], ProgramOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool valid = true;
+
+        if (arg == "--index=avl") {
+            options.backend = IndexBackend::AVL;
+        }
+        else if (arg == "--index=art") {
+            options.backend = IndexBackend::RADIX;
+        }
+        else if (arg == "--loader=stream") {
+            options.loadStrategy = LoadStrategy::STREAM;
+        }
+        else if (arg == "--loader=chunked") {
+            options.loadStrategy = LoadStrategy::CHUNKED;
+        }
+        else if (arg == "--loader=pipeline") {
+            options.loadStrategy = LoadStrategy::PIPELINE;
+        }
+        else if (arg.compare(0, 13, "--cache-size=") == 0) {
+            valid = parseSizeOption(arg.substr(13), options.cacheCapacity);
+        }
+        else if (arg.compare(0, 12, "--bloom-fpr=") == 0) {
+            valid = parseRateOption(arg.substr(12), options.filterRate);
+        }
+        else if (arg.compare(0, 8, "--bench=") == 0) {
+            options.benchmark = arg.substr(8);
+        }
+        else if (arg.compare(0, 13, "--bench-size=") == 0) {
+            valid = parseSizeOption(arg.substr(13), options.benchmarkSize) && options.benchmarkSize > 0;
+        }
+        else if (arg.compare(0, 13, "--bench-file=") == 0) {
+            options.benchmarkFile = arg.substr(13);
+            valid = !options.benchmarkFile.empty();
+        }
+        else if (arg.compare(0, 9, "--lookup=") == 0) {
+            options.lookupIds.push_back(arg.substr(9));
+            valid = !options.lookupIds.back().empty();
+        }
+        else if (arg == "--no-wal") {
+            options.changeLog = false;
+        }
+        else if (arg.compare(0, 19, "--checkpoint-every=") == 0) {
+            valid = parseSizeOption(arg.substr(19), options.checkpointRecords);
+        }
+        else {
+            valid = false;
+        }
+
+        if (!valid) {
+            cout << "Invalid option: " << arg << endl;
+            cout << "Usage: " << argv[0] << " [--index=avl|--index=art] [--loader=stream|chunked|pipeline]"
+                 << " [--cache-size=N] [--bloom-fpr=RATE]"
+                 << " [--bench=cache|skills|fuzzy|filter|org|validate|skillset|load|snapshot|mapped|reload|wal]"
+                 << " [--bench-size=N] [--bench-file=PATH] [--lookup=ID]... [--no-wal] [--checkpoint-every=N]" << endl;
+            return false;
+        }
     }
-    return true; // Continue program
+    return true;
 }
 
 /**
  * Main program entry point - now clean and focused
  */
-int main() {
-    BinarySearchTree tree;
+int main(int argc, char* argv[]) {
+    ProgramOptions options;
+    if (!parseCommandLine(argc, argv, options)) {
+        return 1;
+    }
+
+    if (!options.benchmark.empty()) {
+        return runBenchmark(options) ? 0 : 1;
+    }
+    if (!options.lookupIds.empty()) {
+        return lookupEmployeesInSnapshot(options.lookupIds, "employees.csv") ? 0 : 1;
+    }
+
+    BinarySearchTree tree(options.backend);
+    tree.setCacheCapacity(options.cacheCapacity);
+    tree.setFilterFalsePositiveRate(options.filterRate);
     string fileName = "employees.csv";
-    bool dataLoaded = false;
+    Persistence persistence;
+    persistence.enabled = options.changeLog;
+    persistence.checkpointRecords = options.checkpointRecords;
+    bool dataLoaded = recoverEmployeeData(tree, fileName, persistence);
     bool continueProgram = true;
 
     // Main program loop
     while (continueProgram) {
         displayMenu();
         int choice = getUserChoice();
-        continueProgram = processMenuChoice(choice, tree, dataLoaded, fileName);
+        continueProgram = processMenuChoice(choice, tree, dataLoaded, fileName, options.loadStrategy, persistence);
         cout << endl; // Newline for clarity
     }
 